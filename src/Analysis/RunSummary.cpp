@@ -0,0 +1,137 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include "RunSummary.h"
+
+static const char *quantityNames[RunSummary::numQuantities] = {"txnIntensity", "rnaIntensity", "dnaCov"};
+
+RunSummary::RunSummary(Logger &logger, std::string outputFile)
+        : logger(logger), outputFileName(outputFile), numSamples(0), lastSample(), means(), coMoments()
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    lastSample = {nan, nan, nan, {nan, nan, nan}}; // Written as such if no sample comes
+}
+
+void RunSummary::addSample(double t, const SnapshotAnalyzer::ChannelMeasures &dna,
+                           const SnapshotAnalyzer::ChannelMeasures &rna,
+                           const SnapshotAnalyzer::ChannelMeasures &transcription)
+{
+    lastSample.t = t;
+    lastSample.txnSites = transcription.total / 255; // Transcribing cells are 255 in their channel
+    lastSample.rnaTotal = rna.total;
+    lastSample.values[0] = transcription.mean;
+    lastSample.values[1] = rna.mean;
+    lastSample.values[2] = dna.cov;
+    // Welford's update of the means and co-moments
+    ++numSamples;
+    double deltas[numQuantities];
+    for (int i = 0; i < numQuantities; ++i)
+    {
+        deltas[i] = lastSample.values[i] - means[i];
+        means[i] += deltas[i] / numSamples;
+    }
+    for (int i = 0; i < numQuantities; ++i)
+    {
+        for (int j = 0; j < numQuantities; ++j)
+        {
+            coMoments[i][j] += deltas[i] * (lastSample.values[j] - means[j]);
+        }
+    }
+}
+
+unsigned long RunSummary::getNumSamples() const
+{
+    return numSamples;
+}
+
+double RunSummary::getCovariance(int quantity1, int quantity2) const
+{
+    if (numSamples < 2)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return coMoments[quantity1][quantity2] / (numSamples - 1);
+}
+
+double RunSummary::getCorrelation(int quantity1, int quantity2) const
+{
+    double deviations = std::sqrt(coMoments[quantity1][quantity1] * coMoments[quantity2][quantity2]);
+    if (numSamples < 2 || deviations == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return coMoments[quantity1][quantity2] / deviations;
+}
+
+void RunSummary::write() const
+{
+    if (numSamples == 0)
+    {
+        logger.logMsg(WARNING, "No snapshot was analyzed, run summary %s is empty", outputFileName.data());
+    }
+    std::FILE *file = std::fopen(outputFileName.data(), "w");
+    if (file == nullptr)
+    {
+        logger.logMsg(ERROR, "Cannot open run summary %s", outputFileName.data());
+        throw std::runtime_error("Cannot open run summary " + outputFileName);
+    }
+    std::string header = "samples,time,txnSites,txnIntensity,rnaTotal,rnaIntensity,dnaCov";
+    for (int i = 0; i < numQuantities; ++i)
+    {
+        header += std::string(",mean_") + quantityNames[i] + ",var_" + quantityNames[i];
+    }
+    for (int i = 0; i < numQuantities; ++i)
+    {
+        for (int j = i + 1; j < numQuantities; ++j)
+        {
+            header += std::string(",cov_") + quantityNames[i] + "_" + quantityNames[j];
+            header += std::string(",corr_") + quantityNames[i] + "_" + quantityNames[j];
+        }
+    }
+    std::fprintf(file, "%s\n%lu,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g", header.data(), numSamples, lastSample.t,
+                 lastSample.txnSites, lastSample.values[0], lastSample.rnaTotal, lastSample.values[1],
+                 lastSample.values[2]);
+    for (int i = 0; i < numQuantities; ++i)
+    {
+        double mean = (numSamples > 0) ? means[i] : std::numeric_limits<double>::quiet_NaN();
+        std::fprintf(file, ",%.9g,%.9g", mean, getCovariance(i, i));
+    }
+    for (int i = 0; i < numQuantities; ++i)
+    {
+        for (int j = i + 1; j < numQuantities; ++j)
+        {
+            std::fprintf(file, ",%.9g,%.9g", getCovariance(i, j), getCorrelation(i, j));
+        }
+    }
+    std::fputs("\n", file);
+    if (std::fclose(file) != 0)
+    {
+        logger.logMsg(ERROR, "Cannot write run summary %s", outputFileName.data());
+        throw std::runtime_error("Cannot write run summary " + outputFileName);
+    }
+    logger.logMsg(PRODUCTION, "Run summary of %s=%lu samples written to %s", DUMP(numSamples),
+                  outputFileName.data());
+}
+
+void RunSummary::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("SMRY");
+    writer.write(numSamples);
+    writer.write(lastSample);
+    writer.writeArray(means, numQuantities);
+    writer.writeArray(&coMoments[0][0], numQuantities * numQuantities);
+}
+
+void RunSummary::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("SMRY");
+    numSamples = reader.read<unsigned long>();
+    lastSample = reader.read<Sample>();
+    reader.readArray(means, numQuantities);
+    reader.readArray(&coMoments[0][0], numQuantities * numQuantities);
+}
@@ -0,0 +1,69 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_RUNSUMMARY_H
+#define ACTIVE_MICROEMULSION_RUNSUMMARY_H
+
+#include <string>
+#include "../Logger/Logger.h"
+#include "../Checkpoint/Checkpoint.h"
+#include "SnapshotAnalyzer.h"
+
+/*
+ * Per-run version of the trajectory scripts of utils/ (covTxnAnalysis.py, covRnaAnalysis.py, txnRnaAnalysis.py and
+ * covRnaTxn3dAnalysis.py): from the snapshots measured by a SnapshotAnalyzer it keeps the last state of the run and
+ * the running statistics of the TXN intensity, RNA intensity and DNA CoV, i.e. of the X, Y and Z of
+ * covRnaTxn3dAnalysis.py. The statistics are updated online, so memory does not grow with the length of the run.
+ * write() produces a table with a header and a single row:
+ *   samples,time,txnSites,txnIntensity,rnaTotal,rnaIntensity,dnaCov,
+ *   mean_<q>, var_<q> for each quantity q of the 3, cov_<q1>_<q2> and corr_<q1>_<q2> for each pair
+ * so that the tables of a parameter sweep can be concatenated into one. Variances and covariances are the unbiased
+ * ones, as numpy.cov; corr is Pearson's correlation coefficient. Undefined values are written as nan.
+ * The samples are the snapshots analyzed by the SnapshotAnalyzer, so the summary has no flag or interval of its own:
+ * it is only kept with --analysis, and sampled at the snapshots plus the --analysis-interval times.
+ */
+class RunSummary
+{
+public:
+    static const int numQuantities = 3; // TXN intensity, RNA intensity, DNA CoV
+
+private:
+    struct Sample
+    {
+        double t;
+        double txnSites, rnaTotal; // Transcribing cells and total RNA count, before the blur
+        double values[numQuantities];
+    };
+    
+    Logger &logger;
+    std::string outputFileName;
+    unsigned long numSamples;
+    Sample lastSample;
+    double means[numQuantities];
+    double coMoments[numQuantities][numQuantities]; // Sums of the products of the deviations from the means
+
+public:
+    RunSummary(Logger &logger, std::string outputFile);
+    
+    // Measures of the DNA, RNA and transcription channels of a snapshot, as in AsyncSnapshotWriter.
+    void addSample(double t, const SnapshotAnalyzer::ChannelMeasures &dna,
+                   const SnapshotAnalyzer::ChannelMeasures &rna,
+                   const SnapshotAnalyzer::ChannelMeasures &transcription);
+    
+    unsigned long getNumSamples() const;
+    
+    // Sample covariance of two quantities, NaN with less than 2 samples.
+    double getCovariance(int quantity1, int quantity2) const;
+    
+    double getCorrelation(int quantity1, int quantity2) const;
+    
+    // Write the table, replacing the one of a previous call. Without samples its statistics are nan, with a warning.
+    void write() const;
+    
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+};
+
+#endif //ACTIVE_MICROEMULSION_RUNSUMMARY_H
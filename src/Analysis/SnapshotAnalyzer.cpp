@@ -0,0 +1,243 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include "SnapshotAnalyzer.h"
+
+// OpenCV index of the sample read for out of range index i (BORDER_REFLECT_101: ...|2 1|0 1 2 ... n-1|n-2 n-3|...)
+static int reflectBorder(int i, int n)
+{
+    if (n == 1)
+    {
+        return 0;
+    }
+    while (i < 0 || i >= n)
+    {
+        i = (i < 0) ? -i : 2 * n - 2 - i;
+    }
+    return i;
+}
+
+SnapshotAnalyzer::SnapshotAnalyzer(Logger &logger, int width, int height, int kernelSize, std::string outputFile)
+        : logger(logger), width(width), height(height), outputFileName(outputFile),
+          file(nullptr), seriesSize(0)
+{
+    if (kernelSize <= 0 || kernelSize % 2 == 0)
+    {
+        logger.logMsg(ERROR, "SnapshotAnalyzer: blur kernel size must be positive and odd, %s=%d", DUMP(kernelSize));
+        throw std::runtime_error("SnapshotAnalyzer: invalid blur kernel size");
+    }
+    kernel = getGaussianKernel(kernelSize);
+    int radius = kernelSize / 2;
+    for (int column = -radius; column < width + radius; ++column)
+    {
+        columnSources.push_back(reflectBorder(column, width));
+    }
+    for (int row = -radius; row < height + radius; ++row)
+    {
+        rowSources.push_back(reflectBorder(row, height));
+    }
+    rowBlurred.resize(static_cast<size_t>(width) * height);
+}
+
+SnapshotAnalyzer::~SnapshotAnalyzer()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+    }
+}
+
+void SnapshotAnalyzer::addChannel(std::string channelName)
+{
+    channelNames.push_back(channelName);
+}
+
+std::vector<float> SnapshotAnalyzer::getGaussianKernel(int kernelSize)
+{
+    // Like OpenCV, small kernels with automatic sigma come from a table rather than from the Gaussian
+    static const float smallKernels[][7] = {
+            {1.f},
+            {0.25f, 0.5f, 0.25f},
+            {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f},
+            {0.03125f, 0.109375f, 0.21875f, 0.28125f, 0.21875f, 0.109375f, 0.03125f}
+    };
+    if (kernelSize <= 7)
+    {
+        return std::vector<float>(smallKernels[kernelSize / 2], smallKernels[kernelSize / 2] + kernelSize);
+    }
+    double sigma = 0.3 * ((kernelSize - 1) * 0.5 - 1) + 0.8;
+    std::vector<double> weights(kernelSize);
+    double sum = 0;
+    for (int i = 0; i < kernelSize; ++i)
+    {
+        double x = i - (kernelSize - 1) * 0.5;
+        weights[i] = std::exp(-x * x / (2 * sigma * sigma));
+        sum += weights[i];
+    }
+    std::vector<float> gaussianKernel(kernelSize);
+    for (int i = 0; i < kernelSize; ++i)
+    {
+        gaussianKernel[i] = static_cast<float>(weights[i] / sum);
+    }
+    return gaussianKernel;
+}
+
+void SnapshotAnalyzer::startSnapshot(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                                     unsigned long chemChangesPerformed)
+{
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%.9g,%lu,%lu,%lu", t, swapAttempts, swapsPerformed, chemChangesPerformed);
+    row = buffer;
+    measures.clear();
+}
+
+void SnapshotAnalyzer::analyzeChannel(const unsigned char *plane)
+{
+    blurAndMeasure(plane);
+}
+
+void SnapshotAnalyzer::analyzeChannel(const RnaCounter *plane)
+{
+    blurAndMeasure(plane);
+}
+
+template<typename Sample>
+void SnapshotAnalyzer::blurAndMeasure(const Sample *plane)
+{
+    const int taps = static_cast<int>(kernel.size());
+    double total = 0;
+    // Horizontal pass
+    for (int row = 0; row < height; ++row)
+    {
+        const Sample *samples = plane + static_cast<size_t>(row) * width;
+        float *output = rowBlurred.data() + static_cast<size_t>(row) * width;
+        for (int column = 0; column < width; ++column)
+        {
+            float value = 0;
+            for (int tap = 0; tap < taps; ++tap)
+            {
+                value += kernel[tap] * samples[columnSources[column + tap]];
+            }
+            output[column] = value;
+            total += samples[column];
+        }
+    }
+    // Vertical pass, accumulating the moments of the blurred plane on the way
+    double sum = 0, sumOfSquares = 0;
+    std::vector<float> blurredRow(width);
+    for (int row = 0; row < height; ++row)
+    {
+        std::fill(blurredRow.begin(), blurredRow.end(), 0.f);
+        for (int tap = 0; tap < taps; ++tap)
+        {
+            const float *input = rowBlurred.data() + static_cast<size_t>(rowSources[row + tap]) * width;
+            const float weight = kernel[tap];
+            for (int column = 0; column < width; ++column)
+            {
+                blurredRow[column] += weight * input[column];
+            }
+        }
+        for (int column = 0; column < width; ++column)
+        {
+            sum += blurredRow[column];
+            sumOfSquares += static_cast<double>(blurredRow[column]) * blurredRow[column];
+        }
+    }
+    double numSamples = static_cast<double>(width) * height;
+    double mean = sum / numSamples;
+    double variance = std::fmax(sumOfSquares / numSamples - mean * mean, 0);
+    double cov = (mean > 0) ? std::sqrt(variance) / mean : std::numeric_limits<double>::quiet_NaN();
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), ",%.9g,%.9g", mean, cov);
+    row += buffer;
+    measures.push_back({total, mean, cov});
+}
+
+void SnapshotAnalyzer::commitSnapshot()
+{
+    if (measures.size() != channelNames.size())
+    {
+        logger.logMsg(ERROR, "SnapshotAnalyzer: %lu channels analyzed out of %lu",
+                      static_cast<unsigned long>(measures.size()), static_cast<unsigned long>(channelNames.size()));
+        throw std::runtime_error("SnapshotAnalyzer: snapshot committed with missing channels");
+    }
+    if (file == nullptr)
+    {
+        create();
+    }
+    row += "\n";
+    if (std::fputs(row.data(), file) < 0 || std::fflush(file) != 0)
+    {
+        logger.logMsg(ERROR, "Cannot write analysis series %s", outputFileName.data());
+        throw std::runtime_error("Cannot write analysis series " + outputFileName);
+    }
+    seriesSize += static_cast<long>(row.size());
+}
+
+const SnapshotAnalyzer::ChannelMeasures &SnapshotAnalyzer::getMeasures(size_t channel) const
+{
+    return measures.at(channel);
+}
+
+void SnapshotAnalyzer::create()
+{
+    file = std::fopen(outputFileName.data(), "w");
+    if (file == nullptr)
+    {
+        logger.logMsg(ERROR, "Cannot open analysis series %s", outputFileName.data());
+        throw std::runtime_error("Cannot open analysis series " + outputFileName);
+    }
+    std::string header = "time,swapAttempts,swapsPerformed,chemChangesPerformed";
+    for (auto &channelName : channelNames)
+    {
+        header += "," + channelName + "_mean," + channelName + "_cov";
+    }
+    header += "\n";
+    std::fputs(header.data(), file);
+    seriesSize = static_cast<long>(header.size());
+}
+
+bool SnapshotAnalyzer::reopen(long size)
+{
+    boost::system::error_code error;
+    auto existingSize = boost::filesystem::file_size(outputFileName, error);
+    if (error || existingSize < static_cast<uintmax_t>(size))
+    {
+        return false;
+    }
+    // Drop the rows written after the checkpoint
+    boost::filesystem::resize_file(outputFileName, static_cast<uintmax_t>(size));
+    file = std::fopen(outputFileName.data(), "a");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    seriesSize = size;
+    return true;
+}
+
+void SnapshotAnalyzer::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("ANLS");
+    writer.write(file != nullptr);
+    writer.write(seriesSize);
+}
+
+void SnapshotAnalyzer::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("ANLS");
+    bool isStarted = reader.read<bool>();
+    long sizeToKeep = reader.read<long>();
+    if (isStarted && !reopen(sizeToKeep))
+    {
+        logger.logMsg(WARNING, "No matching analysis series %s to resume, the rows of the run being resumed "
+                               "are not in the new one", outputFileName.data());
+    }
+}
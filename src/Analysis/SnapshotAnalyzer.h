@@ -0,0 +1,91 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_SNAPSHOTANALYZER_H
+#define ACTIVE_MICROEMULSION_SNAPSHOTANALYZER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../Cell/CellData.h"
+#include "../Logger/Logger.h"
+#include "../Checkpoint/Checkpoint.h"
+
+/*
+ * In-situ version of the contrast analysis of utils/ (contrastAnalysis.py, TimeAnalysis in utilsLib.py): each
+ * channel of a snapshot is blurred with the same Gaussian kernel as cv2.GaussianBlur(image, (k, k), 0), borders
+ * included, and its mean intensity and coefficient of variation (std/mean) are appended to a CSV series, one row
+ * per snapshot:
+ *   time,swapAttempts,swapsPerformed,chemChangesPerformed,<channel>_mean,<channel>_cov,...
+ * Snapshots are analyzed as the 8 bit images the scripts read, i.e. with the RNA content saturated at 255 (RnaChannel)
+ * even when the PGM files keep it on 16 bits. The blurred values are not rounded to 8 bits as OpenCV does for 8 bit
+ * images, so results can differ from the scripts in the last digits.
+ */
+class SnapshotAnalyzer
+{
+public:
+    struct ChannelMeasures
+    {
+        double total; // Sum of the samples before the blur
+        double mean, cov; // Of the blurred channel
+    };
+
+private:
+    Logger &logger;
+    const int width, height;
+    std::string outputFileName;
+    std::vector<std::string> channelNames;
+    std::vector<float> kernel;
+    std::vector<int> columnSources, rowSources; // Source of each tap, with the borders reflected as in OpenCV
+    std::vector<float> rowBlurred; // Plane after the horizontal pass of the blur
+    std::FILE *file;
+    std::string row; // Row of the series being filled in
+    std::vector<ChannelMeasures> measures; // Of the channels analyzed in the current snapshot
+    long seriesSize; // Bytes of complete rows in the file
+
+public:
+    // kernelSize is the (odd) size of the blur kernel, the "blur radius" of the scripts.
+    SnapshotAnalyzer(Logger &logger, int width, int height, int kernelSize, std::string outputFile);
+    
+    ~SnapshotAnalyzer();
+    
+    // Channels must all be added before the first snapshot is analyzed, in the order they are then analyzed in.
+    void addChannel(std::string channelName);
+    
+    void startSnapshot(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                       unsigned long chemChangesPerformed);
+    
+    // Plane is width x height samples, as rendered by MultiChannelRenderer.
+    void analyzeChannel(const unsigned char *plane);
+    
+    void analyzeChannel(const RnaCounter *plane);
+    
+    // Append the row of the snapshot to the series, creating the file at the first one.
+    void commitSnapshot();
+    
+    // Measures of the given channel (in the order they were added) in the last snapshot analyzed.
+    const ChannelMeasures &getMeasures(size_t channel) const;
+    
+    // Gaussian kernel of cv2.getGaussianKernel(kernelSize, 0).
+    static std::vector<float> getGaussianKernel(int kernelSize);
+    
+    /**
+     * Save and restore the length of the series. On restore, the series already in the output folder is cut back
+     * to that length and then appended to, so that it matches an uninterrupted run.
+     */
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+
+private:
+    template<typename Sample>
+    void blurAndMeasure(const Sample *plane);
+    
+    void create();
+    
+    // Reopen the existing series, cut back to the given size. False if it is not there or shorter.
+    bool reopen(long size);
+};
+
+#endif //ACTIVE_MICROEMULSION_SNAPSHOTANALYZER_H
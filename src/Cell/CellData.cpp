@@ -78,18 +78,3 @@ Flags CellData::flagsOf(Transcribability transcribability, TranscriptionInhibiti
     setFlags(flags, transcribability, inhibition);
     return flags;
 }
-
-std::set<ChainId> CellData::chainsCellBelongsTo()
-{
-    auto chainIdSet = std::set<ChainId>();
-    for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
-    {
-        ChainProperties &chain = chainProperties[k];
-        unsigned int chainLength = chain.chainLength;
-        if (chainLength > 0)
-        {
-            chainIdSet.insert(chain.chainId);
-        }
-    }
-    return chainIdSet;
-}
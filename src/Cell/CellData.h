@@ -42,30 +42,78 @@ typedef enum
 } TranscriptionInhibition;
 
 typedef unsigned short ChainId;
+// One bit per Moore neighbour, see Grid::getDirectionMask() for the bit layout.
+typedef unsigned char NeighbourMask;
 typedef struct ChainProperties
 {
     // Note: chainId=0 CANNOT be used!
     ChainId chainId; //todo check how many chains we expect to have.
     unsigned short position; // Position of cell within the chain
     unsigned short chainLength; // chainLength==0 is the criterion for no chain
-    ChainProperties() : chainId(0), position(0), chainLength(0)
+    NeighbourMask neighbourMask; // Directions where the predecessor and successor within this chain sit
+    ChainProperties() : chainId(0), position(0), chainLength(0), neighbourMask(0)
     {};
 } ChainProperties;
 
 typedef unsigned short RnaCounter;
 
+typedef unsigned int ChainSlotIndex;
+
+// Packed per-cell state as stored in the grid's byte plane:
+// chemical properties in the lowest bits, flags right above them, then a marker for cells belonging to chains.
+typedef unsigned char CellState;
+const unsigned char FLAGS_SHIFT = 2;
+const unsigned char CHAIN_MARKER_BIT = 4;
+const CellState CHEMICAL_PROPERTIES_MASK = (1U << FLAGS_SHIFT) - 1;
+const CellState FLAGS_MASK = CHEMICAL_PROPERTIES_MASK << FLAGS_SHIFT;
+const CellState CHAIN_MARKER_MASK = 1U << CHAIN_MARKER_BIT;
+
+/*
+ * Unpacked view of a single cell. The grid does not store CellData objects: it keeps separate planes for the
+ * packed state, the RNA content and the chain properties. CellData is used to pass a cell around by value.
+ */
 class CellData
 {
 public:
     ChemicalProperties chemicalProperties;
     Flags flags;
     RnaCounter rnaContent;
-    ChainProperties chainProperties[MAX_CROSSING_CHAINS];
 
 public:
     CellData() : chemicalProperties(0), flags(0), rnaContent(0)
     {};
     
+    CellData(CellState state, RnaCounter rnaContent) : chemicalProperties(chemicalPropertiesOf(state)),
+                                                       flags(flagsOf(state)),
+                                                       rnaContent(rnaContent)
+    {};
+    
+    static inline ChemicalProperties chemicalPropertiesOf(CellState state)
+    {
+        return static_cast<ChemicalProperties>(state & CHEMICAL_PROPERTIES_MASK);
+    }
+    
+    static inline Flags flagsOf(CellState state)
+    {
+        return static_cast<Flags>((state & FLAGS_MASK) >> FLAGS_SHIFT);
+    }
+    
+    static inline bool hasChain(CellState state)
+    {
+        return (state & CHAIN_MARKER_MASK) != 0;
+    }
+    
+    static inline CellState stateOf(ChemicalProperties chemicalProperties, Flags flags)
+    {
+        return static_cast<CellState>((chemicalProperties & CHEMICAL_PROPERTIES_MASK)
+                                      | ((flags << FLAGS_SHIFT) & FLAGS_MASK));
+    }
+    
+    inline CellState getState() const
+    {
+        return stateOf(chemicalProperties, flags);
+    }
+    
     inline ChemicalProperties getChemicalProperties() const
     {
         return chemicalProperties;
@@ -176,14 +224,24 @@ public:
         return flags;
     }
     
+    static inline bool isTranscribable(Flags flags)
+    {
+        return ((flags >> TRANSCRIBABLE_BIT) & 1U) == TRANSCRIBABLE;
+    }
+    
     inline bool isTranscribable() const
     {
-        return ((getFlags() >> TRANSCRIBABLE_BIT) & 1U) == TRANSCRIBABLE;
+        return isTranscribable(getFlags());
+    }
+    
+    static inline bool isTranscriptionInhibited(Flags flags)
+    {
+        return ((flags >> TRANSCRIPTION_INHIBITION_BIT) & 1U) == TRANSCRIPTION_INHIBITED;
     }
     
     inline bool isTranscriptionInhibited() const
     {
-        return ((getFlags() >> TRANSCRIPTION_INHIBITION_BIT) & 1U) == TRANSCRIPTION_INHIBITED;
+        return isTranscriptionInhibited(getFlags());
     }
     
     static ChemicalProperties chemicalPropertiesOf(ChemicalSpecies species, Activity activity);
@@ -196,20 +254,19 @@ public:
     
     static Flags flagsOf(Transcribability transcribability, TranscriptionInhibition inhibition);
     
-    std::set<ChainId> chainsCellBelongsTo();
+    static void setActivity(ChemicalProperties &chemicalProperties, Activity activity);
+    
+    static void setTranscribability(Flags &flags, Transcribability transcribability);
+    
+    static void setTranscriptionInhibition(Flags &flags, TranscriptionInhibition inhibition);
 
 private:
-    static void setActivity(ChemicalProperties &chemicalProperties, Activity activity);
     
     static void setChemicalSpecies(ChemicalProperties &chemicalProperties, ChemicalSpecies species);
     
     static void setChemicalProperties(ChemicalProperties &chemicalProperties, ChemicalSpecies species,
                                       Activity activity);
     
-    static void setTranscribability(Flags &flags, Transcribability transcribability);
-    
-    static void setTranscriptionInhibition(Flags &flags, TranscriptionInhibition inhibition);
-    
     static void setFlags(Flags &flags, Transcribability transcribability, TranscriptionInhibition inhibition);
 };
 
@@ -54,7 +54,7 @@ ChainConfig &ChainConfig::parseChainProperties(ChainConfig &tmp, std::string &in
         if (!(getline(ssTmp, key, '=')
               && getline(ssTmp, valueStr, '=')))
         {
-            tmp.getLogger().logMsg(DEBUG, "ChainConfig::parseChainProperties : Ignoring entry %s", tmpString.data());
+            LOG_MSG(tmp.getLogger(), DEBUG, "ChainConfig::parseChainProperties : Ignoring entry %s", tmpString.data());
             continue;
         }
         auto value = static_cast<unsigned char>(std::stoi(valueStr));
@@ -0,0 +1,106 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include "Checkpoint.h"
+
+static const size_t tagLength = 4;
+// Large buffer: checkpoints are written in few big blocks (the grid planes) and many small values.
+static const size_t fileBufferSize = 1 << 22;
+
+CheckpointWriter::CheckpointWriter(const std::string &fileName)
+        : fileName(fileName), temporaryFileName(fileName + ".tmp"), file(nullptr)
+{
+    file = std::fopen(temporaryFileName.data(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Cannot open checkpoint file " + temporaryFileName);
+    }
+    std::setvbuf(file, nullptr, _IOFBF, fileBufferSize);
+    writeArray(Checkpoint::magic, sizeof(Checkpoint::magic));
+    write(Checkpoint::formatVersion);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    if (file != nullptr) // Not committed: drop the partial checkpoint
+    {
+        std::fclose(file);
+        std::remove(temporaryFileName.data());
+    }
+}
+
+void CheckpointWriter::writeTag(const char *tag)
+{
+    writeBytes(tag, tagLength);
+}
+
+void CheckpointWriter::commit()
+{
+    bool isClosed = std::fclose(file) == 0;
+    file = nullptr;
+    if (!isClosed || std::rename(temporaryFileName.data(), fileName.data()) != 0)
+    {
+        std::remove(temporaryFileName.data());
+        throw std::runtime_error("Cannot write checkpoint file " + fileName);
+    }
+}
+
+void CheckpointWriter::writeBytes(const void *data, size_t size)
+{
+    if (size > 0 && std::fwrite(data, 1, size, file) != size)
+    {
+        throw std::runtime_error("Cannot write checkpoint file " + temporaryFileName);
+    }
+}
+
+CheckpointReader::CheckpointReader(const std::string &fileName)
+        : fileName(fileName), file(nullptr)
+{
+    file = std::fopen(fileName.data(), "rb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Cannot open checkpoint file " + fileName);
+    }
+    std::setvbuf(file, nullptr, _IOFBF, fileBufferSize);
+    char fileMagic[sizeof(Checkpoint::magic)];
+    readArray(fileMagic, sizeof(fileMagic));
+    if (std::memcmp(fileMagic, Checkpoint::magic, sizeof(fileMagic)) != 0)
+    {
+        fail("not a checkpoint file");
+    }
+    if (read<uint32_t>() != Checkpoint::formatVersion)
+    {
+        fail("unsupported checkpoint format version");
+    }
+}
+
+CheckpointReader::~CheckpointReader()
+{
+    std::fclose(file);
+}
+
+void CheckpointReader::expectTag(const char *tag)
+{
+    char fileTag[tagLength];
+    readBytes(fileTag, tagLength);
+    if (std::memcmp(fileTag, tag, tagLength) != 0)
+    {
+        fail(std::string("expected section ") + std::string(tag, tagLength));
+    }
+}
+
+void CheckpointReader::readBytes(void *data, size_t size)
+{
+    if (size > 0 && std::fread(data, 1, size, file) != size)
+    {
+        fail("unexpected end of file");
+    }
+}
+
+void CheckpointReader::fail(const std::string &reason) const
+{
+    throw std::runtime_error("Cannot restart from " + fileName + ": " + reason);
+}
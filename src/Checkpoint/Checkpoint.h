@@ -0,0 +1,150 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_CHECKPOINT_H
+#define ACTIVE_MICROEMULSION_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Binary checkpoints of the simulation state. A checkpoint is a header (magic and format version) followed by
+ * sections, each opened by a 4-character tag so that reading the sections in the wrong order, or a file of another
+ * version, fails loudly instead of resuming from garbage. Values are stored in the native byte order and layout:
+ * checkpoints are meant to be read back by the same build on the same kind of machine.
+ * Every class with state to save has a writeCheckpoint(CheckpointWriter &) and readCheckpoint(CheckpointReader &)
+ * pair, which must write and read the same values in the same order. I/O errors throw std::runtime_error.
+ */
+namespace Checkpoint
+{
+    static const char magic[8] = {'A', 'M', 'E', 'C', 'K', 'P', 'T', '\0'};
+    static const uint32_t formatVersion = 4; // 2: analysis series (ANLS section), 3: run summary (SMRY),
+                                             // 4: next chemistry event (MEMU)
+}
+
+class CheckpointWriter
+{
+private:
+    std::string fileName, temporaryFileName;
+    std::FILE *file;
+
+public:
+    /**
+     * Start writing a checkpoint to the given file. Data goes to a temporary file next to it, which replaces the
+     * given one only on commit(): an interrupted write never spoils the previous checkpoint.
+     */
+    explicit CheckpointWriter(const std::string &fileName);
+    
+    ~CheckpointWriter();
+    
+    CheckpointWriter(CheckpointWriter const &) = delete;
+    void operator=(CheckpointWriter const &) = delete;
+    
+    void writeTag(const char *tag);
+    
+    template<typename T>
+    void write(const T &value)
+    {
+        writeArray(&value, 1);
+    }
+    
+    template<typename T>
+    void writeArray(const T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be checkpointed");
+        writeBytes(values, count * sizeof(T));
+    }
+    
+    template<typename T>
+    void writeVector(const std::vector<T> &values)
+    {
+        write(static_cast<uint64_t>(values.size()));
+        writeArray(values.data(), values.size());
+    }
+    
+    template<typename T>
+    void writeSet(const std::set<T> &values)
+    {
+        writeVector(std::vector<T>(values.begin(), values.end()));
+    }
+    
+    // Close the file and move it in place of the previous checkpoint.
+    void commit();
+
+private:
+    void writeBytes(const void *data, size_t size);
+};
+
+class CheckpointReader
+{
+private:
+    std::string fileName;
+    std::FILE *file;
+
+public:
+    explicit CheckpointReader(const std::string &fileName);
+    
+    ~CheckpointReader();
+    
+    CheckpointReader(CheckpointReader const &) = delete;
+    void operator=(CheckpointReader const &) = delete;
+    
+    void expectTag(const char *tag);
+    
+    template<typename T>
+    T read()
+    {
+        T value;
+        readArray(&value, 1);
+        return value;
+    }
+    
+    template<typename T>
+    void readArray(T *values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be checkpointed");
+        readBytes(values, count * sizeof(T));
+    }
+    
+    template<typename T>
+    void readVector(std::vector<T> &values)
+    {
+        values.resize(static_cast<size_t>(read<uint64_t>()));
+        readArray(values.data(), values.size());
+    }
+    
+    template<typename T>
+    void readSet(std::set<T> &values)
+    {
+        std::vector<T> elements;
+        readVector(elements);
+        values = std::set<T>(elements.begin(), elements.end());
+    }
+    
+    // Throw if the value read differs from the expected one, e.g. a grid size given on the command line.
+    template<typename T>
+    void expectValue(const T &expectedValue, const char *name)
+    {
+        if (read<T>() != expectedValue)
+        {
+            fail(std::string("checkpoint does not match the current setup for ") + name);
+        }
+    }
+    
+    const std::string &getFileName() const
+    {
+        return fileName;
+    }
+
+private:
+    void readBytes(void *data, size_t size);
+    
+    void fail(const std::string &reason) const;
+};
+
+#endif //ACTIVE_MICROEMULSION_CHECKPOINT_H
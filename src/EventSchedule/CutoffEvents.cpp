@@ -0,0 +1,59 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "CutoffEvents.h"
+#include "EventSchedule.cpp" // Since template implementation is here
+
+void applyCutoffEvents(Logger &logger, EventSchedule<CutoffEvent> &eventSchedule, Microemulsion &microemulsion,
+                       const std::set<ChainId> &allChains, const std::set<ChainId> &cutoffChains,
+                       const std::set<ChainId> &permissibleChains, double kOn, double kOff, double kChromPlus,
+                       double kChromMinus, double kRnaPlus, double kRnaMinus, double kRnaTransfer, double t,
+                       double timeMultiplier)
+{
+    // TODO: we should be using the command pattern for all events...
+    auto eventsToApply = eventSchedule.popEventsToApply(t);
+    for (auto event : eventsToApply)
+    {
+        if (event == FLAVOPIRIDOL)
+        {
+            logger.logEvent(PRODUCTION, t/timeMultiplier, "EVENT: Applying Flavopiridol condition");
+            microemulsion.setKChromPlus(0);
+        }
+        else if (event == ACTINOMYCIN_D)
+        {
+            logger.logEvent(PRODUCTION, t/timeMultiplier, "EVENT: Applying Actinomycin D condition");
+            microemulsion.setKChromPlus(0); // Chromatin state no longer changes
+            microemulsion.setKChromMinus(0); // Chromatin state no longer changes
+            microemulsion.setKRnaPlus(0); // RNA production is halted
+            microemulsion.setKRnaMinusTxn(0); // RNA attached at transcription site is not degraded
+            microemulsion.setKRnaTransfer(0); // RNA should not be transferred from TXN sites to RBP
+        }
+        else if (event == ACTIVATE)
+        {
+            logger.logEvent(PRODUCTION, t/timeMultiplier, "EVENT: Activating transcription");
+            microemulsion.setKOn(kOn);
+            microemulsion.setKOff(kOff);
+            microemulsion.setKChromPlus(kChromPlus);
+            microemulsion.setKChromMinus(kChromMinus);
+            microemulsion.setKRnaPlus(kRnaPlus);
+            microemulsion.setKRnaMinusRbp(kRnaMinus);
+            microemulsion.setKRnaMinusTxn(0);
+            microemulsion.setKRnaTransfer(kRnaTransfer);
+        }
+        else if (event == TXN_SPIKE)
+        {
+            // NOTE: transcription spike DOES NOT include activation
+            logger.logEvent(PRODUCTION, t/timeMultiplier, "EVENT: Transcription spike");
+            microemulsion.enableTranscribabilityOnChains(permissibleChains);
+        }
+        else
+        {
+            // Testing playground here...
+            logger.logEvent(PRODUCTION, t/timeMultiplier, "EVENT: Applying custom cutoff conditions");
+//            microemulsion.setKRnaMinusRbp(0);
+            microemulsion.enablePermissivityOnChains(allChains);
+            microemulsion.disablePermissivityOnChains(cutoffChains);
+        }
+    }
+}
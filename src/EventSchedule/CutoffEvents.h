@@ -0,0 +1,24 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_CUTOFFEVENTS_H
+#define ACTIVE_MICROEMULSION_CUTOFFEVENTS_H
+
+#include <set>
+#include "../Logger/Logger.h"
+#include "../Microemulsion/Microemulsion.h"
+#include "EventSchedule.h"
+
+/**
+ * Apply the cutoff events scheduled up to time t, changing the rates and chain properties of the microemulsion.
+ * @param t The simulation time, in the same units as the schedule (i.e. already multiplied by timeMultiplier).
+ * @param timeMultiplier The factor from the user time units to simulation time, only used to log in user units.
+ */
+void applyCutoffEvents(Logger &logger, EventSchedule<CutoffEvent> &eventSchedule, Microemulsion &microemulsion,
+                       const std::set<ChainId> &allChains, const std::set<ChainId> &cutoffChains,
+                       const std::set<ChainId> &permissibleChains, double kOn, double kOff, double kChromPlus,
+                       double kChromMinus, double kRnaPlus, double kRnaMinus, double kRnaTransfer, double t,
+                       double timeMultiplier);
+
+#endif //ACTIVE_MICROEMULSION_CUTOFFEVENTS_H
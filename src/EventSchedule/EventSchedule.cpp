@@ -93,3 +93,36 @@ double EventSchedule<EventType>::getNextEventTime() const
 {
     return nextEventTime;
 }
+
+template<typename EventType>
+void EventSchedule<EventType>::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("EVTS");
+    writer.write(static_cast<uint64_t>(schedule.size()));
+    for (auto it = schedule.begin(); it != schedule.end(); ++it)
+    {
+        writer.write(it->first);
+        writer.writeVector(it->second);
+    }
+}
+
+template<typename EventType>
+void EventSchedule<EventType>::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("EVTS");
+    schedule.clear();
+    auto numEventTimes = reader.read<uint64_t>();
+    for (uint64_t i = 0; i < numEventTimes; ++i)
+    {
+        double time = reader.read<double>();
+        reader.readVector(schedule[time]);
+    }
+    if (schedule.empty())
+    {
+        nextEventTime = std::numeric_limits<double>::max();
+    }
+    else
+    {
+        nextEventTime = schedule.begin()->first;
+    }
+}
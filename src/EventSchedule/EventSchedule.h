@@ -8,6 +8,7 @@
 #include <map>
 #include <vector>
 #include <limits>
+#include "../Checkpoint/Checkpoint.h"
 
 typedef enum CutoffEvent
 {
@@ -25,7 +26,8 @@ typedef enum SnapshotEvent
     ACTIVATE_SNAPSHOT,
     FLAVOPIRIDOL_SNAPSHOT,
     ACTINOMYCIN_D_SNAPSHOT,
-    CUSTOM_EVENT_SNAPSHOT
+    CUSTOM_EVENT_SNAPSHOT,
+    ANALYSIS_SNAPSHOT // Analysis only, no images
 } SnapshotEvent;
 
 template <typename EventType>
@@ -59,6 +61,11 @@ public:
     double getLastEventTime();
     
     unsigned long size();
+    
+    // Save and restore the events still to apply.
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
 };
 
 
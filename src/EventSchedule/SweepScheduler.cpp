@@ -0,0 +1,47 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <cmath>
+#include <limits>
+#include "SweepScheduler.h"
+
+constexpr double SweepScheduler::roundTolerance;
+
+SweepScheduler::SweepScheduler(double roundsPerUnitTime)
+        : roundsPerUnitTime(roundsPerUnitTime), round(0), time(0)
+{}
+
+unsigned int SweepScheduler::getRoundsUntil(double targetTime) const
+{
+    double rounds = std::ceil(targetTime * roundsPerUnitTime - roundTolerance) - static_cast<double>(round);
+    const double maxRounds = std::numeric_limits<unsigned int>::max();
+    return static_cast<unsigned int>(std::fmax(1, std::fmin(rounds, maxRounds)));
+}
+
+double SweepScheduler::advance(unsigned int rounds, double targetTime)
+{
+    round += rounds;
+    time = round / roundsPerUnitTime;
+    if (time < targetTime && (targetTime - time) * roundsPerUnitTime <= roundTolerance)
+    {
+        time = targetTime;
+    }
+    return time;
+}
+
+void SweepScheduler::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("SWPS");
+    writer.write(roundsPerUnitTime);
+    writer.write(round);
+    writer.write(time);
+}
+
+void SweepScheduler::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("SWPS");
+    reader.expectValue(roundsPerUnitTime, "the swap rounds per unit time");
+    round = reader.read<uint64_t>();
+    time = reader.read<double>();
+}
@@ -0,0 +1,55 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_SWEEPSCHEDULER_H
+#define ACTIVE_MICROEMULSION_SWEEPSCHEDULER_H
+
+#include <cstdint>
+#include "../Checkpoint/Checkpoint.h"
+
+/*
+ * Clock of the swap sweep. Time advances by whole sweep rounds, each taking 1/roundsPerUnitTime, and is kept as a
+ * count of rounds so that it does not drift. For each interval up to the next time something else has to happen
+ * (chemistry, cutoff event, snapshot), the scheduler gives the exact number of rounds to run in one batch.
+ */
+class SweepScheduler
+{
+private:
+    const double roundsPerUnitTime;
+    uint64_t round;
+    double time;
+    // Round boundaries closer than this (in rounds) to a target time count as on it, against rounding errors
+    static constexpr double roundTolerance = 1e-6;
+
+public:
+    explicit SweepScheduler(double roundsPerUnitTime);
+    
+    inline double getTime() const
+    {
+        return time;
+    }
+    
+    inline uint64_t getRound() const
+    {
+        return round;
+    }
+    
+    /**
+     * Number of rounds to run to reach the given time, i.e. up to the first round boundary not before it.
+     * At least one round, so that the clock always moves.
+     */
+    unsigned int getRoundsUntil(double targetTime) const;
+    
+    /**
+     * Account for the given rounds, run towards the given target time.
+     * @return The new time: the target time itself if the rounds reached it.
+     */
+    double advance(unsigned int rounds, double targetTime);
+    
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+};
+
+#endif //ACTIVE_MICROEMULSION_SWEEPSCHEDULER_H
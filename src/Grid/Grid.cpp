@@ -9,32 +9,32 @@
 #include "Grid.h"
 #include "../Utils/RandomGenerator.h"
 
-std::mt19937 Grid::randomNumberGenerator = RandomGenerator::getInstance().getGenerator();
+RandomEngine Grid::randomNumberGenerator = RandomGenerator::getInstance().getGenerator();
+
+const signed char Grid::directionOffsets[8][2] = {{-1, -1}, {0, -1}, {1, -1},
+                                                  {-1, 0}, {1, 0},
+                                                  {-1, 1}, {0, 1}, {1, 1}};
 
-// NOTE: nice alloc and dealloc come from https://stackoverflow.com/a/1403157
 void Grid::allocateGrid()
 {
-    int extendedRows = rows + 2;
-    int extendedColumns = columns + 2;
-    data = new CellData *[extendedRows];
-    data[0] = new CellData[extendedRows * extendedColumns](); // "()" at the end ensure initialization to 0
-//    #pragma omp parallel for schedule(static) //first touch on grid
-    for (int i = 1; i < extendedRows - 1; ++i)
-    {
-        data[i] = data[0] + i * extendedColumns;
-//        memset(data[i], 0, static_cast<size_t>(extendedColumns));
-    }
-    data[extendedRows - 1] = data[0] + (extendedRows - 1) * extendedColumns;
+    int extendedElements = extendedRows * extendedColumns;
+    state = new CellState[extendedElements](); // "()" at the end ensure initialization to 0
+    rnaContent = new RnaCounter[extendedElements]();
+    chainSlotIndex = new ChainSlotIndex[extendedElements]();
+    chainSlots.clear();
 }
 
 void Grid::deallocateGrid()
 {
-    delete[] data[0];
-    delete[] data;
+    delete[] state;
+    delete[] rnaContent;
+    delete[] chainSlotIndex;
 }
 
 Grid::Grid(int columns, int rows, Logger &logger) : columns(columns),
                                                     rows(rows),
+                                                    extendedColumns(columns + 2),
+                                                    extendedRows(rows + 2),
                                                     numElements(columns * rows),
                                                     rowDistribution(1, rows),
                                                     columnDistribution(1, columns),
@@ -46,7 +46,9 @@ Grid::Grid(int columns, int rows, Logger &logger) : columns(columns),
     #pragma omp parallel for schedule(static,1)
     for (int i=0; i < omp_get_num_threads(); ++i)
     {
-        randomNumberGenerator = RandomGenerator::getInstance().getGenerator();
+        // Each thread gets its own stream, copies of the shared engine would all produce the same numbers
+        randomNumberGenerator = RandomGenerator::getInstance().createGenerator(
+                static_cast<unsigned int>(omp_get_thread_num()));
     }
     allocateGrid();
 }
@@ -56,9 +58,40 @@ Grid::~Grid()
     deallocateGrid();
 }
 
-const CellData **Grid::getData()
+const CellState *Grid::getStatePlane() const
+{
+    return state;
+}
+
+const RnaCounter *Grid::getRnaContentPlane() const
+{
+    return rnaContent;
+}
+
+void Grid::writeCheckpoint(CheckpointWriter &writer) const
 {
-    return const_cast<const CellData **>(data);
+    writer.writeTag("GRID");
+    writer.write(columns);
+    writer.write(rows);
+    int extendedElements = extendedRows * extendedColumns;
+    writer.writeArray(state, static_cast<size_t>(extendedElements));
+    writer.writeArray(rnaContent, static_cast<size_t>(extendedElements));
+    writer.writeArray(chainSlotIndex, static_cast<size_t>(extendedElements));
+    writer.writeVector(chainSlots);
+    writer.write(nextAvailableChainId);
+}
+
+void Grid::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("GRID");
+    reader.expectValue(columns, "the grid width");
+    reader.expectValue(rows, "the grid height");
+    int extendedElements = extendedRows * extendedColumns;
+    reader.readArray(state, static_cast<size_t>(extendedElements));
+    reader.readArray(rnaContent, static_cast<size_t>(extendedElements));
+    reader.readArray(chainSlotIndex, static_cast<size_t>(extendedElements));
+    reader.readVector(chainSlots);
+    nextAvailableChainId = reader.read<ChainId>();
 }
 
 inline int Grid::pickRow()
@@ -119,17 +152,27 @@ void Grid::initializeCellProperties(int column, int row, ChemicalProperties chem
 
 void Grid::setChemicalSpecies(int column, int row, ChemicalSpecies species)
 {
-    getElement(column, row).setChemicalSpecies(species);
+    CellData cellData = getElement(column, row);
+    cellData.setChemicalSpecies(species);
+    setState(getIndex(column, row), cellData.chemicalProperties, cellData.flags);
 }
 
 void Grid::setActivity(int column, int row, Activity activity)
 {
-    getElement(column, row).setActivity(activity);
+    setActivity(getIndex(column, row), activity);
+}
+
+void Grid::setActivity(int index, Activity activity)
+{
+    ChemicalProperties chemicalProperties = getChemicalProperties(index);
+    CellData::setActivity(chemicalProperties, activity);
+    setState(index, chemicalProperties, getFlags(index));
 }
 
 void Grid::setChemicalProperties(int column, int row, ChemicalSpecies species, Activity activity)
 {
-    getElement(column, row).setChemicalProperties(species, activity);
+    int index = getIndex(column, row);
+    setState(index, CellData::chemicalPropertiesOf(species, activity), getFlags(index));
 }
 
 void Grid::setChemicalProperties(int column, int row, ChemicalProperties chemicalProperties)
@@ -141,44 +184,64 @@ void Grid::setChemicalProperties(int column, int row, ChemicalProperties chemica
 
 void Grid::setFlags(int column, int row, Flags flags)
 {
-    getElement(column, row).flags = flags;
+    int index = getIndex(column, row);
+    setState(index, getChemicalProperties(index), flags);
 }
 
 void Grid::setTranscribability(int column, int row, Transcribability transcribability)
 {
-    getElement(column, row).setTranscribability(transcribability);
+    setTranscribability(getIndex(column, row), transcribability);
+}
+
+void Grid::setTranscribability(int index, Transcribability transcribability)
+{
+    Flags flags = getFlags(index);
+    CellData::setTranscribability(flags, transcribability);
+    setState(index, getChemicalProperties(index), flags);
 }
 
 void Grid::setTranscriptionInhibition(int column, int row, TranscriptionInhibition inhibition)
 {
-    getElement(column, row).setTranscriptionInhibition(inhibition);
+    int index = getIndex(column, row);
+    Flags flags = getFlags(index);
+    CellData::setTranscriptionInhibition(flags, inhibition);
+    setState(index, getChemicalProperties(index), flags);
 }
 
-CellData &Grid::getElement(int elementId)
+CellData Grid::getElement(int elementId) const
 {
-    return data[0][elementId]; // data[0] is the pointer to the array storing the entire grid in 1D
+    return CellData(state[elementId], rnaContent[elementId]);
 }
 
-CellData &Grid::getElement(int column, int row)
+CellData Grid::getElement(int column, int row) const
 {
-    return data[row][column];
+    return getElement(getIndex(column, row));
 }
 
-CellData &Grid::getElement(int column, int row) const
+void Grid::setElement(int column, int row, const CellData &value)
 {
-    return data[row][column];
+    int index = getIndex(column, row);
+    setState(index, value.chemicalProperties, value.flags);
+    rnaContent[index] = value.getRnaContent();
 }
 
-void Grid::setElement(int column, int row, CellData &value)
+ChainProperties *Grid::getOrCreateChainProperties(int column, int row)
 {
-    data[row][column] = value;
+    int index = getIndex(column, row);
+    if (!CellData::hasChain(state[index]))
+    {
+        chainSlots.resize(chainSlots.size() + MAX_CROSSING_CHAINS);
+        chainSlotIndex[index] = static_cast<ChainSlotIndex>(chainSlots.size() / MAX_CROSSING_CHAINS - 1);
+        state[index] |= CHAIN_MARKER_MASK;
+    }
+    return getChainProperties(index);
 }
 
 size_t Grid::setChainProperties(int column, int row, ChainId chainId, unsigned int position, unsigned int length)
 {
-    CellData &element = getElement(column, row);
+    ChainProperties *cellChains = getOrCreateChainProperties(column, row);
     int k = 0;
-    while (element.chainProperties[k].chainLength != 0 && k < MAX_CROSSING_CHAINS)
+    while (k < MAX_CROSSING_CHAINS && cellChains[k].chainLength != 0)
     {
         ++k;
     }
@@ -189,19 +252,104 @@ size_t Grid::setChainProperties(int column, int row, ChainId chainId, unsigned i
         throw std::out_of_range("Trying to get too many chains to cross");
     }
     
-    element.chainProperties[k].chainId = chainId;
-    element.chainProperties[k].position = position;
-    element.chainProperties[k].chainLength = length;
+    cellChains[k].chainId = chainId;
+    cellChains[k].position = position;
+    cellChains[k].chainLength = length;
+    linkChainNeighbourMasks(column, row, cellChains[k]);
     
     return static_cast<size_t>(k);
 }
 
+ChainProperties *Grid::findChainProperties(int column, int row, ChainId chainId)
+{
+    unsigned char k = cellBelongsToChain(column, row, chainId);
+    return isPositionInChainPropertiesArrayValid(k) ? getChainProperties(getIndex(column, row)) + k : nullptr;
+}
+
+void Grid::linkChainNeighbourMasks(int column, int row, ChainProperties &chainProperties)
+{
+    for (auto &offset : directionOffsets)
+    {
+        int dx = offset[0], dy = offset[1];
+        ChainProperties *neighbour = findChainProperties(column + dx, row + dy, chainProperties.chainId);
+        if (neighbour != nullptr
+            && (neighbour->position == chainProperties.position + 1
+                || chainProperties.position == neighbour->position + 1))
+        {
+            chainProperties.neighbourMask |= getDirectionMask(dx, dy);
+            neighbour->neighbourMask |= getDirectionMask(-dx, -dy);
+        }
+    }
+}
+
+void Grid::moveChainNeighbourMasks(int column, int row, int nColumn, int nRow)
+{
+    const int cells[2][2] = {{column, row},
+                             {nColumn, nRow}};
+    // First detach both cells from their chain neighbours, then attach them at their destination.
+    // The two cells may share a chain neighbour, so doing both steps one cell at a time could clear a fresh bit.
+    for (auto &cell : cells)
+    {
+        int x = cell[0], y = cell[1];
+        if (!hasChain(x, y))
+        {
+            continue;
+        }
+        ChainProperties *chains = getChainProperties(getIndex(x, y));
+        for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
+        {
+            for (int d = 0; d < 8; ++d)
+            {
+                if (chains[k].neighbourMask & (1U << d))
+                {
+                    int dx = directionOffsets[d][0], dy = directionOffsets[d][1];
+                    ChainProperties *neighbour = findChainProperties(x + dx, y + dy, chains[k].chainId);
+                    assert(neighbour != nullptr);
+                    neighbour->neighbourMask &= ~getDirectionMask(-dx, -dy);
+                }
+            }
+        }
+    }
+    for (int c = 0; c < 2; ++c)
+    {
+        int x = cells[c][0], y = cells[c][1];
+        int moveX = cells[1 - c][0] - x, moveY = cells[1 - c][1] - y;
+        if (!hasChain(x, y))
+        {
+            continue;
+        }
+        ChainProperties *chains = getChainProperties(getIndex(x, y));
+        for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
+        {
+            NeighbourMask movedMask = 0;
+            for (int d = 0; d < 8; ++d)
+            {
+                if (chains[k].neighbourMask & (1U << d))
+                {
+                    int dx = directionOffsets[d][0], dy = directionOffsets[d][1];
+                    // Chain legality of the swap guarantees the neighbour is still adjacent after the move
+                    assert(std::abs(dx - moveX) <= 1 && std::abs(dy - moveY) <= 1);
+                    ChainProperties *neighbour = findChainProperties(x + dx, y + dy, chains[k].chainId);
+                    neighbour->neighbourMask |= getDirectionMask(moveX - dx, moveY - dy);
+                    movedMask |= getDirectionMask(dx - moveX, dy - moveY);
+                }
+            }
+            chains[k].neighbourMask = movedMask;
+        }
+    }
+}
+
 unsigned char Grid::cellBelongsToChain(int column, int row, ChainId chainId)
 {
     unsigned char found = MAX_CROSSING_CHAINS;
+    if (!hasChain(column, row))
+    {
+        return found;
+    }
+    const ChainProperties *cellChains = getChainProperties(getIndex(column, row));
     for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
     {
-        if (getElement(column, row).chainProperties[k].chainId == chainId)
+        if (cellChains[k].chainId == chainId)
         {
             found = k;
             break;
@@ -225,7 +373,7 @@ bool Grid::isCellNeighbourInChain(int column, int row, const ChainProperties &ch
     {
         // Then check if it is actually a neighbour within the given chain
         unsigned int neighbourPositionInChain =
-                getElement(column, row).chainProperties[pos].position;
+                getChainProperties(getIndex(column, row))[pos].position;
         unsigned int currentCellPositionInChain = chainProperties.position;
         int distance = neighbourPositionInChain - currentCellPositionInChain;
         isNeighbourInChain = (distance == 1) || (distance == -1);
@@ -251,9 +399,14 @@ bool Grid::isCellNeighbourInAnyChain(int column, int row,
 std::vector<std::reference_wrapper<ChainProperties>> Grid::chainsCellBelongsTo(int column, int row)
 {
     auto chains = std::vector<std::reference_wrapper<ChainProperties>>();
+    if (!hasChain(column, row))
+    {
+        return chains;
+    }
+    ChainProperties *cellChains = getChainProperties(getIndex(column, row));
     for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
     {
-        ChainProperties &chainProperties = getElement(column, row).chainProperties[k];
+        ChainProperties &chainProperties = cellChains[k];
         unsigned int chainLength = chainProperties.chainLength;
         if (chainLength > 0)
         {
@@ -263,6 +416,24 @@ std::vector<std::reference_wrapper<ChainProperties>> Grid::chainsCellBelongsTo(i
     return chains;
 }
 
+std::set<ChainId> Grid::chainIdsCellBelongsTo(int column, int row) const
+{
+    auto chainIdSet = std::set<ChainId>();
+    if (!hasChain(column, row))
+    {
+        return chainIdSet;
+    }
+    const ChainProperties *cellChains = getChainProperties(getIndex(column, row));
+    for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
+    {
+        if (cellChains[k].chainLength > 0)
+        {
+            chainIdSet.insert(cellChains[k].chainId);
+        }
+    }
+    return chainIdSet;
+}
+
 ChainId Grid::getNewChainId()
 {
     logger.logMsg(PRODUCTION, "Initializing new chain with chainId=%d", nextAvailableChainId);
@@ -282,37 +453,37 @@ int Grid::getSpeciesCount(ChemicalSpecies chemicalSpecies)
     return counter;
 }
 
-bool Grid::doesAnyNeighbourMatchCondition(int column, int row, bool (*condition)(CellData &))
+bool Grid::doesAnyNeighbourMatchCondition(int column, int row, bool (*condition)(ChemicalProperties))
 {
-    return condition(getElement(column - 1, row - 1))
-           || condition(getElement(column, row - 1))
-           || condition(getElement(column + 1, row - 1))
-           || condition(getElement(column - 1, row))
-           || condition(getElement(column + 1, row))
-           || condition(getElement(column - 1, row + 1))
-           || condition(getElement(column, row + 1))
-           || condition(getElement(column + 1, row + 1));
+    return condition(getChemicalProperties(column - 1, row - 1))
+           || condition(getChemicalProperties(column, row - 1))
+           || condition(getChemicalProperties(column + 1, row - 1))
+           || condition(getChemicalProperties(column - 1, row))
+           || condition(getChemicalProperties(column + 1, row))
+           || condition(getChemicalProperties(column - 1, row + 1))
+           || condition(getChemicalProperties(column, row + 1))
+           || condition(getChemicalProperties(column + 1, row + 1));
 }
 
-std::vector<std::reference_wrapper<CellData>>
-Grid::getNeighboursMatchingConditions(int column, int row, bool (*condition)(CellData &))
+unsigned char Grid::getNeighboursMatchingConditions(int column, int row, bool (*condition)(ChemicalProperties),
+                                                    int *neighbourIndices) const
 {
-    auto neighboursMatchingCondition = std::vector<std::reference_wrapper<CellData>>();
+    unsigned char numMatching = 0;
     for (int colOffset = -1; colOffset <= 1; ++colOffset)
     {
         for (int rowOffset = -1; rowOffset <= 1; ++rowOffset)
         {
             if (!(colOffset == 0 && rowOffset == 0))
             {
-                CellData &neighbour = getElement(column + colOffset, row + rowOffset);
-                if (condition(neighbour))
+                int neighbourIndex = getIndex(column + colOffset, row + rowOffset);
+                if (condition(getChemicalProperties(neighbourIndex)))
                 {
-                    neighboursMatchingCondition.push_back(neighbour);
+                    neighbourIndices[numMatching++] = neighbourIndex;
                 }
             }
         }
     }
-    return neighboursMatchingCondition;
+    return numMatching;
 }
 
 bool Grid::isPositionNextToBoundary(int column, int row)
@@ -5,13 +5,19 @@
 #ifndef ACTIVE_MICROEMULSION_GRID_H
 #define ACTIVE_MICROEMULSION_GRID_H
 
+#include <cstdint>
 #include <random>
 #include <functional>
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <limits>
 #include <omp.h>
 #include "../Cell/CellData.h"
 #include "../Logger/Logger.h"
 #include "../Utils/RandomGenerator.h"
+#include "../Checkpoint/Checkpoint.h"
 
 class GridInitializer;
 
@@ -19,6 +25,10 @@ class GridInitializer;
  * The Grid class represents a discretized domain with a regular grid.
  * It supports the allocation/destruction of the matrix, it retains the grid properties (e.g. index ranges) and
  * it has a method for getting a random (uniformly distributed) element of the domain.
+ *
+ * Cells are stored as a structure of arrays: a byte plane with the packed chemical properties, flags and chain
+ * marker, a plane with the RNA content and a side table with the chain properties of chain cells. Swaps and
+ * chemistry only touch the first two planes unless chains are involved.
  */
 class Grid
 {
@@ -28,10 +38,16 @@ private:
 //    const unsigned char dim = 2;
     // Columns and rows are the values of the inner number of rows and columns, without the external halo.
     const int columns, rows;
-    static std::mt19937 randomNumberGenerator;
+    const int extendedColumns, extendedRows;
+    static RandomEngine randomNumberGenerator;
     #pragma omp threadprivate(randomNumberGenerator)
     int numElements;
-    CellData **data;
+    CellState *state;
+    RnaCounter *rnaContent;
+    // Chain membership is sparse: only cells carrying the chain marker own an entry in the slab,
+    // made of MAX_CROSSING_CHAINS consecutive slots. The slab index travels with the cell on swaps.
+    ChainSlotIndex *chainSlotIndex;
+    std::vector<ChainProperties> chainSlots;
     std::uniform_int_distribution<int> rowDistribution, columnDistribution, elementDistribution,
             rowColOffsetDistribution;
     Logger &logger;
@@ -66,30 +82,142 @@ public:
         return columns;
     }
     
+    inline int getExtendedColumns() const
+    {
+        return extendedColumns;
+    }
+    
+    inline int getExtendedRows() const
+    {
+        return extendedRows;
+    }
+    
     bool isCellWithinInternalDomain(int column, int row);
     
-    const CellData **getData();
+    /**
+     * Get the 1D index (halo included) of the cell with given coordinates.
+     */
+    inline int getIndex(int column, int row) const
+    {
+        return row * extendedColumns + column;
+    }
+    
+    inline int getColumnOfIndex(int index) const
+    {
+        return index % extendedColumns;
+    }
+    
+    inline int getRowOfIndex(int index) const
+    {
+        return index / extendedColumns;
+    }
+    
+    // True if the index is not in the halo.
+    inline bool isInnerIndex(int index) const
+    {
+        int column = getColumnOfIndex(index), row = getRowOfIndex(index);
+        return column >= 1 && column <= columns && row >= 1 && row <= rows;
+    }
+    
+    const CellState *getStatePlane() const;
+    
+    const RnaCounter *getRnaContentPlane() const;
+    
+    // Save and restore all the cells, chain properties included. A grid is only restored into one of the same size.
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
     
     /**
-     * Get an element reference by using a 1D id.
+     * Get an element by using a 1D id.
      * @param elementId
-     * @return
+     * @return An unpacked copy of the cell.
      */
-    CellData &getElement(int elementId);
- 
-    CellData &getElement(int column, int row);
+    CellData getElement(int elementId) const;
     
-    CellData &getElement(int column, int row) const;
+    CellData getElement(int column, int row) const;
     
-    void setElement(int column, int row, CellData &value);
+    // Set state and RNA content of a cell, chain properties are left untouched.
+    void setElement(int column, int row, const CellData &value);
+    
+    /**
+     * Swap two cells, including their chain properties.
+     * The swap must be legal with respect to chains, i.e. after it every chain cell must still have its chain
+     * neighbours within its Moore neighbourhood, since chain neighbour masks are updated incrementally.
+     */
+    inline void swapElements(int column, int row, int nColumn, int nRow)
+    {
+        int index = getIndex(column, row);
+        int nIndex = getIndex(nColumn, nRow);
+        if (CellData::hasChain(state[index]) || CellData::hasChain(state[nIndex]))
+        {
+            moveChainNeighbourMasks(column, row, nColumn, nRow);
+        }
+        std::swap(state[index], state[nIndex]);
+        std::swap(rnaContent[index], rnaContent[nIndex]);
+        std::swap(chainSlotIndex[index], chainSlotIndex[nIndex]);
+    }
     
     void pickRandomElement(int &i, int &j);
     
     void pickRandomNeighbourOf(int i, int j, int &neighbourI, int &neighbourJ);
     
+    /**
+     * Same as above, as an exact draw out of a single 32-bit random word: its top three bits select among the 8
+     * neighbours of inner cells, a multiply-shift among the 3 or 5 neighbours of cells on the grid edge.
+     */
+    inline void pickRandomNeighbourOf(int i, int j, int &neighbourI, int &neighbourJ, uint32_t randomWord) const
+    {
+        int direction;
+        if (i > 1 && i < columns && j > 1 && j < rows)
+        {
+            direction = randomWord >> 29;
+        }
+        else
+        {
+            int validDirections[8], numValidDirections = 0;
+            for (int d = 0; d < 8; ++d)
+            {
+                int ni = i + directionOffsets[d][0], nj = j + directionOffsets[d][1];
+                if (ni >= 1 && ni <= columns && nj >= 1 && nj <= rows)
+                {
+                    validDirections[numValidDirections++] = d;
+                }
+            }
+            direction = validDirections[(static_cast<uint64_t>(randomWord) * numValidDirections) >> 32];
+        }
+        neighbourI = i + directionOffsets[direction][0];
+        neighbourJ = j + directionOffsets[direction][1];
+    }
+    
+    inline CellState getState(int index) const
+    {
+        return state[index];
+    }
+    
+    inline CellState getState(int column, int row) const
+    {
+        return getState(getIndex(column, row));
+    }
+    
+    inline bool hasChain(int index) const
+    {
+        return CellData::hasChain(getState(index));
+    }
+    
+    inline bool hasChain(int column, int row) const
+    {
+        return hasChain(getIndex(column, row));
+    }
+    
+    inline ChemicalProperties getChemicalProperties(int index) const
+    {
+        return CellData::chemicalPropertiesOf(getState(index));
+    }
+    
     inline ChemicalProperties getChemicalProperties(int column, int row) const
     {
-        return getElement(column, row).getChemicalProperties();
+        return getChemicalProperties(getIndex(column, row));
     }
     
     inline ChemicalSpecies getChemicalSpecies(int column, int row) const
@@ -97,30 +225,93 @@ public:
         return CellData::getChemicalSpecies(getChemicalProperties(column, row));
     }
     
-    inline bool isChromatin(int column, int row)
+    inline bool isChromatin(int index) const
+    {
+        return CellData::isChromatin(getChemicalProperties(index));
+    }
+    
+    inline bool isChromatin(int column, int row) const
+    {
+        return isChromatin(getIndex(column, row));
+    }
+    
+    inline bool isRBP(int index) const
+    {
+        return CellData::isRBP(getChemicalProperties(index));
+    }
+    
+    inline bool isActive(int index) const
+    {
+        return CellData::isActive(getChemicalProperties(index));
+    }
+    
+    inline bool isActiveChromatin(int index) const
+    {
+        return CellData::isActiveChromatin(getChemicalProperties(index));
+    }
+    
+    inline bool isActiveRBP(int index) const
+    {
+        return CellData::isActiveRBP(getChemicalProperties(index));
+    }
+    
+    inline bool isInactiveChromatin(int column, int row) const
     {
-        return getElement(column, row).isChromatin();
+        return CellData::isInactiveChromatin(getChemicalProperties(column, row));
     }
     
-    inline bool isInactiveChromatin(int column, int row)
+    inline Flags getFlags(int index) const
     {
-        return getElement(column, row).isInactiveChromatin();
+        return CellData::flagsOf(getState(index));
     }
     
     inline Flags getFlags(int column, int row) const
     {
-        return getElement(column, row).getFlags();
+        return getFlags(getIndex(column, row));
+    }
+    
+    inline bool isTranscribable(int index) const
+    {
+        return CellData::isTranscribable(getFlags(index));
+    }
+    
+    inline bool isTranscriptionInhibited(int index) const
+    {
+        return CellData::isTranscriptionInhibited(getFlags(index));
+    }
+    
+    inline RnaCounter getRnaContent(int index) const
+    {
+        return rnaContent[index];
+    }
+    
+    inline RnaCounter getRnaContent(int column, int row) const
+    {
+        return getRnaContent(getIndex(column, row));
+    }
+    
+    // Saturating: RNA beyond the range of RnaCounter is lost instead of wrapping the count around to a few units
+    inline void incrementRnaContent(int index, RnaCounter amount = 1)
+    {
+        RnaCounter room = std::numeric_limits<RnaCounter>::max() - rnaContent[index];
+        rnaContent[index] += std::min(amount, room);
+    }
+    
+    // Removing more RNA than a cell holds is a bug of the caller: it empties the cell in release builds
+    inline void decrementRnaContent(int index, RnaCounter amount = 1)
+    {
+        assert(amount <= rnaContent[index]);
+        rnaContent[index] -= std::min(amount, rnaContent[index]);
     }
     
     // This is used to check if a swap is meaningless, however this must not include a chain check!
     inline bool areCellsIndistinguishable(int column, int row,
                                           int nColumn, int nRow) const
     {
-        CellData &cellData = getElement(column, row);
-        CellData &nCellData = getElement(nColumn, nRow);
-        return (cellData.getChemicalProperties() == nCellData.getChemicalProperties())
-               && (cellData.getFlags() == nCellData.getFlags()
-               && (cellData.getRnaContent() == nCellData.getRnaContent())); // Important: we also need to check for RNA content!
+        int index = getIndex(column, row);
+        int nIndex = getIndex(nColumn, nRow);
+        return (getState(index) == getState(nIndex))
+               && (getRnaContent(index) == getRnaContent(nIndex)); // Important: we also need to check for RNA content!
     }
     
     int getSpeciesCount(ChemicalSpecies chemicalSpecies);
@@ -129,6 +320,8 @@ public:
     
     void setActivity(int column, int row, Activity activity);
     
+    void setActivity(int index, Activity activity);
+    
     void setChemicalProperties(int column, int row, ChemicalSpecies species, Activity activity);
     
     void setChemicalProperties(int column, int row, ChemicalProperties chemicalProperties);
@@ -137,6 +330,8 @@ public:
     
     void setTranscribability(int column, int row, Transcribability transcribability);
     
+    void setTranscribability(int index, Transcribability transcribability);
+    
     void setTranscriptionInhibition(int column, int row, TranscriptionInhibition inhibition);
     
     // Set chain properties in the first slot available and return the index of the slot used
@@ -146,6 +341,9 @@ public:
     // Check cell of given coordinates and return chains it belongs to
     std::vector<std::reference_wrapper<ChainProperties>> chainsCellBelongsTo(int column, int row);
     
+    // Check cell of given coordinates and return the IDs of the chains it belongs to
+    std::set<ChainId> chainIdsCellBelongsTo(int column, int row) const;
+    
     // Check if a given cell belongs to a chain with given Id
     // Returns position in chain properties array if found, MAX_CROSSING_CHAINS if not found
     unsigned char cellBelongsToChain(int column, int row, ChainId chainId);
@@ -159,6 +357,56 @@ public:
     bool isCellNeighbourInAnyChain(int column, int row,
                                    std::vector<std::reference_wrapper<ChainProperties>> &chainPropertiesVector);
     
+    /**
+     * Get the chain properties of a cell, MAX_CROSSING_CHAINS entries long, unused entries have chainLength==0.
+     * @return nullptr if the cell does not belong to any chain.
+     */
+    inline const ChainProperties *getChainPropertiesOf(int column, int row) const
+    {
+        int index = getIndex(column, row);
+        return CellData::hasChain(state[index]) ? getChainProperties(index) : nullptr;
+    }
+    
+    // Union of the chain neighbour masks of all the chains in the given chain properties array (may be nullptr).
+    static inline NeighbourMask getChainNeighbourMask(const ChainProperties *chains)
+    {
+        NeighbourMask mask = 0;
+        if (chains != nullptr)
+        {
+            for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
+            {
+                mask |= chains[k].neighbourMask;
+            }
+        }
+        return mask;
+    }
+    
+    /**
+     * Bit of the Moore neighbour at the given offset. Bits are laid out row-major, skipping the centre:
+     *  0 1 2
+     *  3 . 4
+     *  5 6 7
+     */
+    static constexpr NeighbourMask getDirectionMask(int dx, int dy)
+    {
+        return static_cast<NeighbourMask>(1U << ((dy + 1) * 3 + dx + 1 - ((dy + 1) * 3 + dx + 1 > 4)));
+    }
+    
+    // (dx, dy) offsets of the Moore neighbours, indexed by their bit in a NeighbourMask
+    static const signed char directionOffsets[8][2];
+    
+    // Bits of the 3 neighbours in column dx (dx=-1 or dx=1).
+    static constexpr NeighbourMask getColumnMask(int dx)
+    {
+        return getDirectionMask(dx, -1) | getDirectionMask(dx, 0) | getDirectionMask(dx, 1);
+    }
+    
+    // Bits of the 3 neighbours in row dy (dy=-1 or dy=1).
+    static constexpr NeighbourMask getRowMask(int dy)
+    {
+        return getDirectionMask(-1, dy) | getDirectionMask(0, dy) | getDirectionMask(1, dy);
+    }
+    
     // Check if given cell is last of given chain
     inline bool isLastOfChain(int column, int row, const ChainProperties &chain) const
     {
@@ -166,14 +414,48 @@ public:
     }
     
     bool doesAnyNeighbourMatchCondition(int column, int row,
-                                        bool (*condition)(CellData &));
+                                        bool (*condition)(ChemicalProperties));
     
-    std::vector<std::reference_wrapper<CellData>>
-    getNeighboursMatchingConditions(int column, int row, bool (*condition)(CellData &));
+    /**
+     * Collect the 1D indices of the neighbours whose chemical properties match the given condition.
+     * @param neighbourIndices Output array, it must have room for 8 entries.
+     * @return The number of matching neighbours.
+     */
+    unsigned char getNeighboursMatchingConditions(int column, int row, bool (*condition)(ChemicalProperties),
+                                                  int *neighbourIndices) const;
     
     bool isPositionNextToBoundary(int column, int row);
 
 private:
+    // Only valid for cells carrying the chain marker.
+    inline ChainProperties *getChainProperties(int index)
+    {
+        return chainSlots.data() + chainSlotIndex[index] * MAX_CROSSING_CHAINS;
+    }
+    
+    inline const ChainProperties *getChainProperties(int index) const
+    {
+        return chainSlots.data() + chainSlotIndex[index] * MAX_CROSSING_CHAINS;
+    }
+    
+    ChainProperties *getOrCreateChainProperties(int column, int row);
+    
+    // Get the entry of the given chain in the chain properties of the given cell, nullptr if not found.
+    ChainProperties *findChainProperties(int column, int row, ChainId chainId);
+    
+    // Link a newly added chain entry with its chain neighbours already on the grid, in both directions.
+    void linkChainNeighbourMasks(int column, int row, ChainProperties &chainProperties);
+    
+    // Update the chain neighbour masks of the two cells and of their chain neighbours before they get swapped.
+    void moveChainNeighbourMasks(int column, int row, int nColumn, int nRow);
+    
+    // Write chemical properties and flags, preserving the chain marker.
+    inline void setState(int index, ChemicalProperties chemicalProperties, Flags flags)
+    {
+        state[index] = static_cast<CellState>((state[index] & CHAIN_MARKER_MASK)
+                                              | CellData::stateOf(chemicalProperties, flags));
+    }
+    
     void allocateGrid();
     
     void deallocateGrid();
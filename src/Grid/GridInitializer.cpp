@@ -287,9 +287,9 @@ GridInitializer::initializeGridWithStepInstructions(Grid &grid,
     
     unsigned int chainLength = static_cast<unsigned int>(steps.size() + 1);
     unsigned int position = 0;
-    grid.logger.logMsg(COARSE_DEBUG, "grid.initializeGridWithStepInstructions Setting cell at position (%3d,%3d)",
-                        column,
-                        row);
+    LOG_MSG(grid.logger, COARSE_DEBUG, "grid.initializeGridWithStepInstructions Setting cell at position (%3d,%3d)",
+            column,
+            row);
     if (!grid.isCellWithinInternalDomain(column, row))
     {
         grid.logger.logMsg(ERROR,
@@ -302,8 +302,8 @@ GridInitializer::initializeGridWithStepInstructions(Grid &grid,
     {
         ++position;
         grid.walkOnGrid(column, row, step.x, step.y);
-        grid.logger.logMsg(COARSE_DEBUG, "grid.initializeGridWithStepInstructions Setting cell at position (%3d,%3d)",
-                            column, row);
+        LOG_MSG(grid.logger, COARSE_DEBUG, "grid.initializeGridWithStepInstructions Setting cell at position (%3d,%3d)",
+                column, row);
         if (!grid.isCellWithinInternalDomain(column, row))
         {
             grid.logger.logMsg(ERROR,
@@ -72,6 +72,7 @@ void Logger::openLogFile()
 void Logger::logRawString(char const *fmt, ...)
 {
     // Newline at the end of the message is included.
+    std::lock_guard<std::mutex> lock(LOG_MUTEX);
     double timestamp = Timing::getTimeSpentSeconds(LOGGER_START_TIME, Timing::getCurrentTimeMillis());
     va_list args;
     va_start(args,fmt);
@@ -93,6 +94,7 @@ void Logger::logEvent(DebugLevel eventDebugLevel, double t, char const *fmt, ...
     if (eventDebugLevel < DEBUG_LEVEL)
         return;
     //
+    std::lock_guard<std::mutex> lock(LOG_MUTEX);
     double timestamp = Timing::getTimeSpentSeconds(LOGGER_START_TIME, Timing::getCurrentTimeMillis());
     va_list args;
     va_start(args,fmt);
@@ -114,6 +116,7 @@ void Logger::logMsg(DebugLevel eventDebugLevel, char const *fmt, ...)
     if (eventDebugLevel < DEBUG_LEVEL)
         return;
     //
+    std::lock_guard<std::mutex> lock(LOG_MUTEX);
     double timestamp = Timing::getTimeSpentSeconds(LOGGER_START_TIME, Timing::getCurrentTimeMillis());
     va_list args;
     va_start(args,fmt);
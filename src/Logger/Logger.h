@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <mutex>
 
 // This allows for automatically getting strings of debug levels (see https://stackoverflow.com/a/10966395 )
 // NOTE: order is important for correctly managing incremental levels of debug.
@@ -29,6 +30,19 @@ typedef enum DebugLevel
     FOREACH_DEBUG(GENERATE_ENUM)
 } DebugLevel;
 
+// Lowest level compiled in, set by the build (LOG_MIN_LEVEL in CMakeLists.txt): messages logged with LOG_MSG and
+// LOG_EVENT below it are removed by the compiler, arguments included, whatever the level set at runtime.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL DEBUG
+#endif
+
+// To be used instead of logMsg/logEvent in hot code and for the debug levels. The level must be a constant.
+#define LOG_MSG(logger, level, ...) \
+    do { if ((level) >= LOG_MIN_LEVEL && (logger).isLogged(level)) (logger).logMsg((level), __VA_ARGS__); } while (0)
+#define LOG_EVENT(logger, level, t, ...) \
+    do { if ((level) >= LOG_MIN_LEVEL && (logger).isLogged(level)) (logger).logEvent((level), (t), __VA_ARGS__); } \
+    while (0)
+
 class Logger
 {
 private:
@@ -38,6 +52,7 @@ private:
     char LOG_FILE_NAME[256];
     char LOG_FILE_FULL_PATH[1024] = "";
     std::FILE* LOG_FILE;
+    std::mutex LOG_MUTEX; // Keeps the lines of messages logged from different threads (e.g. snapshot writer) whole
     
 public:
     Logger();
@@ -47,6 +62,11 @@ public:
     void setLogFileName(const char * fileName);
     void setDebugLevel(DebugLevel debugLevel);
     DebugLevel getDebugLevel();
+    // Inline check of the runtime level, so that skipped messages do not even make the varargs call.
+    inline bool isLogged(DebugLevel eventDebugLevel) const
+    {
+        return eventDebugLevel >= DEBUG_LEVEL;
+    }
     const char * getDebugLevelStr();
     void openLogFile();
     void logRawString(char const *fmt, ...);
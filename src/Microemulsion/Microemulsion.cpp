@@ -3,19 +3,21 @@
 //
 
 #include <algorithm>
+#include <limits>
 #include "Microemulsion.h"
 #include "../Utils/RandomGenerator.h"
-#include <cstring>
 
-std::mt19937 Microemulsion::randomGenerator = RandomGenerator::getInstance().getGenerator();
-std::mt19937_64 Microemulsion::randomGenerator_64 = RandomGenerator::getInstance().getGenerator64();
+std::vector<uint32_t> Microemulsion::randomBlocks;
+const int Microemulsion::NO_REACTIVE_SLOT;
+const int Microemulsion::PENDING_REACTIVE_SLOT;
 
 Microemulsion::Microemulsion(Grid &grid, double omega, Logger &logger, double deltaTChem, double kOn, double kOff,
                              double kChromPlus, double kChromMinus, double kRnaPlus, double kRnaMinus,
                              double kRnaTransfer, bool isBoundarySticky)
         : grid(grid), logger(logger), omega(omega),
-          uniformProbabilityDistribution(0.0, 1.0),
-          coloursDistribution(0, 24),
+          counterBasedGenerator(RandomGenerator::getInstance().getSeed()),
+          swapRound(0),
+          chemicalStep(0),
           dtChem(deltaTChem),
           kOn(kOn),
           kOff(kOff),
@@ -25,15 +27,22 @@ Microemulsion::Microemulsion(Grid &grid, double omega, Logger &logger, double de
           kRnaMinusRbp(kRnaMinus),
           kRnaMinusTxn(kRnaMinus),
           kRnaTransfer(kRnaTransfer),
-          isBoundarySticky(isBoundarySticky)
+          isBoundarySticky(isBoundarySticky),
+          swapEngine(CLASSIC_SWAP_ENGINE),
+          swapDecomposition(COLOURED_SWAP_DECOMPOSITION),
+          isMoveClassTableValid(false),
+          areReactiveSitesValid(false),
+          isRnaDecayLazy(false),
+          chemistryEngine(TAU_LEAPING_CHEMISTRY_ENGINE),
+          isPropensityTreeValid(false),
+          chemicalTime(0),
+          isNextChemicalEventDrawn(false),
+          nextChemicalEventTime(0),
+          sweepColour(0)
 {
     deltaEmin = -10 * fabs(omega);
-    #pragma omp parallel for schedule(static,1)
-    for (int i=0; i < omp_get_num_threads(); ++i)
-    {
-        randomGenerator = RandomGenerator::getInstance().getGenerator();
-        randomGenerator_64 = RandomGenerator::getInstance().getGenerator64();
-    }
+    computeAcceptanceThresholds();
+    computeAffectedMoveOffsets();
 }
 
 bool Microemulsion::performRandomSwap()
@@ -42,19 +51,22 @@ bool Microemulsion::performRandomSwap()
     // Get a random element and a random neighbour to attempt a swap.
     grid.pickRandomElement(x, y);
     
-    return performRandomSwap(x, y);
+    auto stream = getRandomStream(grid.getIndex(x, y), swapRound++, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+    uint32_t neighbourWord = stream(), acceptanceWordHigh = stream();
+    return performRandomSwap(x, y, neighbourWord, acceptanceWordHigh, stream());
 }
 
-bool Microemulsion::performRandomSwap(int x, int y)
+bool Microemulsion::performRandomSwap(int x, int y, uint32_t neighbourWord, uint32_t acceptanceWordHigh,
+                                      uint32_t acceptanceWordLow)
 {
     int nx, ny;
-    grid.pickRandomNeighbourOf(x, y, nx, ny);
+    grid.pickRandomNeighbourOf(x, y, nx, ny, neighbourWord);
     
     // Here we check if swap allowed by chains, if not we just return.
     if (!isSwapAllowedByChainsAndMeaningful(x, y, nx, ny))
     {
-        logger.logMsg(DEBUG, "Microemulsion::performRandomSwap - Swap not allowed by chains! "
-                             "(x=%d, y=%d) <-> (nx=%d, ny=%d)", x, y, nx, ny);
+        LOG_MSG(logger, DEBUG, "Microemulsion::performRandomSwap - Swap not allowed by chains! "
+                               "(x=%d, y=%d) <-> (nx=%d, ny=%d)", x, y, nx, ny);
         return false;
     }
     
@@ -62,25 +74,32 @@ bool Microemulsion::performRandomSwap(int x, int y)
     if (isBoundarySticky && isSwapBlockedByStickyBoundary(x, y, nx, ny))
     {
         //todo: should we inhibit transcription on chromatin that sticks to the boundary?
-        logger.logMsg(DEBUG, "Microemulsion::performRandomSwap - Swap not allowed by sticky boundary! "
-                             "(x=%d, y=%d) <-> (nx=%d, ny=%d)", x, y, nx, ny);
+        LOG_MSG(logger, DEBUG, "Microemulsion::performRandomSwap - Swap not allowed by sticky boundary! "
+                               "(x=%d, y=%d) <-> (nx=%d, ny=%d)", x, y, nx, ny);
         return false;
     }
     
-    // If chains allow the swap, then we check the energy required for it
-// and we compute its probability
-    double preEnergy = computePartialDifferentialEnergy(x, y, nx, ny);
-    double postEnergy = computeSwappedPartialDifferentialEnergy(x, y, nx, ny);
-    double deltaEnergy = postEnergy - preEnergy;
-    double probability = computeSwapProbability(deltaEnergy);
-    logger.logMsg(DEBUG, "Microemulsion::performRandomSwap - deltaEnergy=%f, probability=%f",
-                        deltaEnergy, probability);
-    // Then we draw a random choice with the specified probability: if success we swap.
-    if (randomChoiceWithProbability(probability))
-    {
-        CellData tmp = grid.getElement(x, y);
-        grid.setElement(x, y, grid.getElement(nx, ny));
-        grid.setElement(nx, ny, tmp);
+    bool isSwapAccepted;
+    if (swapEngine == LOOKUP_TABLE_SWAP_ENGINE)
+    {
+        isSwapAccepted = isSwapAcceptedByLookupTable(x, y, nx, ny, acceptanceWordHigh);
+    }
+    else
+    {
+        // If chains allow the swap, then we check the energy required for it
+        // and we compute its probability
+        double preEnergy = computePartialDifferentialEnergy(x, y, nx, ny);
+        double postEnergy = computeSwappedPartialDifferentialEnergy(x, y, nx, ny);
+        double deltaEnergy = postEnergy - preEnergy;
+        double probability = computeSwapProbability(deltaEnergy);
+        LOG_MSG(logger, DEBUG, "Microemulsion::performRandomSwap - deltaEnergy=%f, probability=%f",
+                deltaEnergy, probability);
+        // Then we draw a random choice with the specified probability: if success we swap.
+        isSwapAccepted = CounterBasedGenerator::toUniformDouble(acceptanceWordHigh, acceptanceWordLow) < probability;
+    }
+    if (isSwapAccepted)
+    {
+        swapElements(x, y, nx, ny);
         return true;
     }
     else
@@ -91,92 +110,424 @@ bool Microemulsion::performRandomSwap(int x, int y)
 
 unsigned int Microemulsion::performRandomSwaps(unsigned int rounds)
 {
-    int threads = omp_get_num_threads();
-    unsigned int rVecLen = static_cast<unsigned int>(ceil(rounds/5.0)); // This 5 is floor(pow(2^64 - 1, 1/25)), how many 25's are in a long long
-    unsigned int rVecLenLoc = static_cast<unsigned int>(ceil((rVecLen + 0.0) / threads));
-    rVecLen = rVecLenLoc * threads; // Rounding to make life easier
-    auto *rVec = new unsigned long long[rVecLen];
-    
-    unsigned int count = 0;
-    int colour = 0;
+    if (swapEngine == REJECTION_FREE_SWAP_ENGINE)
+    {
+        return performRejectionFreeSwaps(rounds);
+    }
+    unsigned long count = 0;
     #pragma omp parallel
     {
-//        #pragma omp for schedule(dynamic)
-//        for (unsigned int i = 0; i < rVecLen; ++i)
-//        {
-//            rVec[i] = randomGenerator_64();
-//        }
-        
+        performRandomSwapsInParallelRegion(rounds, count);
+    }
+    return static_cast<unsigned int>(count);
+}
+
+void Microemulsion::performRandomSwapsInParallelRegion(unsigned int rounds, unsigned long &swapsPerformed)
+{
+    if (swapEngine == REJECTION_FREE_SWAP_ENGINE)
+    {
+        #pragma omp single
+        {
+            swapsPerformed += performRejectionFreeSwaps(rounds);
+        }
+        return;
+    }
+    // Cells of a colour class within a row share one batch of random blocks
+    size_t maxCellsPerRow = static_cast<size_t>((grid.getColumns() + colourStride - 1) / colourStride);
+    if (randomBlocks.size() < 4 * maxCellsPerRow)
+    {
+        randomBlocks.resize(4 * maxCellsPerRow);
+    }
+    unsigned int count = (swapDecomposition == TILED_SWAP_DECOMPOSITION) ? performTiledRandomSwaps(rounds)
+                                                                         : performColouredRandomSwaps(rounds);
+    #pragma omp atomic
+    swapsPerformed += count;
+    // All threads are done with the rounds before they are advanced
+    #pragma omp barrier
+    #pragma omp single
+    {
+        swapRound += rounds;
+    }
+}
+
+unsigned int Microemulsion::performColouredRandomSwaps(unsigned int rounds)
+{
+    unsigned int count = 0;
+    for (unsigned int r = 0; r < rounds; ++r)
+    {
+        uint64_t round = swapRound + r;
         #pragma omp master
         {
-            memset(rVec, 0, rVecLen);
+            sweepColour = pickSwapColour(round);
         }
-        #pragma omp for schedule(static,1)
-        for (int t=0; t < threads; ++t)
+        #pragma omp barrier
+        unsigned char rowColour = sweepColour / colourStride;
+        unsigned char columnColour = sweepColour % colourStride;
+
+        #pragma omp for schedule(dynamic)
+//        #pragma omp for schedule(static)
+        for (int row = grid.getFirstRow() + rowColour; row < grid.getLastRow(); row += colourStride)
         {
-            auto *rVecLoc = new unsigned long long[rVecLenLoc];
-            for (unsigned int i = 0; i < rVecLenLoc; ++i)
-            {
-                rVecLoc[i] = randomGenerator_64();
-            }
-            memcpy(rVec + (t * rVecLenLoc), rVecLoc, rVecLenLoc);
-            delete[] rVecLoc;
+            count += performRandomSwapsOnRow(row, columnColour, round, randomBlocks.data());
         }
+    }
+    return count;
+}
+
+unsigned int Microemulsion::performTiledRandomSwaps(unsigned int rounds)
+{
+    const int firstRow = grid.getFirstRow();
+    // The last tile takes the remainder rows, so that every tile has at least tileRows rows
+    const int numTiles = std::max(1, grid.getRows() / tileRows);
+    const int roundsPerBatch = colourStride * colourStride;
+    unsigned int count = 0;
+    for (unsigned int batchBegin = 0; batchBegin < rounds; batchBegin += roundsPerBatch)
+    {
+        unsigned int batchEnd = std::min(rounds, batchBegin + roundsPerBatch);
         
-        for (unsigned int r = 0; r < rounds; ++r)
+        #pragma omp for schedule(dynamic)
+        for (int tile = 0; tile < numTiles; ++tile)
         {
-            #pragma omp master
+            int beginRow = firstRow + tile * tileRows + (tile > 0 ? bandWidth : 0);
+            int endRow = (tile < numTiles - 1) ? firstRow + (tile + 1) * tileRows - bandWidth
+                                               : grid.getLastRow() + 1;
+            for (unsigned int r = batchBegin; r < batchEnd; ++r)
             {
-//                colour = coloursDistribution(randomGenerator);
-                unsigned int i = r / 5;
-                colour = static_cast<int>(rVec[i] % 25);
-                rVec[i] /= 25;
+                count += performRandomSwapsOnRows(beginRow, endRow, swapRound + r, randomBlocks.data());
             }
-            #pragma omp barrier
-            unsigned char rowColour = colour / colourStride;
-            unsigned char columnColour = colour % colourStride;
-
-            #pragma omp for reduction(+:count) schedule(dynamic)
-//            #pragma omp for reduction(+:count) schedule(static)
-            for (int row = grid.getFirstRow() + rowColour; row < grid.getLastRow(); row += colourStride)
+        }
+        
+        // Bands of different boundaries are more than 2 * bandWidth rows apart: their swaps are independent
+        #pragma omp for schedule(dynamic)
+        for (int boundary = 1; boundary < numTiles; ++boundary)
+        {
+            int boundaryRow = firstRow + boundary * tileRows;
+            for (unsigned int r = batchBegin; r < batchEnd; ++r)
             {
-                for (int column = grid.getFirstColumn() + columnColour;
-                     column < grid.getLastColumn(); column += colourStride)
-                {
-                    count += performRandomSwap(column, row);
-                }
+                count += performRandomSwapsOnRows(boundaryRow - bandWidth, boundaryRow + bandWidth,
+                                                  swapRound + r, randomBlocks.data());
             }
         }
     }
-    delete[] rVec;
+    return count;
+}
+
+unsigned int Microemulsion::performRandomSwapsOnRows(int beginRow, int endRow, uint64_t round, uint32_t *blocks)
+{
+    int colour = pickSwapColour(round);
+    int rowColour = colour / colourStride;
+    int columnColour = colour % colourStride;
+    // First row of the colour at or after beginRow, the colour sweep never visits the last row
+    int row = beginRow + ((rowColour - (beginRow - grid.getFirstRow())) % colourStride + colourStride) % colourStride;
+    endRow = std::min(endRow, grid.getLastRow());
+    unsigned int count = 0;
+    for (; row < endRow; row += colourStride)
+    {
+        count += performRandomSwapsOnRow(row, columnColour, round, blocks);
+    }
+    return count;
+}
+
+unsigned int Microemulsion::performRandomSwapsOnRow(int row, int columnColour, uint64_t round, uint32_t *blocks)
+{
+    int firstColumn = grid.getFirstColumn() + columnColour;
+    int cellsInRow = (grid.getLastColumn() - firstColumn + colourStride - 1) / colourStride;
+    if (cellsInRow <= 0)
+    {
+        return 0;
+    }
+    counterBasedGenerator.fillBlocks(static_cast<uint32_t>(grid.getIndex(firstColumn, row)), colourStride,
+                                     cellsInRow, round, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE, blocks);
+    const uint32_t *neighbourWords = blocks;
+    const uint32_t *acceptanceWordsHigh = neighbourWords + cellsInRow;
+    const uint32_t *acceptanceWordsLow = acceptanceWordsHigh + cellsInRow;
+    unsigned int count = 0;
+    for (int k = 0; k < cellsInRow; ++k)
+    {
+        count += performRandomSwap(firstColumn + k * colourStride, row, neighbourWords[k],
+                                   acceptanceWordsHigh[k], acceptanceWordsLow[k]);
+    }
     return count;
 }
 
 bool Microemulsion::doesPairRequireEnergyCost(int x, int y, int nx, int ny) const
 {
     bool isEnergyCostRequired = false;
-    CellData &cellData = grid.getElement(x, y);
-    CellData &nCellData = grid.getElement(nx, ny);
+    int index = grid.getIndex(x, y);
+    int nIndex = grid.getIndex(nx, ny);
+    ChemicalProperties chemicalProperties = grid.getChemicalProperties(index);
+    ChemicalProperties nChemicalProperties = grid.getChemicalProperties(nIndex);
     // Here logic for pairs that require an omega energy cost
-    if (cellData.isChromatin())
+    if (CellData::isChromatin(chemicalProperties))
     {
-        if (cellData.isActive() || cellData.getRnaContent() > 0)
+        if (CellData::isActive(chemicalProperties) || grid.getRnaContent(index) > 0)
         {
-            isEnergyCostRequired = nCellData.isChromatin();
+            isEnergyCostRequired = CellData::isChromatin(nChemicalProperties);
         }
         else
         {
-            isEnergyCostRequired = nCellData.isActive() || nCellData.getRnaContent() > 0;
+            isEnergyCostRequired = CellData::isActive(nChemicalProperties) || grid.getRnaContent(nIndex) > 0;
         }
     }
-    else if (cellData.isActiveRBP())
+    else if (CellData::isActiveRBP(chemicalProperties))
     {
-        isEnergyCostRequired = cellData.isChromatin()
-                && !(nCellData.isActive() || nCellData.getRnaContent() > 0);
+        isEnergyCostRequired = CellData::isChromatin(chemicalProperties)
+                && !(CellData::isActive(nChemicalProperties) || grid.getRnaContent(nIndex) > 0);
     }
     return isEnergyCostRequired;
 }
 
+void Microemulsion::computeAcceptanceThresholds()
+{
+    for (int energyCount = -maxEnergyCount; energyCount <= maxEnergyCount; ++energyCount)
+    {
+        double probability = computeSwapProbability(omega * energyCount);
+        acceptanceThresholds[energyCount + maxEnergyCount] =
+                (probability >= 1) ? randomWordRange : static_cast<uint64_t>(probability * randomWordRange);
+    }
+}
+
+int Microemulsion::computeDeltaEnergyCount(int x, int y, int nx, int ny) const
+{
+    // The cells paired with the selected cell (xSide) and with the swap candidate (nSide) are the same
+    // used by computePartialDifferentialEnergy and computeSwappedPartialDifferentialEnergy.
+    int xSide[4], nSide[4];
+    int sideLength = 3;
+    int dx = nx - x, dy = ny - y;
+    if (dx != 0 && dy != 0)
+    {
+        sideLength = 4;
+        xSide[0] = grid.getIndex(x - dx, y);
+        xSide[1] = grid.getIndex(x - dx, ny);
+        xSide[2] = grid.getIndex(x, y - dy);
+        xSide[3] = grid.getIndex(nx, y - dy);
+        nSide[0] = grid.getIndex(nx + dx, y);
+        nSide[1] = grid.getIndex(nx + dx, ny);
+        nSide[2] = grid.getIndex(x, ny + dy);
+        nSide[3] = grid.getIndex(nx, ny + dy);
+    }
+    else if (dx != 0)
+    {
+        for (int j = -1; j <= 1; ++j)
+        {
+            xSide[j + 1] = grid.getIndex(x - dx, y + j);
+            nSide[j + 1] = grid.getIndex(x + dx, y + j);
+        }
+    }
+    else
+    {
+        for (int i = -1; i <= 1; ++i)
+        {
+            xSide[i + 1] = grid.getIndex(x + i, y - dy);
+            nSide[i + 1] = grid.getIndex(x + i, y + dy);
+        }
+    }
+    // Count chromatin and marked (active or RNA-holding) cells on each side
+    int xChromatin = 0, xMarked = 0, nChromatin = 0, nMarked = 0;
+    for (int k = 0; k < sideLength; ++k)
+    {
+        unsigned char xSideClass = getAffinityClass(xSide[k]);
+        unsigned char nSideClass = getAffinityClass(nSide[k]);
+        xChromatin += xSideClass >> CHROMATIN_AFFINITY_BIT;
+        xMarked += xSideClass & MARKED_AFFINITY_MASK;
+        nChromatin += nSideClass >> CHROMATIN_AFFINITY_BIT;
+        nMarked += nSideClass & MARKED_AFFINITY_MASK;
+    }
+    unsigned char cellClass = getAffinityClass(grid.getIndex(x, y));
+    unsigned char nCellClass = getAffinityClass(grid.getIndex(nx, ny));
+    int preCount = countPairsRequiringEnergyCost(cellClass, xChromatin, xMarked)
+                   + countPairsRequiringEnergyCost(nCellClass, nChromatin, nMarked);
+    int postCount = countPairsRequiringEnergyCost(nCellClass, xChromatin, xMarked)
+                    + countPairsRequiringEnergyCost(cellClass, nChromatin, nMarked);
+    return postCount - preCount;
+}
+
+bool Microemulsion::isSwapAcceptedByLookupTable(int x, int y, int nx, int ny, uint32_t randomWord)
+{
+    int deltaEnergyCount = computeDeltaEnergyCount(x, y, nx, ny);
+    LOG_MSG(logger, DEBUG, "Microemulsion::isSwapAcceptedByLookupTable - %s=%d", DUMP(deltaEnergyCount));
+    return static_cast<uint64_t>(randomWord) < acceptanceThresholds[deltaEnergyCount + maxEnergyCount];
+}
+
+unsigned int Microemulsion::performRejectionFreeSwaps(unsigned int rounds)
+{
+    if (!isMoveClassTableValid)
+    {
+        rebuildMoveClassTable();
+    }
+    // A single sequential stream per call, the engine runs serially
+    auto stream = getRandomStream(0, swapRound, CounterBasedGenerator::REJECTION_FREE_SWAP_PURPOSE);
+    swapRound += rounds;
+    unsigned int count = 0;
+    double time = 0;
+    while (true)
+    {
+        double totalRate = moveClassTable.getTotalRate();
+        if (totalRate <= 0)
+        {
+            break;
+        }
+        // Waiting times are exponential, hence memoryless: the one crossing the end of the interval is dropped.
+        time -= std::log(1 - stream.uniformDouble()) / totalRate;
+        if (time > rounds)
+        {
+            break;
+        }
+        int move = moveClassTable.pickMove(stream.uniformDouble() * totalRate);
+        int index = move / 8, direction = move % 8;
+        int x = grid.getColumnOfIndex(index), y = grid.getRowOfIndex(index);
+        swapElements(x, y, x + Grid::directionOffsets[direction][0], y + Grid::directionOffsets[direction][1]);
+        ++count;
+        updateMoveClasses(move - direction, affectedMoveOffsets[direction]);
+    }
+    LOG_MSG(logger, DEBUG, "Microemulsion::performRejectionFreeSwaps %s=%d", DUMP(count));
+    return count;
+}
+
+void Microemulsion::computeAffectedMoveOffsets()
+{
+    // A move from s to n depends on the cells within distance 1 from either s or n: the energy stencils,
+    // the chemical properties of s and n and their chain neighbour masks, which only change for chain
+    // neighbours of the swapped cells.
+    const int radius = 3;
+    int extendedColumns = grid.getExtendedColumns();
+    auto collectAffectedMoveOffsets = [&](const std::vector<std::pair<int, int>> &changedCells,
+                                          std::vector<int> &offsets)
+    {
+        offsets.clear();
+        for (int oy = -radius; oy <= radius; ++oy)
+        {
+            for (int ox = -radius; ox <= radius; ++ox)
+            {
+                for (int direction = 0; direction < 8; ++direction)
+                {
+                    int nox = ox + Grid::directionOffsets[direction][0];
+                    int noy = oy + Grid::directionOffsets[direction][1];
+                    bool isAffected = false;
+                    for (auto &cell : changedCells)
+                    {
+                        isAffected = isAffected
+                                     || (std::abs(ox - cell.first) <= 1 && std::abs(oy - cell.second) <= 1)
+                                     || (std::abs(nox - cell.first) <= 1 && std::abs(noy - cell.second) <= 1);
+                    }
+                    if (isAffected)
+                    {
+                        offsets.push_back((oy * extendedColumns + ox) * 8 + direction);
+                    }
+                }
+            }
+        }
+    };
+    for (int swapDirection = 0; swapDirection < 8; ++swapDirection)
+    {
+        collectAffectedMoveOffsets({{0, 0}, {Grid::directionOffsets[swapDirection][0],
+                                             Grid::directionOffsets[swapDirection][1]}},
+                                   affectedMoveOffsets[swapDirection]);
+    }
+    // Chemistry changes a single cell in place, its chain masks stay the same
+    collectAffectedMoveOffsets({{0, 0}}, changedCellMoveOffsets);
+}
+
+void Microemulsion::rebuildMoveClassTable()
+{
+    const int neighbourCounts[numDegreeClasses] = {8, 5, 3};
+    std::vector<double> rates(static_cast<size_t>((2 * maxEnergyCount + 1) * numDegreeClasses));
+    for (int energyCount = -maxEnergyCount; energyCount <= maxEnergyCount; ++energyCount)
+    {
+        double probability = fmin(computeSwapProbability(omega * energyCount), 1);
+        for (int degreeClass = 0; degreeClass < numDegreeClasses; ++degreeClass)
+        {
+            rates[(energyCount + maxEnergyCount) * numDegreeClasses + degreeClass] =
+                    probability / (colourStride * colourStride * neighbourCounts[degreeClass]);
+        }
+    }
+    int numMoves = grid.getExtendedColumns() * grid.getExtendedRows() * 8;
+    moveClassTable.reset(numMoves, rates);
+    for (int move = 0; move < numMoves; ++move)
+    {
+        updateMoveClass(move);
+    }
+    isMoveClassTableValid = true;
+}
+
+unsigned char Microemulsion::computeMoveClass(int move)
+{
+    unsigned char moveClass = MoveClassTable::NO_CLASS;
+    int index = move / 8, direction = move % 8;
+    int x = grid.getColumnOfIndex(index), y = grid.getRowOfIndex(index);
+    int nx = x + Grid::directionOffsets[direction][0], ny = y + Grid::directionOffsets[direction][1];
+    // Only the cells visited by the colour sweep can start a swap, and only towards the inner grid
+    if (x >= grid.getFirstColumn() && x < grid.getLastColumn() && y >= grid.getFirstRow() && y < grid.getLastRow()
+        && grid.isCellWithinInternalDomain(nx, ny)
+        && isSwapAllowedByChainsAndMeaningful(x, y, nx, ny)
+        && !(isBoundarySticky && isSwapBlockedByStickyBoundary(x, y, nx, ny)))
+    {
+        // 0, 1 or 2 boundaries touched mean 8, 5 or 3 neighbours
+        int degreeClass = (x == grid.getFirstColumn() || x == grid.getLastColumn())
+                          + (y == grid.getFirstRow() || y == grid.getLastRow());
+        moveClass = static_cast<unsigned char>(
+                (computeDeltaEnergyCount(x, y, nx, ny) + maxEnergyCount) * numDegreeClasses + degreeClass);
+    }
+    return moveClass;
+}
+
+bool Microemulsion::isMoveClassTableConsistent()
+{
+    if (!isMoveClassTableValid)
+    {
+        return false;
+    }
+    int numMoves = grid.getExtendedColumns() * grid.getExtendedRows() * 8;
+    for (int move = 0; move < numMoves; ++move)
+    {
+        if (moveClassTable.getMoveClass(move) != computeMoveClass(move))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Microemulsion::updateMoveClasses(int baseMove, const std::vector<int> &offsets)
+{
+    int numMoves = grid.getExtendedColumns() * grid.getExtendedRows() * 8;
+    for (int offset : offsets)
+    {
+        // Offsets near the edges may wrap around rows: that only re-evaluates a few unrelated moves
+        int affectedMove = baseMove + offset;
+        if (affectedMove >= 0 && affectedMove < numMoves)
+        {
+            updateMoveClass(affectedMove);
+        }
+    }
+}
+
+void Microemulsion::updateMoveClassesAfterChemistry()
+{
+    std::vector<int> changedCells;
+    for (auto &threadChangedCells : chemicallyChangedCells)
+    {
+        changedCells.insert(changedCells.end(), threadChangedCells.begin(), threadChangedCells.end());
+        threadChangedCells.clear();
+    }
+    if (!isMoveClassTableValid)
+    {
+        return;
+    }
+    std::sort(changedCells.begin(), changedCells.end());
+    changedCells.erase(std::unique(changedCells.begin(), changedCells.end()), changedCells.end());
+    auto numMoves = static_cast<size_t>(grid.getExtendedColumns() * grid.getExtendedRows() * 8);
+    if (changedCells.size() * changedCellMoveOffsets.size() > numMoves)
+    {
+        isMoveClassTableValid = false;
+        return;
+    }
+    for (int index : changedCells)
+    {
+        updateMoveClasses(index * 8, changedCellMoveOffsets);
+    }
+}
+
 double Microemulsion::computePartialDifferentialEnergy(int x, int y, int nx, int ny)
 {
     double energy = 0;
@@ -260,315 +611,343 @@ double Microemulsion::computeSwappedPartialDifferentialEnergy(int x, int y, int
 bool Microemulsion::isSwapAllowedByChainsAndMeaningful(int x, int y, int nx, int ny)
 {
     // Get chains of current cell and of swap candidate
-    std::vector<std::reference_wrapper<ChainProperties>> chains = grid.chainsCellBelongsTo(x, y);
-    std::vector<std::reference_wrapper<ChainProperties>> nChains = grid.chainsCellBelongsTo(nx, ny);
+    const ChainProperties *chains = grid.getChainPropertiesOf(x, y);
+    const ChainProperties *nChains = grid.getChainPropertiesOf(nx, ny);
     // If neither of the cells belong to any chain, we can stop here and allow the swap.
     // HOWEVER if the cells share the same chemical properties and they don't belong
     // to chains, they are indistinguishable, so it's useless to actually swap them. In
     // this case we reject the swap anyway! //todo: to be checked (see below)
     
     // Check if "meaningful".
-    if (chains.empty() && nChains.empty())
+    if (chains == nullptr && nChains == nullptr)
     {
         // If chemically indistinguishable, swap is meaningless. So we must return false.
         // todo: Check in a rigorous way if this actually ensures a speedup in the avg case.
         return !grid.areCellsIndistinguishable(x, y, nx, ny);
     }
     
+    int dx = nx - x, dy = ny - y;
     // We also exclude any swap between chain neighbours, as it would break chain ordering!
     // todo: Here check if it is better to just check if the two cells share any chain (not just being neighbours)
-    if (grid.isCellNeighbourInAnyChain(nx, ny, chains))
+    if (Grid::getChainNeighbourMask(chains) & Grid::getDirectionMask(dx, dy))
     {
         return false;
     }
     
     // Check if allowed, i.e. if not breaking the chain.
     bool isSwapAllowed = false;
-    int dx = nx - x, dy = ny - y;
     
     if (dx != 0 && dy != 0)
     {
-        isSwapAllowed = isDiagonalSwapAllowedByChains(x, y, nx, ny, chains, nChains, dx, dy);
+        isSwapAllowed = isDiagonalSwapAllowedByChains(chains, nChains, dx, dy);
     }
     else if (dx != 0)
     {
-        isSwapAllowed = isHorizontalSwapAllowedByChains(x, y, nx, ny, chains, nChains, dx);
+        isSwapAllowed = isHorizontalSwapAllowedByChains(chains, nChains, dx);
     }
     else if (dy != 0)
     {
-        isSwapAllowed = isVerticalSwapAllowedByChains(x, y, nx, ny, chains, nChains, dy);
+        isSwapAllowed = isVerticalSwapAllowedByChains(chains, nChains, dy);
     }
     return isSwapAllowed;
 }
 
-bool Microemulsion::isDiagonalSwapAllowedByChains(int x, int y, int nx, int ny,
-                                                  std::vector<std::reference_wrapper<ChainProperties>> &chains,
-                                                  std::vector<std::reference_wrapper<ChainProperties>> &nChains,
+bool Microemulsion::isDiagonalSwapAllowedByChains(const ChainProperties *chains, const ChainProperties *nChains,
                                                   int dx, int dy)
 {
-    bool isSwapAllowed = true;
     // In this case we are swapping diagonally, chain neighbours can only be in 2 cells!
     // Furthermore, just one cell of the swapping pair can be part of chains!
-    if (!chains.empty() && !nChains.empty())
+    if (chains != nullptr && nChains != nullptr)
     {
-        isSwapAllowed = false;
+        return false;
     }
-    else if (!chains.empty())
+    else if (nChains != nullptr)
     {
-        isSwapAllowed = true;
-        for (auto &chain : chains)
-        {
-            if (!isSwapAllowedByChainNeighboursInDiagonalCase(x, y, dx, dy, chain))
-            {
-                isSwapAllowed = false;
-                break;
-            }
-        }
+        // Look at it from the point of view of the swap candidate
+        chains = nChains;
+        dx = -dx;
+        dy = -dy;
     }
-    else if (!nChains.empty())
+    for (unsigned char k = 0; k < MAX_CROSSING_CHAINS; ++k)
     {
-        isSwapAllowed = true;
-        for (auto &chain : nChains)
+        if (chains[k].chainLength > 0 && !isSwapAllowedByChainNeighboursInDiagonalCase(dx, dy, chains[k]))
         {
-            if (!isSwapAllowedByChainNeighboursInDiagonalCase(nx, ny, -dx, -dy, chain))
-            {
-                isSwapAllowed = false;
-                break;
-            }
+            return false;
         }
     }
-    return isSwapAllowed;
+    return true;
 }
 
-bool Microemulsion::isHorizontalSwapAllowedByChains(int x, int y, int nx, int ny,
-                                                    std::vector<std::reference_wrapper<ChainProperties>> &chains,
-                                                    std::vector<std::reference_wrapper<ChainProperties>> &nChains,
+bool Microemulsion::isHorizontalSwapAllowedByChains(const ChainProperties *chains, const ChainProperties *nChains,
                                                     int dx)
 {
-    bool isSwapAllowed;
-    // In this case we are swapping horizontally
-    isSwapAllowed = true;
-    if (!chains.empty())
+    // Here it is easier to check on the complementary of the intersection of
+    // the neighbours of cell and swap candidate.
+    // On this area we want no neighbour, otherwise swap is impossible.
+    // Also, we don't need to care about being at last position or not!
+    // Checking on column -dx ensures being on the complementary (and on column dx for the swap candidate).
+    return !(Grid::getChainNeighbourMask(chains) & Grid::getColumnMask(-dx))
+           && !(Grid::getChainNeighbourMask(nChains) & Grid::getColumnMask(dx));
+}
+
+bool Microemulsion::isVerticalSwapAllowedByChains(const ChainProperties *chains, const ChainProperties *nChains,
+                                                  int dy)
+{
+    // Same as the horizontal case, just on rows.
+    return !(Grid::getChainNeighbourMask(chains) & Grid::getRowMask(-dy))
+           && !(Grid::getChainNeighbourMask(nChains) & Grid::getRowMask(dy));
+}
+
+bool Microemulsion::isSwapAllowedByChainNeighboursInDiagonalCase(int dx, int dy,
+                                                                 const ChainProperties &chainProperties)
+{
+    bool horizontalCheck = (chainProperties.neighbourMask & Grid::getDirectionMask(dx, 0)) != 0;
+    bool verticalCheck = (chainProperties.neighbourMask & Grid::getDirectionMask(0, dy)) != 0;
+    return (horizontalCheck && verticalCheck)
+           ||
+           (chainProperties.position == chainProperties.chainLength - 1 // Last of chain
+            && (horizontalCheck || verticalCheck)
+           );
+}
+
+unsigned int Microemulsion::performChemicalReactions()
+{
+    unsigned long chemicalChanges = 0;
+    #pragma omp parallel
     {
-        // Check if swap is ok for current cell
-        for (auto &chain : chains)
+        performChemicalReactionsInParallelRegion(chemicalChanges);
+    }
+    return static_cast<unsigned int>(chemicalChanges);
+}
+
+void Microemulsion::performChemicalReactionsInParallelRegion(unsigned long &chemicalChanges)
+{
+    #pragma omp single
+    {
+        logger.logMsg(INFO, "Performing chemical reactions");
+        if (!areReactiveSitesValid)
+        {
+            rebuildReactiveSites();
+        }
+        newReactiveSites.resize(static_cast<size_t>(omp_get_num_threads()));
+        chemicallyChangedCells.resize(static_cast<size_t>(omp_get_num_threads()));
+        sortChromatinSitesByColour();
+    }
+    unsigned int chemicalChangesCounter = 0;
+    const int numReactiveSites = static_cast<int>(reactiveSites.size());
+    // Phase 1:
+    // Decay "old" RNA on RBP sites, before any transfer into them
+    #pragma omp for schedule(static)
+    for (int slot = 0; slot < numReactiveSites; ++slot)
+    {
+        int index = reactiveSites[slot];
+        CellState state = grid.getState(index);
+        RnaCounter rnaContent = grid.getRnaContent(index);
+        if (isRnaDecayLazy && grid.isRBP(index) && grid.getRnaContent(index) > 0)
         {
-            if (!isSwapAllowedByChainNeighboursInHorizontalCase(x, y, dx, chain))
+            if (nextRnaDecayStep[index] <= chemicalStep)
             {
-                isSwapAllowed = false;
-                break;
+                auto stream = getRandomStream(index, chemicalStep, CounterBasedGenerator::CHEMISTRY_DECAY_PURPOSE);
+                chemicalChangesCounter += performScheduledRnaDecayReaction(index, stream);
             }
         }
+        else if (grid.isRBP(index))
+        {
+            chemicalChangesCounter += performChemicalReactionsDecay(grid.getColumnOfIndex(index),
+                                                                    grid.getRowOfIndex(index));
+        }
+        if (grid.getState(index) != state || grid.getRnaContent(index) != rnaContent)
+        {
+            recordChemicalChange(index);
+        }
     }
-    if (!nChains.empty())
+    // Phase 2:
+    // On chromatin sites, decay RNA, then switch activity, produce and transfer RNA. Only the site itself changes its
+    // own RNA, so the two are fused. Transfers to an RBP cell only depend on the species of the cells around the
+    // donor, which chemistry never changes, and commute with each other: sweeping the sites by colour gives the same
+    // grid as the serial row-by-row sweep.
+    for (auto &colourSites : chromatinSitesByColour)
     {
-        // Check if swap is ok for swap candidate
-        for (auto &nChain : nChains)
+        const int numColourSites = static_cast<int>(colourSites.size());
+        #pragma omp for schedule(static)
+        for (int k = 0; k < numColourSites; ++k)
         {
-            if (!isSwapAllowedByChainNeighboursInHorizontalCase(nx, ny, -dx, nChain))
+            int index = colourSites[k];
+            int column = grid.getColumnOfIndex(index), row = grid.getRowOfIndex(index);
+            CellState state = grid.getState(index);
+            RnaCounter rnaContent = grid.getRnaContent(index);
+            chemicalChangesCounter += performChemicalReactionsDecay(column, row);
+            chemicalChangesCounter += performChemicalReactionsProductionTransfer(column, row);
+            if (grid.getState(index) != state || grid.getRnaContent(index) != rnaContent)
             {
-                isSwapAllowed = false;
-                break;
+                recordChemicalChange(index);
             }
         }
     }
-    return isSwapAllowed;
+    #pragma omp atomic
+    chemicalChanges += chemicalChangesCounter;
+    // All threads are done with this step before it is advanced
+    #pragma omp barrier
+    #pragma omp single
+    {
+        updateReactiveSites();
+        updateMoveClassesAfterChemistry();
+        ++chemicalStep;
+    }
 }
 
-bool Microemulsion::isVerticalSwapAllowedByChains(int x, int y, int nx, int ny,
-                                                  std::vector<std::reference_wrapper<ChainProperties>> &chains,
-                                                  std::vector<std::reference_wrapper<ChainProperties>> &nChains,
-                                                  int dy)
+void Microemulsion::rebuildReactiveSites()
 {
-    bool isSwapAllowed;
-    // In this case we are swapping vertically
-    isSwapAllowed = true;
-    if (!chains.empty())
+    reactiveSites.clear();
+    reactiveSlot.assign(static_cast<size_t>(grid.getExtendedColumns() * grid.getExtendedRows()), NO_REACTIVE_SLOT);
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
     {
-        // Check if swap is ok for current cell
-        for (auto &chain : chains)
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
         {
-            if (!isSwapAllowedByChainNeighboursInVerticalCase(x, y, dy, chain))
+            int index = grid.getIndex(column, row);
+            if (isReactiveSite(index))
             {
-                isSwapAllowed = false;
-                break;
+                reactiveSlot[index] = static_cast<int>(reactiveSites.size());
+                reactiveSites.push_back(index);
             }
         }
     }
-    if (!nChains.empty())
+    if (isRnaDecayLazy)
     {
-        // Check if swap is ok for swap candidate
-        for (auto &chain : nChains)
+        // Waiting times are memoryless: drawing them anew, e.g. after a change of rates, does not bias decay
+        nextRnaDecayStep.resize(reactiveSlot.size());
+        for (int index : reactiveSites)
         {
-            if (!isSwapAllowedByChainNeighboursInVerticalCase(nx, ny, -dy, chain))
+            if (grid.isRBP(index) && grid.getRnaContent(index) > 0)
             {
-                isSwapAllowed = false;
-                break;
+                auto stream = getRandomStream(index, chemicalStep, CounterBasedGenerator::LAZY_RNA_DECAY_PURPOSE);
+                scheduleRnaDecay(index, chemicalStep, stream);
             }
         }
     }
-    return isSwapAllowed;
-}
-
-bool Microemulsion::isSwapAllowedByChainNeighboursInDiagonalCase(int x, int y, int dx, int dy,
-                                                                 ChainProperties &chainProperties)
-{
-    bool horizontalCheck = grid.isCellNeighbourInChain(x + dx, y, chainProperties);
-    bool verticalCheck = grid.isCellNeighbourInChain(x, y + dy, chainProperties);
-    return (horizontalCheck && verticalCheck)
-           ||
-           (grid.isLastOfChain(x, y, chainProperties)
-            && (horizontalCheck || verticalCheck)
-           );
+    areReactiveSitesValid = true;
+    logger.logMsg(INFO, "Microemulsion::rebuildReactiveSites %s=%d", DUMP(reactiveSites.size()));
 }
 
-bool Microemulsion::isSwapAllowedByChainNeighboursInHorizontalCase(int x, int y, int dx,
-                                                                   ChainProperties &chainProperties)
+void Microemulsion::updateReactiveSites()
 {
-    // Here it is easier to check on the complementary of the intersection of
-    // the neighbours of cell and swap candidate.
-    // On this area we want no neighbour, otherwise swap is impossible.
-    // Also, we don't need to care about being at last position or not!
-    bool isSwapAllowed = true;
-    for (signed char k = -1; k <= 1; ++k)
+    size_t numKept = 0;
+    for (int index : reactiveSites)
     {
-        if (grid.isCellNeighbourInChain(x - dx, y + k,
-                                        chainProperties)) // checking on x-dx ensures being on the complementary
+        if (isReactiveSite(index))
         {
-            isSwapAllowed = false;
-            break;
+            reactiveSlot[index] = static_cast<int>(numKept);
+            reactiveSites[numKept++] = index;
+        }
+        else
+        {
+            reactiveSlot[index] = NO_REACTIVE_SLOT;
         }
     }
-    return isSwapAllowed;
-}
-
-bool Microemulsion::isSwapAllowedByChainNeighboursInVerticalCase(int x, int y, int dy,
-                                                                 ChainProperties &chainProperties)
-{
-    // Here it is easier to check on the complementary of the intersection of
-    // the neighbours of cell and swap candidate.
-    // On this area we want no neighbour, otherwise swap is impossible.
-    // Also, we don't need to care about being at last position or not!
-    bool isSwapAllowed = true;
-    for (signed char k = -1; k <= 1; ++k)
+    reactiveSites.resize(numKept);
+    for (auto &threadNewReactiveSites : newReactiveSites)
     {
-        if (grid.isCellNeighbourInChain(x + k, y - dy, chainProperties))
+        for (int index : threadNewReactiveSites)
         {
-            isSwapAllowed = false;
-            break;
+            reactiveSlot[index] = static_cast<int>(reactiveSites.size());
+            reactiveSites.push_back(index);
         }
+        threadNewReactiveSites.clear();
     }
-    return isSwapAllowed;
 }
 
-unsigned int Microemulsion::performChemicalReactions()
+void Microemulsion::sortChromatinSitesByColour()
 {
-    logger.logMsg(INFO, "Performing chemical reactions");
-    unsigned int chemicalChangesCounter = 0;
-    // Phase 1:
-    // Decay "old" RNA
-//    #pragma omp parallel
-//    {
-//        #pragma omp for reduction(+:chemicalChangesCounter) schedule(dynamic)
-        for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
-        {
-            for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
-            {
-                // Chemical reaction takes place on each cell of the grid.
-                chemicalChangesCounter += performChemicalReactionsDecay(column, row);
-            }
-        }
-//        #pragma omp barrier
-        // Phase 2:
-        // Switch chromatin activity, produce RNA, transfer RNA
-//        #pragma omp for reduction(+:chemicalChangesCounter) schedule(dynamic)
-        for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    for (auto &colourSites : chromatinSitesByColour)
+    {
+        colourSites.clear();
+    }
+    for (int index : reactiveSites)
+    {
+        if (grid.isChromatin(index))
         {
-            for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
-            {
-                // Chemical reaction takes place on each cell of the grid.
-                chemicalChangesCounter += performChemicalReactionsProductionTransfer(column, row);
-            }
+            int column = grid.getColumnOfIndex(index), row = grid.getRowOfIndex(index);
+            chromatinSitesByColour[(row % chemistryColourStride) * chemistryColourStride
+                                   + column % chemistryColourStride].push_back(index);
         }
-//    }
-    return chemicalChangesCounter;
+    }
 }
 
-bool Microemulsion::performChemicalReactionsProductionTransfer(int column, int row)
+unsigned int Microemulsion::performChemicalReactionsProductionTransfer(int column, int row)
 {
-    bool isChemPropChanged = false;
-    CellData &cellData = grid.getElement(column, row);
+    unsigned int chemicalChanges = 0;
+    bool isSwitched = false;
+    int index = grid.getIndex(column, row);
+    auto stream = getRandomStream(index, chemicalStep, CounterBasedGenerator::CHEMISTRY_PRODUCTION_TRANSFER_PURPOSE);
     // 1) Switch chromatin activity level
-    if (cellData.isChromatin())
+    if (grid.isChromatin(index))
     {
         // Reaction for Chromatin
-        bool isTranscribable = cellData.isTranscribable();
-        isChemPropChanged = performActivitySwitchingReaction(cellData,
-                                                             isTranscribable * kChromPlus, kChromMinus);
+        bool isTranscribable = grid.isTranscribable(index);
+        isSwitched = performActivitySwitchingReaction(index, isTranscribable * kChromPlus, kChromMinus, stream);
+        chemicalChanges += isSwitched;
         
         //todo: Check if the transcribability reaction is ok here or should be performed in a different place
-        bool isTranscriptionAllowed = !cellData.isTranscriptionInhibited();
-        performTranscribabilitySwitchingReaction(cellData, isTranscriptionAllowed * kOn, kOff);
+        bool isTranscriptionAllowed = !grid.isTranscriptionInhibited(index);
+        chemicalChanges += performTranscribabilitySwitchingReaction(index, isTranscriptionAllowed * kOn, kOff, stream);
     }
-    // 2) Now produce and accumulate RNA on active chromatin sites
-    if (cellData.isActiveChromatin())
+    // 2) Now produce and accumulate RNA on active chromatin sites, from the step after they switched on
+    if (!isSwitched && grid.isActiveChromatin(index))
     {
-        isChemPropChanged = isChemPropChanged
-                            || performRnaAccumulationReaction(cellData, kRnaPlus);
-        
+        chemicalChanges += performRnaAccumulationReaction(index, kRnaPlus, stream);
     }
     // 3) Now distribute RNA to RBP sites
-    if (cellData.isChromatin() && cellData.getRnaContent() > 0)
+    if (grid.isChromatin(index) && grid.getRnaContent(index) > 0)
     {
         //todo: What happens to the contained RNA if the chromatin is switched to inactive?
         //todo(2): Short answer: we just keep transferring it until it eventually disappears (we could alternatively also force it out)
-        performRnaTransferReaction(column, row, kRnaTransfer);
+        chemicalChanges += performRnaTransferReaction(column, row, kRnaTransfer, stream);
     }
     
-    return isChemPropChanged;
+    return chemicalChanges;
 }
 
-bool Microemulsion::performChemicalReactionsDecay(int column, int row)
+unsigned int Microemulsion::performChemicalReactionsDecay(int column, int row)
 {
-    bool isChemPropChanged = false;
-    CellData &cellData = grid.getElement(column, row);
+    unsigned int decayedRnaCount = 0;
+    int index = grid.getIndex(column, row);
+    auto stream = getRandomStream(index, chemicalStep, CounterBasedGenerator::CHEMISTRY_DECAY_PURPOSE);
     
     // 4) Now let RNA decay from active chromatin and RBP sites
-    if (cellData.isRBP())
+    if (grid.isRBP(index))
     {
-        isChemPropChanged = isChemPropChanged
-                || performRnaDecayReaction(cellData, kRnaMinusRbp);
+        decayedRnaCount += performRnaDecayReaction(index, kRnaMinusRbp, stream);
     }
-    if (cellData.isChromatin())
+    if (grid.isChromatin(index))
     {
-        isChemPropChanged = isChemPropChanged
-                || performRnaDecayReaction(cellData, kRnaMinusTxn);
+        decayedRnaCount += performRnaDecayReaction(index, kRnaMinusTxn, stream);
     }
     // 5) Now set as non-active RBP sites which have reached 0 RNA
-    if (cellData.isActiveRBP() && cellData.getRnaContent() == 0)
+    if (grid.isActiveRBP(index) && grid.getRnaContent(index) == 0)
     {
-        cellData.setActivity(NOT_ACTIVE);
+        grid.setActivity(index, NOT_ACTIVE);
     }
-    return isChemPropChanged;
+    return decayedRnaCount;
 }
 
 bool
-Microemulsion::performActivitySwitchingReaction(CellData &cellData, double reactionRatePlus, double reactionRateMinus)
+Microemulsion::performActivitySwitchingReaction(int index, double reactionRatePlus, double reactionRateMinus,
+                                                CounterBasedGenerator::Stream &stream)
 {
     bool isSwitched = false;
-    if (cellData.isActive())
+    if (grid.isActive(index))
     {
-        if (randomChoiceWithProbability(dtChem * reactionRateMinus))
+        if (stream.randomChoiceWithProbability(dtChem * reactionRateMinus))
         {
-            cellData.setActivity(NOT_ACTIVE);
+            grid.setActivity(index, NOT_ACTIVE);
             isSwitched = true;
         }
     }
     else
     {
-        if (randomChoiceWithProbability(dtChem * reactionRatePlus))
+        if (stream.randomChoiceWithProbability(dtChem * reactionRatePlus))
         {
-            cellData.setActivity(ACTIVE);
+            grid.setActivity(index, ACTIVE);
             isSwitched = true;
         }
     }
@@ -576,57 +955,305 @@ Microemulsion::performActivitySwitchingReaction(CellData &cellData, double react
 }
 
 bool
-Microemulsion::performRnaAccumulationReaction(CellData &cellData, double reactionRatePlus)
+Microemulsion::performRnaAccumulationReaction(int index, double reactionRatePlus, CounterBasedGenerator::Stream &stream)
 {
     bool isSwitched = false;
-    if (randomChoiceWithProbability(dtChem * reactionRatePlus))
+    if (stream.randomChoiceWithProbability(dtChem * reactionRatePlus))
     {
-        cellData.incrementRnaContent();
+        grid.incrementRnaContent(index);
         isSwitched = true;
     }
     return isSwitched;
 }
 
-bool Microemulsion::performRnaDecayReaction(CellData &cellData, double reactionRateMinus)
+RnaCounter Microemulsion::performRnaDecayReaction(int index, double reactionRateMinus,
+                                                  CounterBasedGenerator::Stream &stream)
 {
-    bool isSwitched = false;
-    RnaCounter initialRnaContent = cellData.rnaContent;
-    for (RnaCounter rnaUnit = 0; rnaUnit < initialRnaContent; ++rnaUnit)
+    // Each RNA unit decays independently with the same probability
+    auto decayedRnaCount = static_cast<RnaCounter>(stream.binomial(grid.getRnaContent(index),
+                                                                   dtChem * reactionRateMinus));
+    grid.decrementRnaContent(index, decayedRnaCount);
+    return decayedRnaCount;
+}
+
+unsigned int Microemulsion::performChemicalEvents(double endTime)
+{
+    unsigned int count = 0;
+    if (getNextChemicalEventTime() <= endTime)
     {
-        if (randomChoiceWithProbability(dtChem * reactionRateMinus))
+        // A single sequential stream per call, the engine runs serially
+        auto stream = getRandomStream(0, chemicalStep++, CounterBasedGenerator::CHEMISTRY_EVENT_PURPOSE);
+        do
         {
-            cellData.decrementRnaContent();
-            isSwitched = true;
+            chemicalTime = nextChemicalEventTime;
+            int slot = propensityTree.pickLeaf(stream.uniformDouble() * propensityTree.getTotalPropensity());
+            count += performChemicalEvent(reactiveSites[slot], stream);
+            // Waiting times are exponential, hence memoryless: one crossing the end of the interval is kept for later
+            drawNextChemicalEvent(stream);
         }
+        while (nextChemicalEventTime <= endTime);
     }
-    return isSwitched;
+    chemicalTime = std::max(chemicalTime, endTime);
+    LOG_MSG(logger, DEBUG, "Microemulsion::performChemicalEvents %s=%d", DUMP(count));
+    return count;
+}
+
+double Microemulsion::getNextChemicalEventTime()
+{
+    if (!isPropensityTreeValid)
+    {
+        rebuildPropensityTree();
+    }
+    if (!isNextChemicalEventDrawn)
+    {
+        auto stream = getRandomStream(0, chemicalStep++, CounterBasedGenerator::CHEMISTRY_EVENT_PURPOSE);
+        drawNextChemicalEvent(stream);
+    }
+    return nextChemicalEventTime;
+}
+
+void Microemulsion::drawNextChemicalEvent(CounterBasedGenerator::Stream &stream)
+{
+    double totalPropensity = propensityTree.getTotalPropensity();
+    nextChemicalEventTime = std::numeric_limits<double>::infinity();
+    if (totalPropensity > 0)
+    {
+        nextChemicalEventTime = chemicalTime - std::log1p(-stream.uniformDouble()) / totalPropensity;
+    }
+    isNextChemicalEventDrawn = true;
+}
+
+double Microemulsion::computeChannelPropensities(int index, double *propensities) const
+{
+    std::fill(propensities, propensities + numChemicalChannels, 0.0);
+    RnaCounter rnaContent = grid.getRnaContent(index);
+    if (grid.isChromatin(index))
+    {
+        propensities[0] = grid.isActive(index) ? kChromMinus : grid.isTranscribable(index) * kChromPlus;
+        propensities[1] = grid.isTranscribable(index) ? kOff : !grid.isTranscriptionInhibited(index) * kOn;
+        propensities[2] = grid.isActive(index) * kRnaPlus;
+        propensities[3] = rnaContent * kRnaMinusTxn;
+        propensities[4] = rnaContent * kRnaTransfer * 8;
+    }
+    else if (grid.isRBP(index))
+    {
+        propensities[5] = rnaContent * kRnaMinusRbp;
+    }
+    double totalPropensity = 0;
+    for (int channel = 0; channel < numChemicalChannels; ++channel)
+    {
+        totalPropensity += propensities[channel];
+    }
+    return totalPropensity;
+}
+
+void Microemulsion::rebuildPropensityTree()
+{
+    reactiveSites.clear();
+    freeReactiveSlots.clear();
+    reactiveSlot.assign(static_cast<size_t>(grid.getExtendedColumns() * grid.getExtendedRows()), NO_REACTIVE_SLOT);
+    propensityTree.reset(grid.getColumns() * grid.getRows());
+    areReactiveSitesValid = true;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            updateSitePropensity(grid.getIndex(column, row));
+        }
+    }
+    isPropensityTreeValid = true;
+    isNextChemicalEventDrawn = false; // The total propensity may have changed
+    logger.logMsg(INFO, "Microemulsion::rebuildPropensityTree %s=%d", DUMP(reactiveSites.size()));
+}
+
+void Microemulsion::updateSitePropensity(int index)
+{
+    double propensities[numChemicalChannels];
+    double propensity = computeChannelPropensities(index, propensities);
+    int slot = reactiveSlot[index];
+    if (slot == NO_REACTIVE_SLOT)
+    {
+        if (propensity <= 0)
+        {
+            return;
+        }
+        if (freeReactiveSlots.empty())
+        {
+            slot = static_cast<int>(reactiveSites.size());
+            reactiveSites.push_back(index);
+        }
+        else
+        {
+            slot = freeReactiveSlots.back();
+            freeReactiveSlots.pop_back();
+            reactiveSites[slot] = index;
+        }
+        reactiveSlot[index] = slot;
+    }
+    else if (propensity <= 0)
+    {
+        reactiveSlot[index] = NO_REACTIVE_SLOT;
+        reactiveSites[slot] = NO_REACTIVE_SLOT;
+        freeReactiveSlots.push_back(slot);
+    }
+    propensityTree.setPropensity(slot, propensity);
 }
 
-RnaCounter Microemulsion::performRnaTransferReaction(int column, int row, double transferRate)
+bool Microemulsion::performChemicalEvent(int index, CounterBasedGenerator::Stream &stream)
+{
+    double propensities[numChemicalChannels];
+    double randomPropensity = stream.uniformDouble() * computeChannelPropensities(index, propensities);
+    int channel = 0;
+    // Rounding may leave randomPropensity past the last channel: fall back on the last non-empty one
+    while (channel < numChemicalChannels - 1
+           && (randomPropensity >= propensities[channel] || propensities[channel] <= 0))
+    {
+        randomPropensity -= propensities[channel];
+        ++channel;
+    }
+    while (propensities[channel] <= 0)
+    {
+        --channel;
+    }
+    switch (channel)
+    {
+        case 0:
+            grid.setActivity(index, grid.isActive(index) ? NOT_ACTIVE : ACTIVE);
+            break;
+        case 1:
+            grid.setTranscribability(index, grid.isTranscribable(index) ? NOT_TRANSCRIBABLE : TRANSCRIBABLE);
+            break;
+        case 2:
+            grid.incrementRnaContent(index);
+            break;
+        case 3:
+            grid.decrementRnaContent(index, 1);
+            break;
+        case 4:
+        {
+            int direction = static_cast<int>(stream.uniformInt(8));
+            int nColumn = grid.getColumnOfIndex(index) + Grid::directionOffsets[direction][0];
+            int nRow = grid.getRowOfIndex(index) + Grid::directionOffsets[direction][1];
+            int neighbourIndex = grid.getIndex(nColumn, nRow);
+            if (!grid.isRBP(neighbourIndex))
+            {
+                return false; // Proposed towards a cell which cannot take RNA: rejected
+            }
+            grid.decrementRnaContent(index, 1);
+            grid.incrementRnaContent(neighbourIndex);
+            grid.setActivity(neighbourIndex, ACTIVE);
+            if (grid.isInnerIndex(neighbourIndex))
+            {
+                updateSitePropensity(neighbourIndex);
+            }
+            if (isMoveClassTableValid)
+            {
+                updateMoveClasses(neighbourIndex * 8, changedCellMoveOffsets);
+            }
+            break;
+        }
+        default:
+            grid.decrementRnaContent(index, 1);
+            if (grid.getRnaContent(index) == 0)
+            {
+                grid.setActivity(index, NOT_ACTIVE);
+            }
+            break;
+    }
+    updateSitePropensity(index);
+    // Activity and RNA content change the energy of swaps
+    if (isMoveClassTableValid)
+    {
+        updateMoveClasses(index * 8, changedCellMoveOffsets);
+    }
+    return true;
+}
+
+RnaCounter Microemulsion::performScheduledRnaDecayReaction(int index, CounterBasedGenerator::Stream &stream)
+{
+    // Draw the number of decayed units conditioned on at least one, exactly: the first decaying unit (in any fixed
+    // order of the units) follows a geometric law truncated to the units, the ones after it decay independently.
+    RnaCounter rnaContent = grid.getRnaContent(index);
+    double decayProbability = fmin(dtChem * kRnaMinusRbp, 1);
+    double allSurviveProbability = std::pow(1 - decayProbability, rnaContent);
+    double firstDecayed = (decayProbability < 1)
+                          ? std::floor(std::log1p(-stream.uniformDouble() * (1 - allSurviveProbability))
+                                       / std::log1p(-decayProbability))
+                          : 0;
+    auto survivorsAfterFirst = static_cast<unsigned int>(rnaContent - 1 - fmin(firstDecayed, rnaContent - 1));
+    auto decayedRnaCount = static_cast<RnaCounter>(1 + stream.binomial(survivorsAfterFirst, decayProbability));
+    grid.decrementRnaContent(index, decayedRnaCount);
+    if (grid.getRnaContent(index) == 0)
+    {
+        grid.setActivity(index, NOT_ACTIVE);
+    }
+    else
+    {
+        scheduleRnaDecay(index, chemicalStep + 1, stream);
+    }
+    return decayedRnaCount;
+}
+
+void Microemulsion::scheduleRnaDecay(int index, uint64_t firstStep, CounterBasedGenerator::Stream &stream)
+{
+    // Steps without decay events are Bernoulli trials with success probability (1 - decayProbability)^rnaContent
+    double decayProbability = fmin(dtChem * kRnaMinusRbp, 1);
+    if (decayProbability <= 0)
+    {
+        nextRnaDecayStep[index] = std::numeric_limits<uint64_t>::max();
+        return;
+    }
+    double waitingSteps = 0;
+    if (decayProbability < 1)
+    {
+        waitingSteps = std::floor(std::log1p(-stream.uniformDouble())
+                                  / (grid.getRnaContent(index) * std::log1p(-decayProbability)));
+    }
+    const double maxWaitingSteps = 1e18; // Far beyond any run, and away from overflows
+    nextRnaDecayStep[index] = firstStep + static_cast<uint64_t>(fmin(waitingSteps, maxWaitingSteps));
+}
+
+RnaCounter Microemulsion::performRnaTransferReaction(int column, int row, double transferRate,
+                                                     CounterBasedGenerator::Stream &stream)
 {
     RnaCounter transferredRnaCount = 0;
-    CellData &cellData = grid.getElement(column, row);
-    RnaCounter rnaContent = cellData.getRnaContent();
-//    std::vector<std::reference_wrapper<CellData>> rbpNeighbours = grid.getNeighboursMatchingConditions(column, row,
-//                                                                                                       CellData::isRBP);
-    std::vector<std::reference_wrapper<CellData>> rbpNeighbours = grid.getNeighboursMatchingConditions(column, row,
-                                                                                                       [](CellData &cd) -> bool {return cd.isRBP();}
-                                                                                                       );
+    int index = grid.getIndex(column, row);
+    RnaCounter rnaContent = grid.getRnaContent(index);
+    int rbpNeighbours[8];
+    unsigned char numNeighbours = grid.getNeighboursMatchingConditions(column, row, CellData::isRBP,
+                                                                       rbpNeighbours);
     
-    unsigned long numNeighbours = rbpNeighbours.size();
     if (numNeighbours > 0)
     {
-        std::uniform_int_distribution<unsigned char> distribution(0, static_cast<unsigned char>(numNeighbours - 1));
-        for (RnaCounter rnaUnit = 0; rnaUnit < rnaContent; ++rnaUnit)
+        // Each RNA unit is transferred independently, the more the neighbours, the more the chance of being transferred
+        transferredRnaCount = static_cast<RnaCounter>(stream.binomial(rnaContent,
+                                                                      dtChem * transferRate * numNeighbours));
+        grid.decrementRnaContent(index, transferredRnaCount);
+        // Each transferred unit goes to a random RBP-neighbour: multinomial split, as a chain of binomials
+        RnaCounter remainingRnaCount = transferredRnaCount;
+        for (unsigned char neighbour = 0; neighbour < numNeighbours && remainingRnaCount > 0; ++neighbour)
         {
-            if (randomChoiceWithProbability(dtChem * transferRate * numNeighbours)) // The more the neighbours, the more the chance of being transferred
+            auto neighbourRnaCount = static_cast<RnaCounter>(
+                    stream.binomial(remainingRnaCount, 1.0 / (numNeighbours - neighbour)));
+            if (neighbourRnaCount > 0)
             {
-                // Choose a random RBP-neighbour and transfer 1 RNA to it
-                CellData &randomNeighbour = rbpNeighbours[distribution(randomGenerator)];
-                cellData.decrementRnaContent();
-                randomNeighbour.incrementRnaContent();
+                int neighbourIndex = rbpNeighbours[neighbour];
+                grid.incrementRnaContent(neighbourIndex, neighbourRnaCount);
                 //todo: evaluate if setting activity of RBP is now superfluous
-                randomNeighbour.setActivity(ACTIVE);
+                grid.setActivity(neighbourIndex, ACTIVE);
+                recordChemicalChange(neighbourIndex);
+                if (isRnaDecayLazy)
+                {
+                    // The decay of this step already happened in phase 1, the new content decays from the next one
+                    scheduleRnaDecay(neighbourIndex, chemicalStep + 1, stream);
+                }
+                // Within a colour no other site reaches this neighbour, so the slot can be claimed without locking
+                if (reactiveSlot[neighbourIndex] == NO_REACTIVE_SLOT && grid.isInnerIndex(neighbourIndex))
+                {
+                    reactiveSlot[neighbourIndex] = PENDING_REACTIVE_SLOT;
+                    newReactiveSites[omp_get_thread_num()].push_back(neighbourIndex);
+                }
+                remainingRnaCount -= neighbourRnaCount;
             }
         }
     }
@@ -634,80 +1261,251 @@ RnaCounter Microemulsion::performRnaTransferReaction(int column, int row, double
     return transferredRnaCount;
 }
 
-bool Microemulsion::performTranscribabilitySwitchingReaction(CellData &cellData, double reactionRatePlus,
-                                                             double reactionRateMinus)
+bool Microemulsion::performTranscribabilitySwitchingReaction(int index, double reactionRatePlus,
+                                                             double reactionRateMinus,
+                                                             CounterBasedGenerator::Stream &stream)
 {
     bool isSwitched = false;
-    if (cellData.isTranscribable())
+    if (grid.isTranscribable(index))
     {
-        if (randomChoiceWithProbability(dtChem * reactionRateMinus))
+        if (stream.randomChoiceWithProbability(dtChem * reactionRateMinus))
         {
-            cellData.setTranscribability(NOT_TRANSCRIBABLE);
+            grid.setTranscribability(index, NOT_TRANSCRIBABLE);
             isSwitched = true;
         }
     }
     else
     {
-        if (randomChoiceWithProbability(dtChem * reactionRatePlus))
+        if (stream.randomChoiceWithProbability(dtChem * reactionRatePlus))
         {
-            cellData.setTranscribability(TRANSCRIBABLE);
+            grid.setTranscribability(index, TRANSCRIBABLE);
             isSwitched = true;
         }
     }
     return isSwitched;
 }
 
+void Microemulsion::setSwapEngine(SwapEngine swapEngine)
+{
+    logger.logMsg(PRODUCTION, "Microemulsion::setSwapEngine %s=%d", DUMP(swapEngine));
+    Microemulsion::swapEngine = swapEngine;
+    isMoveClassTableValid = false;
+}
+
+void Microemulsion::setChemistryEngine(ChemistryEngine chemistryEngine)
+{
+    logger.logMsg(PRODUCTION, "Microemulsion::setChemistryEngine %s=%d", DUMP(chemistryEngine));
+    Microemulsion::chemistryEngine = chemistryEngine;
+    // The engines keep reactiveSites in different layouts
+    areReactiveSitesValid = false;
+    isPropensityTreeValid = false;
+}
+
+void Microemulsion::setSwapDecomposition(SwapDecomposition swapDecomposition)
+{
+    logger.logMsg(PRODUCTION, "Microemulsion::setSwapDecomposition %s=%d", DUMP(swapDecomposition));
+    Microemulsion::swapDecomposition = swapDecomposition;
+}
+
+void Microemulsion::setLazyRnaDecay(bool isRnaDecayLazy)
+{
+    logger.logMsg(PRODUCTION, "Microemulsion::setLazyRnaDecay %s=%d", DUMP(isRnaDecayLazy));
+    Microemulsion::isRnaDecayLazy = isRnaDecayLazy;
+    areReactiveSitesValid = false; // Decay steps are drawn with the list
+}
+
 void Microemulsion::setDtChem(double dtChem)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setDtChem %s=%f", DUMP(dtChem));
+    areReactiveSitesValid = areReactiveSitesValid && !isRnaDecayLazy; // Decay steps were drawn with the old rate
     Microemulsion::dtChem = dtChem;
 }
 
+double Microemulsion::computeChemistryTimeStep(double maxReactionProbability) const
+{
+    bool hasChromatin = false, hasActiveChromatin = false, hasRna = false;
+    auto checkSite = [&](int index)
+    {
+        hasChromatin = hasChromatin || grid.isChromatin(index);
+        hasActiveChromatin = hasActiveChromatin || grid.isActiveChromatin(index);
+        hasRna = hasRna || grid.getRnaContent(index) > 0;
+    };
+    if (areReactiveSitesValid && chemistryEngine == TAU_LEAPING_CHEMISTRY_ENGINE)
+    {
+        // Every cell holding chromatin or RNA is a reactive site
+        for (int index : reactiveSites)
+        {
+            checkSite(index);
+        }
+    }
+    else
+    {
+        for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+        {
+            for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+            {
+                checkSite(grid.getIndex(column, row));
+            }
+        }
+    }
+    // What may still happen with the current rates, not just what is there now
+    bool canHaveActiveChromatin = hasActiveChromatin || (hasChromatin && kChromPlus > 0);
+    bool canHaveRna = hasRna || (canHaveActiveChromatin && kRnaPlus > 0);
+    double maxRate = 0;
+    if (hasChromatin)
+    {
+        maxRate = std::max({maxRate, kOn, kOff, kChromPlus, kChromMinus});
+    }
+    if (canHaveActiveChromatin)
+    {
+        maxRate = std::max(maxRate, kRnaPlus);
+    }
+    if (canHaveRna)
+    {
+        maxRate = std::max({maxRate, kRnaMinusRbp, kRnaMinusTxn, kRnaTransfer});
+    }
+    double timeStep = (maxRate > 0) ? maxReactionProbability / maxRate : std::numeric_limits<double>::infinity();
+    logger.logMsg(INFO, "Microemulsion::computeChemistryTimeStep %s=%f, %s=%f", DUMP(maxRate), DUMP(timeStep));
+    return timeStep;
+}
+
+void Microemulsion::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("MEMU");
+    writer.write(RandomGenerator::getInstance().getSeed());
+    writer.write(swapEngine);
+    writer.write(swapDecomposition);
+    writer.write(chemistryEngine);
+    writer.write(isRnaDecayLazy);
+    writer.write(swapRound);
+    writer.write(chemicalStep);
+    writer.write(chemicalTime);
+    writer.write(isNextChemicalEventDrawn);
+    writer.write(nextChemicalEventTime);
+    const double rates[] = {dtChem, kOn, kOff, kChromPlus, kChromMinus, kRnaPlus, kRnaMinusRbp, kRnaMinusTxn,
+                            kRnaTransfer};
+    writer.writeArray(rates, sizeof(rates) / sizeof(double));
+    // Bookkeeping of the engines: rebuilding it would give the same content in a different order
+    writer.write(isMoveClassTableValid);
+    if (isMoveClassTableValid)
+    {
+        moveClassTable.writeCheckpoint(writer);
+    }
+    writer.write(areReactiveSitesValid);
+    if (areReactiveSitesValid)
+    {
+        writer.writeVector(reactiveSites);
+        writer.writeVector(reactiveSlot);
+        writer.writeVector(nextRnaDecayStep);
+    }
+    writer.write(isPropensityTreeValid);
+    if (isPropensityTreeValid)
+    {
+        propensityTree.writeCheckpoint(writer);
+        writer.writeVector(freeReactiveSlots);
+    }
+}
+
+void Microemulsion::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("MEMU");
+    reader.expectValue(RandomGenerator::getInstance().getSeed(), "the seed");
+    reader.expectValue(swapEngine, "the swap engine");
+    reader.expectValue(swapDecomposition, "the swap decomposition");
+    reader.expectValue(chemistryEngine, "the chemistry engine");
+    reader.expectValue(isRnaDecayLazy, "the lazy RNA decay");
+    swapRound = reader.read<uint64_t>();
+    chemicalStep = reader.read<uint64_t>();
+    chemicalTime = reader.read<double>();
+    isNextChemicalEventDrawn = reader.read<bool>();
+    nextChemicalEventTime = reader.read<double>();
+    double rates[9];
+    reader.readArray(rates, 9);
+    dtChem = rates[0];
+    kOn = rates[1];
+    kOff = rates[2];
+    kChromPlus = rates[3];
+    kChromMinus = rates[4];
+    kRnaPlus = rates[5];
+    kRnaMinusRbp = rates[6];
+    kRnaMinusTxn = rates[7];
+    kRnaTransfer = rates[8];
+    isMoveClassTableValid = reader.read<bool>();
+    if (isMoveClassTableValid)
+    {
+        moveClassTable.readCheckpoint(reader);
+    }
+    areReactiveSitesValid = reader.read<bool>();
+    if (areReactiveSitesValid)
+    {
+        reader.readVector(reactiveSites);
+        reader.readVector(reactiveSlot);
+        reader.readVector(nextRnaDecayStep);
+    }
+    isPropensityTreeValid = reader.read<bool>();
+    if (isPropensityTreeValid)
+    {
+        propensityTree.readCheckpoint(reader);
+        reader.readVector(freeReactiveSlots);
+    }
+    logger.logMsg(PRODUCTION, "Microemulsion::readCheckpoint %s=%lu, %s=%lu, %s=%f", DUMP(swapRound),
+                  DUMP(chemicalStep), DUMP(dtChem));
+}
+
 void Microemulsion::setKOn(double kOn)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKOn %s=%f", DUMP(kOn));
     Microemulsion::kOn = kOn;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKOff(double kOff)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKOff %s=%f", DUMP(kOff));
     Microemulsion::kOff = kOff;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKChromPlus(double kChromPlus)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKChromPlus %s=%f", DUMP(kChromPlus));
     Microemulsion::kChromPlus = kChromPlus;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKChromMinus(double kChromMinus)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKChromMinus %s=%f", DUMP(kChromMinus));
     Microemulsion::kChromMinus = kChromMinus;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKRnaPlus(double kRnaPlus)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKRnaPlus %s=%f", DUMP(kRnaPlus));
     Microemulsion::kRnaPlus = kRnaPlus;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKRnaMinusRbp(double kRnaMinusRbp)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKRnaMinusRbp %s=%f", DUMP(kRnaMinusRbp));
+    areReactiveSitesValid = areReactiveSitesValid && !isRnaDecayLazy; // Decay steps were drawn with the old rate
     Microemulsion::kRnaMinusRbp = kRnaMinusRbp;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKRnaMinusTxn(double kRnaMinusTxn)
 {
     logger.logMsg(PRODUCTION, "Microemulsion::setKRnaMinusTxn %s=%f", DUMP(kRnaMinusTxn));
     Microemulsion::kRnaMinusTxn = kRnaMinusTxn;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setKRnaTransfer(double kRnaTransfer)
 {
     Microemulsion::kRnaTransfer = kRnaTransfer;
+    isPropensityTreeValid = false;
 }
 
 void Microemulsion::setTranscriptionInhibitionOnChains(const std::set<ChainId> &targetChains,
@@ -717,15 +1515,14 @@ void Microemulsion::setTranscriptionInhibitionOnChains(const std::set<ChainId> &
     {
         for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
         {
-            CellData &curCell = grid.getElement(column, row);
-            std::set<ChainId> curCellChains = curCell.chainsCellBelongsTo();
+            std::set<ChainId> curCellChains = grid.chainIdsCellBelongsTo(column, row);
             std::set<ChainId> matches;
             set_intersection(curCellChains.begin(), curCellChains.end(),
                              targetChains.begin(), targetChains.end(),
                              inserter(matches, matches.begin()));
             if (!matches.empty())
             {
-                curCell.setTranscriptionInhibition(inhibition);
+                grid.setTranscriptionInhibition(column, row, inhibition);
             }
         }
     }
@@ -735,12 +1532,16 @@ void Microemulsion::enablePermissivityOnChains(std::set<ChainId> targetChains)
 {
     logger.logMsg(PRODUCTION, "Transcription enabled on %d chains", targetChains.size());
     setTranscriptionInhibitionOnChains(targetChains, TRANSCRIPTION_POSSIBLE);
+    isPropensityTreeValid = false;
+    isMoveClassTableValid = false; // Cells may become distinguishable for swaps
 }
 
 void Microemulsion::disablePermissivityOnChains(std::set<ChainId> targetChains)
 {
     logger.logMsg(PRODUCTION, "Transcription inhibited on %d chains", targetChains.size());
     setTranscriptionInhibitionOnChains(targetChains, TRANSCRIPTION_INHIBITED);
+    isPropensityTreeValid = false;
+    isMoveClassTableValid = false; // Cells may become distinguishable for swaps
 }
 
 void Microemulsion::setTranscribabilityOnChains(const std::set<ChainId> &targetChains,
@@ -750,15 +1551,14 @@ void Microemulsion::setTranscribabilityOnChains(const std::set<ChainId> &targetC
     {
         for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
         {
-            CellData &curCell = grid.getElement(column, row);
-            std::set<ChainId> curCellChains = curCell.chainsCellBelongsTo();
+            std::set<ChainId> curCellChains = grid.chainIdsCellBelongsTo(column, row);
             std::set<ChainId> matches;
             set_intersection(curCellChains.begin(), curCellChains.end(),
                              targetChains.begin(), targetChains.end(),
                              inserter(matches, matches.begin()));
             if (!matches.empty())
             {
-                curCell.setTranscribability(transcribability);
+                grid.setTranscribability(column, row, transcribability);
             }
         }
     }
@@ -768,12 +1568,16 @@ void Microemulsion::enableTranscribabilityOnChains(std::set<ChainId> targetChain
 {
     logger.logMsg(PRODUCTION, "Transcribable state enabled on %d chains", targetChains.size());
     setTranscribabilityOnChains(targetChains, TRANSCRIBABLE);
+    isPropensityTreeValid = false;
+    isMoveClassTableValid = false; // Cells may become distinguishable for swaps
 }
 
 void Microemulsion::disableTranscribabilityOnChains(std::set<ChainId> targetChains)
 {
     logger.logMsg(PRODUCTION, "Transcribable state disabled on %d chains", targetChains.size());
     setTranscribabilityOnChains(targetChains, NOT_TRANSCRIBABLE);
+    isPropensityTreeValid = false;
+    isMoveClassTableValid = false; // Cells may become distinguishable for swaps
 }
 
 bool Microemulsion::isSwapBlockedByStickyBoundary(int x, int y, int nx, int ny)
@@ -8,35 +8,133 @@
 #include "../Grid/Grid.h"
 #include "../Logger/Logger.h"
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <random>
 #include "../Utils/RandomGenerator.h"
+#include "../Utils/CounterBasedGenerator.h"
+#include "MoveClassTable.h"
+#include "PropensityTree.h"
+#include "../Checkpoint/Checkpoint.h"
+
+typedef enum
+{
+    CLASSIC_SWAP_ENGINE = 0, LOOKUP_TABLE_SWAP_ENGINE = 1, REJECTION_FREE_SWAP_ENGINE = 2
+} SwapEngine;
+
+typedef enum
+{
+    COLOURED_SWAP_DECOMPOSITION = 0, TILED_SWAP_DECOMPOSITION = 1
+} SwapDecomposition;
+
+typedef enum
+{
+    TAU_LEAPING_CHEMISTRY_ENGINE = 0, EVENT_DRIVEN_CHEMISTRY_ENGINE = 1
+} ChemistryEngine;
 
 class Microemulsion
 {
 public:
     static const int colourStride = 5;
+    // Tiled decomposition: rows of a tile and width of the band, on each side of a tile boundary, whose swaps may
+    // touch the neighbouring tile. Bands of consecutive boundaries must be independent: tileRows >= 4 * bandWidth.
+    static const int tileRows = 16;
+    static const int bandWidth = 2;
+    // RNA transfer writes into the Moore neighbourhood of a cell: cells of the same chemistry colour are at least
+    // chemistryColourStride apart, so their writes never overlap and none reads what another one writes.
+    static const int chemistryColourStride = 3;
     
 private:
     Grid &grid;
     Logger &logger;
     double omega, deltaEmin;
-    static std::mt19937 randomGenerator;
-    #pragma omp threadprivate(randomGenerator)
-    static std::mt19937_64 randomGenerator_64;
-    //#pragma omp threadprivate(randomGenerator_64)
-    std::uniform_real_distribution<double> uniformProbabilityDistribution;
-    std::uniform_int_distribution<int> coloursDistribution;
+    // Every random number is drawn from a stream keyed by (seed, site, step, purpose), where the step is the
+    // swap round or the chemical step: trajectories only depend on the seed, not on the number of threads.
+    CounterBasedGenerator counterBasedGenerator;
+    uint64_t swapRound, chemicalStep;
     double dtChem, kOn, kOff, kChromPlus, kChromMinus, kRnaPlus, kRnaMinusRbp, kRnaMinusTxn, kRnaTransfer;
     bool isBoundarySticky;
+    SwapEngine swapEngine;
+    SwapDecomposition swapDecomposition;
+    // Lookup-table kernel: the energy difference of a swap is an integer multiple of omega, in [-8, 8].
+    // Swaps are accepted when a raw 32-bit random word is below the threshold for their energy count.
+    static const int maxEnergyCount = 8;
+    static constexpr uint64_t randomWordRange = 1ULL << 32;
+    uint64_t acceptanceThresholds[2 * maxEnergyCount + 1];
+    // Affinity class of a cell: chromatin bit and "marked" (active or holding RNA) bit.
+    static const unsigned char CHROMATIN_AFFINITY_BIT = 1;
+    static const unsigned char MARKED_AFFINITY_MASK = 1;
+    // Rejection-free kernel: a move is a (cell, direction bit) pair with id index*8+bit, moves are grouped by
+    // energy count and by the number of neighbours of the initiating cell, which together give their rate.
+    static const int numDegreeClasses = 3;
+    MoveClassTable moveClassTable;
+    bool isMoveClassTableValid;
+    // For each swap direction, the id offsets (from the moved cell) of the moves whose class may change.
+    std::vector<int> affectedMoveOffsets[8];
+    // Same, for a change of the state or RNA content of a single cell, as chemistry makes.
+    std::vector<int> changedCellMoveOffsets;
+    // Cells whose state or RNA content changed in this chemical step, per thread, to re-class the moves around them.
+    std::vector<std::vector<int>> chemicallyChangedCells;
+    // Reactive sites: inner chromatin cells and inner RBP cells holding RNA or active, the only cells chemistry can
+    // change. Entries follow their cells through swaps, RBP entries join and leave the list in chemistry steps.
+    // The list is built at the first chemistry step: the grid must not be changed from outside afterwards.
+    static const int NO_REACTIVE_SLOT = -1;
+    static const int PENDING_REACTIVE_SLOT = -2;
+    std::vector<int> reactiveSites;
+    std::vector<int> reactiveSlot; // Slot of each cell in reactiveSites, or one of the values above
+    std::vector<std::vector<int>> newReactiveSites; // RBP cells that received RNA in this step, per thread
+    // Chromatin reactive sites split by chemistry colour, sorted once per tau-leaping step for its colour passes
+    std::vector<int> chromatinSitesByColour[chemistryColourStride * chemistryColourStride];
+    bool areReactiveSitesValid;
+    // Lazy RNA decay: for each RBP site holding RNA, the first chemical step in which some of its RNA decays. It is
+    // drawn from the geometric law of the waiting time when the RNA content changes, so that the chemistry pass only
+    // does work on the sites whose step has come. Entries follow their cells through swaps, like reactiveSlot.
+    bool isRnaDecayLazy;
+    std::vector<uint64_t> nextRnaDecayStep;
+    // Event-driven chemistry: the leaves of the tree are the slots of reactiveSites, which hold the inner cells with
+    // a non-zero propensity. Slots freed by sites that stop reacting are reused, so the slots of the other sites and
+    // their leaves never move. Propensities only depend on the cell itself: RNA transfer is proposed towards each of
+    // the 8 neighbours at the same rate and rejected if the neighbour is not RBP, so swaps leave the tree untouched.
+    static const int numChemicalChannels = 6;
+    ChemistryEngine chemistryEngine;
+    PropensityTree propensityTree;
+    bool isPropensityTreeValid;
+    std::vector<int> freeReactiveSlots;
+    double chemicalTime; // Time up to which chemistry has been simulated by the event-driven engine
+    // Time of the next reaction event, drawn ahead so that the swap intervals can end on it. It stays valid while the
+    // total propensity does not change, i.e. until the next event or a rebuild of the tree.
+    bool isNextChemicalEventDrawn;
+    double nextChemicalEventTime;
+    // Colour of the current round of the coloured sweep, shared by the threads.
+    int sweepColour;
+    // Per-thread buffer of random blocks for the cells of a row, kept across calls.
+    static std::vector<uint32_t> randomBlocks;
+    #pragma omp threadprivate(randomBlocks)
 
 public:
     Microemulsion(Grid &grid, double omega, Logger &logger, double deltaTChem, double kOn, double kOff,
                       double kChromPlus, double kChromMinus, double kRnaPlus, double kRnaMinus,
                       double kRnaTransfer, bool isBoundarySticky);
     
+    void setSwapEngine(SwapEngine swapEngine);
+    
+    void setSwapDecomposition(SwapDecomposition swapDecomposition);
+    
+    void setChemistryEngine(ChemistryEngine chemistryEngine);
+    
     void setDtChem(double dtChem);
     
+    /**
+     * Time step for tau-leaping: maxReactionProbability over the largest rate among the channels which can still
+     * fire, so that no single channel fires on a site, or on an RNA unit, with a larger probability per step. Channels
+     * which cannot fire with the current rates, e.g. RNA decay when there is no RNA and none can be produced, are
+     * left out, so the step must be recomputed whenever a rate changes. This only caps the per-step probabilities:
+     * it is not a tau-selection bounding the relative change of the propensities (Cao, Gillespie and Petzold), and
+     * it does not adapt to the reactive population.
+     * @return The time step, infinite if no channel can fire.
+     */
+    double computeChemistryTimeStep(double maxReactionProbability) const;
+    
     void setKOn(double kOn);
     
     void setKOff(double kOff);
@@ -53,6 +151,21 @@ public:
     
     void setKRnaTransfer(double kRnaTransfer);
     
+    /**
+     * Switch the RNA decay of RBP sites between the eager mode, a binomial draw per site at every chemical step, and
+     * the lazy one, which draws the steps in which decay events happen. Both give the same statistics.
+     */
+    void setLazyRnaDecay(bool isRnaDecayLazy);
+    
+    /**
+     * Save and restore the state of the dynamics: step counters, which key the random streams, current rates and
+     * the bookkeeping of the engines, so that a restored run continues bit-exactly. A checkpoint is only restored
+     * into a microemulsion set up with the same seed and engines, on a grid restored from the same checkpoint.
+     */
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+    
     /**
      * Attempts a random swap between two neighbouring cells on the grid.
      * @return True if the swap was performed.
@@ -66,12 +179,49 @@ public:
      */
     unsigned int performRandomSwaps(unsigned int rounds);
     
+    /**
+     * Same as performRandomSwaps, to be called by all the threads of an enclosing parallel region: the work is
+     * shared among them through orphaned worksharing constructs, so no parallel region is opened per call.
+     * Called outside a parallel region, it runs on the calling thread only.
+     * @param swapsPerformed Counter shared by the threads, incremented by the number of swaps performed.
+     */
+    void performRandomSwapsInParallelRegion(unsigned int rounds, unsigned long &swapsPerformed);
+    
     /**
      * Perform the chemical reactions on the entire grid.
-     * @return The total number of chemical changes.
+     * @return The total number of chemical changes: activity and transcribability switches of chromatin, plus RNA
+     * units produced, decayed or transferred.
      */
     unsigned int performChemicalReactions();
     
+    /**
+     * Same as performChemicalReactions, to be called by all the threads of an enclosing parallel region.
+     * @param chemicalChanges Counter shared by the threads, incremented by the number of chemical changes.
+     */
+    void performChemicalReactionsInParallelRegion(unsigned long &chemicalChanges);
+    
+    /**
+     * Event-driven alternative to performChemicalReactions, without the time step bias: advance the chemistry clock
+     * to the given time, performing one by one the reaction events drawn in between (Gillespie direct method).
+     * Meant to be called after each swap sweep, with the time at its end. It runs serially.
+     * @return The number of reaction events which changed the grid: each is a single switch or RNA unit, so this
+     * counts the same changes as performChemicalReactions.
+     */
+    unsigned int performChemicalEvents(double endTime);
+    
+    /**
+     * Time of the next reaction event of the event-driven engine, drawn now if needed. Ending the swap sweeps on it
+     * lets each event see the positions at its own time, up to one sweep round, instead of those at the end of a
+     * longer interval.
+     */
+    double getNextChemicalEventTime();
+    
+    /**
+     * Check the move classes of the rejection-free engine, maintained incrementally, against those a rebuild gives.
+     * @return False if there is no table or some move is not in the class it would be rebuilt in.
+     */
+    bool isMoveClassTableConsistent();
+    
     /**
      * Switch the given chain to the transcribable state.
      * @param targetChains
@@ -103,6 +253,99 @@ private:
     
     bool doesPairRequireEnergyCost(int x, int y, int nx, int ny) const;
     
+    inline unsigned char getAffinityClass(int index) const
+    {
+        ChemicalProperties chemicalProperties = grid.getChemicalProperties(index);
+        return static_cast<unsigned char>(
+                (CellData::isChromatin(chemicalProperties) << CHROMATIN_AFFINITY_BIT)
+                | (CellData::isActive(chemicalProperties) || grid.getRnaContent(index) > 0));
+    }
+    
+    // Number of pairs requiring an energy cost between a cell of the given class and a set of neighbours
+    // containing the given amounts of chromatin and marked cells. Mirrors doesPairRequireEnergyCost.
+    static inline int countPairsRequiringEnergyCost(unsigned char cellClass, int chromatinCount, int markedCount)
+    {
+        if (!(cellClass >> CHROMATIN_AFFINITY_BIT))
+        {
+            return 0; // RBP never pays for its neighbours
+        }
+        return (cellClass & MARKED_AFFINITY_MASK) ? chromatinCount : markedCount;
+    }
+    
+    void computeAcceptanceThresholds();
+    
+    int computeDeltaEnergyCount(int x, int y, int nx, int ny) const;
+    
+    bool isSwapAcceptedByLookupTable(int x, int y, int nx, int ny, uint32_t randomWord);
+    
+    /**
+     * Rejection-free (n-fold way) version of performRandomSwaps: time runs continuously and is measured in rounds.
+     * Each cell visited by the colour sweep attempts a swap at rate 1/colourStride^2 per round towards a random
+     * neighbour, so allowed swaps happen with rate p/(colourStride^2 * neighbours) and are directly sampled.
+     * It runs serially, so it pays off only when most attempts of the classic sweep would be rejected.
+     */
+    unsigned int performRejectionFreeSwaps(unsigned int rounds);
+    
+    /**
+     * Tiled version of performRandomSwaps, visiting the same cells with the same random numbers in a different order.
+     * The grid is cut in stripes of tileRows rows. Within a batch of colourStride^2 rounds, the interior of each tile
+     * is swept for all the rounds without synchronization, since its swaps only read and write cells of the tile;
+     * then the bands across tile boundaries are swept, one thread per band. That is two barriers per batch instead of
+     * two per round. Tiles do not depend on the number of threads, and neither do trajectories.
+     * Like performColouredRandomSwaps, it returns the swaps of the calling thread and does not advance swapRound.
+     */
+    unsigned int performTiledRandomSwaps(unsigned int rounds);
+    
+    // Thread's share of the coloured sweep, with orphaned worksharing constructs like the tiled one.
+    unsigned int performColouredRandomSwaps(unsigned int rounds);
+    
+    // Colour of the cells attempting a swap in the given round.
+    inline int pickSwapColour(uint64_t round) const
+    {
+        auto colourStream = getRandomStream(0, round, CounterBasedGenerator::SWAP_COLOUR_PURPOSE);
+        return static_cast<int>(colourStream.uniformInt(colourStride * colourStride));
+    }
+    
+    /**
+     * Attempt a swap for each cell of the given row whose column has the given colour.
+     * @param blocks Buffer for the random blocks of the row, of at least 4 words per cell.
+     * @return The number of swaps performed.
+     */
+    unsigned int performRandomSwapsOnRow(int row, int columnColour, uint64_t round, uint32_t *blocks);
+    
+    // Same as above, for the rows in [beginRow, endRow) with the colour of the round.
+    unsigned int performRandomSwapsOnRows(int beginRow, int endRow, uint64_t round, uint32_t *blocks);
+    
+    void computeAffectedMoveOffsets();
+    
+    void rebuildMoveClassTable();
+    
+    // Class of the given move in the current grid, NO_CLASS if it is not allowed.
+    unsigned char computeMoveClass(int move);
+    
+    inline void updateMoveClass(int move)
+    {
+        moveClassTable.setMoveClass(move, computeMoveClass(move));
+    }
+    
+    // Re-evaluate the moves at the given id offsets from baseMove, skipping those outside the table.
+    void updateMoveClasses(int baseMove, const std::vector<int> &offsets);
+    
+    // Keep the move classes in sync with a chemical change of the cell at index, if the table is in use.
+    inline void recordChemicalChange(int index)
+    {
+        if (isMoveClassTableValid)
+        {
+            chemicallyChangedCells[omp_get_thread_num()].push_back(index);
+        }
+    }
+    
+    /**
+     * Re-class the moves around the cells recorded by recordChemicalChange in this step, in index order so that the
+     * table does not depend on the number of threads. When they are too many a rebuild is cheaper: drop the table.
+     */
+    void updateMoveClassesAfterChemistry();
+    
     inline double computeSwapProbability(double deltaEnergy)
     {
         return std::exp(deltaEmin - deltaEnergy);
@@ -111,50 +354,116 @@ private:
         // return fmin(prob, 1);
     }
     
-    inline bool randomChoiceWithProbability(double probability)
+    inline CounterBasedGenerator::Stream getRandomStream(int index, uint64_t step,
+                                                         CounterBasedGenerator::Purpose purpose) const
     {
-        return (uniformProbabilityDistribution(randomGenerator) < probability);
+        return counterBasedGenerator.getStream(static_cast<uint32_t>(index), step, purpose);
     }
     
     bool isSwapBlockedByStickyBoundary(int x, int y, int nx, int ny);
     
     bool isSwapAllowedByChainsAndMeaningful(int x, int y, int nx, int ny);
     
-    bool isDiagonalSwapAllowedByChains(int x, int y, int nx, int ny, std::vector<std::reference_wrapper<ChainProperties>> &chains,
-                                       std::vector<std::reference_wrapper<ChainProperties>> &nChains, int dx,
-                                       int dy);
+    bool isDiagonalSwapAllowedByChains(const ChainProperties *chains, const ChainProperties *nChains, int dx, int dy);
     
-    bool isHorizontalSwapAllowedByChains(int x, int y, int nx, int ny, std::vector<std::reference_wrapper<ChainProperties>> &chains,
-                                         std::vector<std::reference_wrapper<ChainProperties>> &nChains, int dx);
+    bool isHorizontalSwapAllowedByChains(const ChainProperties *chains, const ChainProperties *nChains, int dx);
     
-    bool isVerticalSwapAllowedByChains(int x, int y, int nx, int ny, std::vector<std::reference_wrapper<ChainProperties>> &chains,
-                                         std::vector<std::reference_wrapper<ChainProperties>> &nChains, int dy);
+    bool isVerticalSwapAllowedByChains(const ChainProperties *chains, const ChainProperties *nChains, int dy);
     
-    bool isSwapAllowedByChainNeighboursInDiagonalCase(int x, int y, int dx, int dy,
-                                                      ChainProperties &chainProperties);
+    bool isSwapAllowedByChainNeighboursInDiagonalCase(int dx, int dy, const ChainProperties &chainProperties);
     
-    bool isSwapAllowedByChainNeighboursInHorizontalCase(int x, int y, int dx,
-                                                      ChainProperties &chainProperties);
+    inline bool isReactiveSite(int index) const
+    {
+        return grid.isChromatin(index) || grid.getRnaContent(index) > 0 || grid.isActive(index);
+    }
+    
+    void rebuildReactiveSites();
+    
+    // Drop the sites that stopped being reactive and append the new ones.
+    void updateReactiveSites();
+    
+    void sortChromatinSitesByColour();
+    
+    // Keep the reactive site list in sync with a swap of the cells at index and nIndex.
+    inline void moveReactiveSites(int index, int nIndex)
+    {
+        if (!areReactiveSitesValid)
+        {
+            return;
+        }
+        std::swap(reactiveSlot[index], reactiveSlot[nIndex]);
+        if (isRnaDecayLazy && chemistryEngine == TAU_LEAPING_CHEMISTRY_ENGINE)
+        {
+            std::swap(nextRnaDecayStep[index], nextRnaDecayStep[nIndex]);
+        }
+        if (reactiveSlot[index] >= 0)
+        {
+            reactiveSites[reactiveSlot[index]] = index;
+        }
+        if (reactiveSlot[nIndex] >= 0)
+        {
+            reactiveSites[reactiveSlot[nIndex]] = nIndex;
+        }
+    }
     
-    bool isSwapAllowedByChainNeighboursInVerticalCase(int x, int y, int dy,
-                                                      ChainProperties &chainProperties);
+    inline void swapElements(int x, int y, int nx, int ny)
+    {
+        grid.swapElements(x, y, nx, ny);
+        moveReactiveSites(grid.getIndex(x, y), grid.getIndex(nx, ny));
+    }
     
-    // If reaction causes a change in chemical properties, return True.
-    bool performChemicalReactionsProductionTransfer(int column, int row);
+    // Return the number of chemical changes: state switches plus RNA units produced, decayed or transferred.
+    unsigned int performChemicalReactionsProductionTransfer(int column, int row);
     
-    bool performChemicalReactionsDecay(int column, int row);
+    unsigned int performChemicalReactionsDecay(int column, int row);
     
-    bool performActivitySwitchingReaction(CellData &cellData, double reactionRatePlus, double reactionRateMinus);
+    bool performActivitySwitchingReaction(int index, double reactionRatePlus, double reactionRateMinus,
+                                          CounterBasedGenerator::Stream &stream);
     
-    bool performRnaAccumulationReaction(CellData &cellData, double reactionRatePlus);
+    bool performRnaAccumulationReaction(int index, double reactionRatePlus, CounterBasedGenerator::Stream &stream);
     
-    bool performRnaDecayReaction(CellData &cellData, double reactionRateMinus);
+    RnaCounter performRnaDecayReaction(int index, double reactionRateMinus, CounterBasedGenerator::Stream &stream);
     
-    RnaCounter performRnaTransferReaction(int column, int row, double transferRate);
+    /**
+     * Lazy RNA decay of an RBP site in the step drawn for it: at least one RNA unit decays, then the step of the
+     * next decay event is drawn.
+     * @return The number of RNA units decayed.
+     */
+    RnaCounter performScheduledRnaDecayReaction(int index, CounterBasedGenerator::Stream &stream);
     
-    bool performTranscribabilitySwitchingReaction(CellData &cellData, double reactionRatePlus, double reactionRateMinus);
+    // Draw the first step, from firstStep on, in which some of the RNA of the RBP site decays.
+    void scheduleRnaDecay(int index, uint64_t firstStep, CounterBasedGenerator::Stream &stream);
     
-    bool performRandomSwap(int x, int y);
+    RnaCounter performRnaTransferReaction(int column, int row, double transferRate,
+                                          CounterBasedGenerator::Stream &stream);
+    
+    /**
+     * Propensities of the reaction channels of a cell, in the order: activity switching, transcribability
+     * switching, RNA production, RNA decay on chromatin, RNA transfer (towards any neighbour), RNA decay on RBP.
+     * @return Their sum.
+     */
+    double computeChannelPropensities(int index, double *propensities) const;
+    
+    void rebuildPropensityTree();
+    
+    // Refresh the propensity of an inner cell, giving it a slot or freeing its slot as needed.
+    void updateSitePropensity(int index);
+    
+    // Draw the time of the next reaction event from the current total propensity, infinite if nothing can react.
+    void drawNextChemicalEvent(CounterBasedGenerator::Stream &stream);
+    
+    // Perform a reaction event of the cell, picking the channel by propensity. Return true if the grid changed.
+    bool performChemicalEvent(int index, CounterBasedGenerator::Stream &stream);
+    
+    bool performTranscribabilitySwitchingReaction(int index, double reactionRatePlus, double reactionRateMinus,
+                                                  CounterBasedGenerator::Stream &stream);
+    
+    /**
+     * Attempt a swap of (x, y) with a random neighbour, consuming the first three words of the SWAP_ATTEMPT block
+     * of the cell: the neighbour word, then the high and low acceptance words.
+     */
+    bool performRandomSwap(int x, int y, uint32_t neighbourWord, uint32_t acceptanceWordHigh,
+                           uint32_t acceptanceWordLow);
 };
 
 
@@ -0,0 +1,98 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "MoveClassTable.h"
+
+const unsigned char MoveClassTable::NO_CLASS;
+
+MoveClassTable::MoveClassTable() = default;
+
+void MoveClassTable::reset(int numMoves, const std::vector<double> &rates)
+{
+    classRates = rates;
+    classMoves.assign(rates.size(), std::vector<int>());
+    moveClass.assign(static_cast<size_t>(numMoves), NO_CLASS);
+    moveSlot.assign(static_cast<size_t>(numMoves), 0);
+}
+
+void MoveClassTable::setMoveClass(int move, unsigned char newClass)
+{
+    unsigned char oldClass = moveClass[move];
+    if (oldClass == newClass)
+    {
+        return;
+    }
+    if (oldClass != NO_CLASS)
+    {
+        // Fill the hole with the last move of the class
+        std::vector<int> &moves = classMoves[oldClass];
+        int lastMove = moves.back();
+        moves[moveSlot[move]] = lastMove;
+        moveSlot[lastMove] = moveSlot[move];
+        moves.pop_back();
+    }
+    if (newClass != NO_CLASS)
+    {
+        std::vector<int> &moves = classMoves[newClass];
+        moveSlot[move] = static_cast<int>(moves.size());
+        moves.push_back(move);
+    }
+    moveClass[move] = newClass;
+}
+
+double MoveClassTable::getTotalRate() const
+{
+    double totalRate = 0;
+    for (size_t c = 0; c < classRates.size(); ++c)
+    {
+        totalRate += classMoves[c].size() * classRates[c];
+    }
+    return totalRate;
+}
+
+int MoveClassTable::pickMove(double randomRate) const
+{
+    size_t lastNonEmpty = 0;
+    for (size_t c = 0; c < classRates.size(); ++c)
+    {
+        const std::vector<int> &moves = classMoves[c];
+        if (moves.empty())
+        {
+            continue;
+        }
+        lastNonEmpty = c;
+        double classRate = moves.size() * classRates[c];
+        if (randomRate < classRate)
+        {
+            size_t k = static_cast<size_t>(randomRate / classRates[c]);
+            return moves[k < moves.size() ? k : moves.size() - 1];
+        }
+        randomRate -= classRate;
+    }
+    // Only reachable through rounding: fall back on the last move of the last non-empty class
+    return classMoves[lastNonEmpty].back();
+}
+
+void MoveClassTable::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeVector(classRates);
+    for (const std::vector<int> &moves : classMoves)
+    {
+        writer.writeVector(moves);
+    }
+    writer.writeVector(moveClass);
+    writer.writeVector(moveSlot);
+}
+
+void MoveClassTable::readCheckpoint(CheckpointReader &reader)
+{
+    reader.readVector(classRates);
+    classMoves.resize(classRates.size());
+    for (std::vector<int> &moves : classMoves)
+    {
+        reader.readVector(moves);
+    }
+    reader.readVector(moveClass);
+    reader.readVector(moveSlot);
+}
@@ -0,0 +1,57 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_MOVECLASSTABLE_H
+#define ACTIVE_MICROEMULSION_MOVECLASSTABLE_H
+
+#include <cstddef>
+#include <vector>
+#include "../Checkpoint/Checkpoint.h"
+
+/*
+ * Bookkeeping for rejection-free (n-fold way) kinetic Monte Carlo.
+ * Every move is identified by an integer id and belongs to at most one class. All the moves within a class
+ * share the same rate, so the total rate is just the sum over classes of (number of moves) * (class rate),
+ * and picking a move proportionally to its rate only requires choosing a class and then a uniform member.
+ */
+class MoveClassTable
+{
+public:
+    static const unsigned char NO_CLASS = 255;
+
+private:
+    std::vector<double> classRates;
+    std::vector<std::vector<int>> classMoves; // Dense list of the move ids of each class
+    std::vector<unsigned char> moveClass; // Class of each move id, NO_CLASS if the move is not possible
+    std::vector<int> moveSlot; // Position of each move id within its class list
+
+public:
+    MoveClassTable();
+    
+    // Drop all the moves and size the table for move ids in [0, numMoves).
+    void reset(int numMoves, const std::vector<double> &rates);
+    
+    // Put the move in the given class (NO_CLASS removes it), moving it out of its previous class if needed.
+    void setMoveClass(int move, unsigned char newClass);
+    
+    double getTotalRate() const;
+    
+    /**
+     * Pick a move with probability proportional to its rate.
+     * @param randomRate A random number uniformly distributed in [0, getTotalRate()).
+     */
+    int pickMove(double randomRate) const;
+    
+    inline unsigned char getMoveClass(int move) const
+    {
+        return moveClass[move];
+    }
+    
+    // The order of the moves within their classes is saved too, since it decides which move a random rate picks.
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+};
+
+#endif //ACTIVE_MICROEMULSION_MOVECLASSTABLE_H
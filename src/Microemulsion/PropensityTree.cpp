@@ -0,0 +1,61 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "PropensityTree.h"
+
+PropensityTree::PropensityTree()
+        : numLeaves(1), nodes(2, 0.0)
+{}
+
+void PropensityTree::reset(int numLeaves)
+{
+    PropensityTree::numLeaves = 1;
+    while (PropensityTree::numLeaves < numLeaves)
+    {
+        PropensityTree::numLeaves *= 2;
+    }
+    nodes.assign(static_cast<size_t>(2 * PropensityTree::numLeaves), 0.0);
+}
+
+void PropensityTree::setPropensity(int leaf, double propensity)
+{
+    int node = numLeaves + leaf;
+    nodes[node] = propensity;
+    for (node /= 2; node >= 1; node /= 2)
+    {
+        nodes[node] = nodes[2 * node] + nodes[2 * node + 1];
+    }
+}
+
+int PropensityTree::pickLeaf(double randomPropensity) const
+{
+    int node = 1;
+    while (node < numLeaves)
+    {
+        int left = 2 * node;
+        // Going right on an empty subtree is only possible through rounding: stay on the left then
+        if (randomPropensity < nodes[left] || nodes[left + 1] <= 0)
+        {
+            node = left;
+        }
+        else
+        {
+            randomPropensity -= nodes[left];
+            node = left + 1;
+        }
+    }
+    return node - numLeaves;
+}
+
+void PropensityTree::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.write(numLeaves);
+    writer.writeVector(nodes);
+}
+
+void PropensityTree::readCheckpoint(CheckpointReader &reader)
+{
+    numLeaves = reader.read<int>();
+    reader.readVector(nodes);
+}
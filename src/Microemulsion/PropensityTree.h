@@ -0,0 +1,52 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_PROPENSITYTREE_H
+#define ACTIVE_MICROEMULSION_PROPENSITYTREE_H
+
+#include <cstddef>
+#include <vector>
+#include "../Checkpoint/Checkpoint.h"
+
+/*
+ * Sum tree over the propensities of a fixed number of leaves, for event-driven (Gillespie) kinetic Monte Carlo.
+ * Updating a leaf and picking a leaf proportionally to its propensity both take O(log(leaves)). Inner nodes are
+ * recomputed from their children on every update, so rounding errors do not accumulate over time.
+ */
+class PropensityTree
+{
+private:
+    int numLeaves; // Rounded up to a power of two
+    std::vector<double> nodes; // Heap layout: root at 1, children of k at 2k and 2k+1, leaves from numLeaves on
+
+public:
+    PropensityTree();
+    
+    // Size the tree for leaves in [0, numLeaves), all with zero propensity.
+    void reset(int numLeaves);
+    
+    void setPropensity(int leaf, double propensity);
+    
+    inline double getPropensity(int leaf) const
+    {
+        return nodes[numLeaves + leaf];
+    }
+    
+    inline double getTotalPropensity() const
+    {
+        return nodes[1];
+    }
+    
+    /**
+     * Pick a leaf with probability proportional to its propensity.
+     * @param randomPropensity A random number uniformly distributed in [0, getTotalPropensity()).
+     */
+    int pickLeaf(double randomPropensity) const;
+    
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+};
+
+#endif //ACTIVE_MICROEMULSION_PROPENSITYTREE_H
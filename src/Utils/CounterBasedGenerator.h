@@ -0,0 +1,185 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_COUNTERBASEDGENERATOR_H
+#define ACTIVE_MICROEMULSION_COUNTERBASEDGENERATOR_H
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/*
+ * Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC'11).
+ * Random words are a pure function of a key (the seed) and of a 128-bit counter, so every (site, step, purpose)
+ * triple gets its own independent stream, and results do not depend on which thread consumes which stream.
+ */
+class CounterBasedGenerator
+{
+public:
+    // What the random numbers of a stream are used for. Streams with different purposes never overlap.
+    typedef enum
+    {
+        SWAP_COLOUR_PURPOSE = 0, SWAP_ATTEMPT_PURPOSE = 1, REJECTION_FREE_SWAP_PURPOSE = 2,
+        CHEMISTRY_DECAY_PURPOSE = 3, CHEMISTRY_PRODUCTION_TRANSFER_PURPOSE = 4, LAZY_RNA_DECAY_PURPOSE = 5,
+        CHEMISTRY_EVENT_PURPOSE = 6
+    } Purpose;
+    
+    /*
+     * Sequence of 32-bit random words out of the blocks of a single counter prefix, satisfying the
+     * UniformRandomBitGenerator requirements. Streams are cheap to create and meant to be short-lived.
+     */
+    class Stream
+    {
+    private:
+        uint32_t key[2];
+        uint32_t counter[4];
+        uint32_t block[4];
+        unsigned char nextWord;
+    
+    public:
+        typedef uint32_t result_type;
+    
+        Stream(const uint32_t *key, uint32_t site, uint64_t step, Purpose purpose)
+                : key{key[0], key[1]},
+                  counter{site, static_cast<uint32_t>(step),
+                          static_cast<uint32_t>((step >> 32) & stepHighMask) | (static_cast<uint32_t>(purpose) << 24),
+                          0},
+                  block{0, 0, 0, 0},
+                  nextWord(4)
+        {}
+    
+        static constexpr result_type min()
+        {
+            return 0;
+        }
+    
+        static constexpr result_type max()
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+    
+        inline result_type operator()()
+        {
+            if (nextWord == 4)
+            {
+                philox4x32(counter, key, block);
+                ++counter[3];
+                nextWord = 0;
+            }
+            return block[nextWord++];
+        }
+    
+        // Uniform double in [0, 1) with 53 random bits.
+        inline double uniformDouble()
+        {
+            uint32_t high = (*this)();
+            return toUniformDouble(high, (*this)());
+        }
+    
+        // Uniform integer in [0, n), by multiply-shift (bias below n/2^32).
+        inline uint32_t uniformInt(uint32_t n)
+        {
+            return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * n) >> 32);
+        }
+    
+        inline bool randomChoiceWithProbability(double probability)
+        {
+            return uniformDouble() < probability;
+        }
+        
+        /**
+         * Number of successes out of the given trials, each with the given probability (clamped to [0, 1]).
+         * Same distribution as counting randomChoiceWithProbability over the trials, at a cost independent of them.
+         */
+        inline unsigned int binomial(unsigned int trials, double probability)
+        {
+            if (trials == 0 || probability <= 0)
+            {
+                return 0;
+            }
+            if (probability >= 1)
+            {
+                return trials;
+            }
+            std::binomial_distribution<unsigned int> distribution(trials, probability);
+            return distribution(*this);
+        }
+    };
+    
+private:
+    static const uint32_t stepHighMask = 0xFFFFFF; // Steps are 56 bits wide, purposes take the top 8 bits
+    uint32_t key[2];
+    
+public:
+    explicit CounterBasedGenerator(uint64_t seed)
+            : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}
+    {}
+    
+    inline Stream getStream(uint32_t site, uint64_t step, Purpose purpose) const
+    {
+        return Stream(key, site, step, purpose);
+    }
+    
+    /**
+     * Batched version of getStream(site, step, purpose)() for the sites firstSite + k * siteStride, k < count:
+     * the first block of each stream is written as four planes of count words each, i.e. word w of stream k is
+     * at blocks[w * count + k]. The loop has no dependencies between lanes and is vectorized by the compiler
+     * (SSE2 by default, AVX2/AVX-512 when the target allows it), with the scalar code as fallback.
+     */
+    inline void fillBlocks(uint32_t firstSite, uint32_t siteStride, int count, uint64_t step, Purpose purpose,
+                           uint32_t *blocks) const
+    {
+        const uint32_t stepLow = static_cast<uint32_t>(step);
+        const uint32_t stepHigh = static_cast<uint32_t>((step >> 32) & stepHighMask)
+                                  | (static_cast<uint32_t>(purpose) << 24);
+        const uint32_t key0 = key[0], key1 = key[1];
+        #pragma omp simd
+        for (int k = 0; k < count; ++k)
+        {
+            uint32_t c0 = firstSite + k * siteStride, c1 = stepLow, c2 = stepHigh, c3 = 0;
+            philox4x32Rounds(c0, c1, c2, c3, key0, key1);
+            blocks[k] = c0;
+            blocks[count + k] = c1;
+            blocks[2 * count + k] = c2;
+            blocks[3 * count + k] = c3;
+        }
+    }
+    
+    // Uniform double in [0, 1) with 53 random bits out of two random words.
+    static inline double toUniformDouble(uint32_t high, uint32_t low)
+    {
+        return ((high >> 5) * 67108864.0 + (low >> 6)) * (1.0 / 9007199254740992.0);
+    }
+    
+    // One Philox4x32 block: 10 rounds of the bijection keyed by the given key, applied to the counter.
+    static inline void philox4x32(const uint32_t *counter, const uint32_t *key, uint32_t *out)
+    {
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        philox4x32Rounds(c0, c1, c2, c3, key[0], key[1]);
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+    
+    static inline void philox4x32Rounds(uint32_t &c0, uint32_t &c1, uint32_t &c2, uint32_t &c3, uint32_t k0,
+                                        uint32_t k1)
+    {
+        const uint32_t multiplier0 = 0xD2511F53, multiplier1 = 0xCD9E8D57;
+        const uint32_t weyl0 = 0x9E3779B9, weyl1 = 0xBB67AE85;
+        for (int round = 0; round < 10; ++round)
+        {
+            uint64_t product0 = static_cast<uint64_t>(multiplier0) * c0;
+            uint64_t product1 = static_cast<uint64_t>(multiplier1) * c2;
+            c0 = static_cast<uint32_t>(product1 >> 32) ^ c1 ^ k0;
+            c2 = static_cast<uint32_t>(product0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t>(product1);
+            c3 = static_cast<uint32_t>(product0);
+            k0 += weyl0;
+            k1 += weyl1;
+        }
+    }
+};
+
+#endif //ACTIVE_MICROEMULSION_COUNTERBASEDGENERATOR_H
@@ -5,10 +5,9 @@
 #include "RandomGenerator.h"
 
 //thread_local std::mt19937 RandomGenerator::rng(std::random_device{}());
-std::mt19937 RandomGenerator::rng(std::random_device{}());
-std::mt19937_64 RandomGenerator::rng64(std::random_device{}());
-//pcg32 RandomGenerator::rng(std::random_device{}());
-//pcg64 RandomGenerator::rng64(std::random_device{}());
+RandomEngine RandomGenerator::rng(std::random_device{}());
+RandomEngine64 RandomGenerator::rng64(std::random_device{}());
+uint64_t RandomGenerator::seed = 0;
 
 RandomGenerator &RandomGenerator::getInstance()
 {
@@ -16,26 +15,46 @@ RandomGenerator &RandomGenerator::getInstance()
     return instance;
 }
 
-std::mt19937 &RandomGenerator::getGenerator()
+RandomEngine &RandomGenerator::getGenerator()
 {
     return rng;
 }
 
-std::mt19937_64 &RandomGenerator::getGenerator64()
+RandomEngine64 &RandomGenerator::getGenerator64()
 {
     return rng64;
 }
 
 RandomGenerator::RandomGenerator()
 {
-    seedEngines();
+    // Random seed by default, it can be overridden (and logged) to reproduce a run
+    std::random_device randomDevice;
+    seedEngines((static_cast<uint64_t>(randomDevice()) << 32) | randomDevice());
 }
 
-void RandomGenerator::seedEngines()
+void RandomGenerator::setSeed(uint64_t newSeed)
 {
+    seedEngines(newSeed);
+}
+
+uint64_t RandomGenerator::getSeed() const
+{
+    return seed;
+}
+
+RandomEngine RandomGenerator::createGenerator(unsigned int streamId) const
+{
+    std::seed_seq seedSequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), streamId};
+    return RandomEngine(seedSequence);
+}
+
+void RandomGenerator::seedEngines(uint64_t newSeed)
+{
+    seed = newSeed;
+    std::seed_seq seedSequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
     //rng.seed(boost::random::random_device{}()); // This should be a true PRNG
-    rng.seed(std::random_device{}()); // This is not a true PRNG
-    rng64.seed(std::random_device{}());
+    rng.seed(seedSequence);
+    rng64.seed(seedSequence);
     //pcg_extras::seed_seq_from<std::random_device> seed_source;
     //rng.seed(seed_source);
     //pcg_extras::seed_seq_from<std::random_device> seed_source64;
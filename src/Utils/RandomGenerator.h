@@ -5,13 +5,31 @@
 #ifndef ACTIVE_MICROEMULSION_RANDOMGENERATOR_H
 #define ACTIVE_MICROEMULSION_RANDOMGENERATOR_H
 
+#include <cstdint>
 #include <random>
 #include <algorithm>
 #include <functional>
 #include <boost/random/random_device.hpp>
 #include <boost/random/mersenne_twister.hpp>
-// Testing PCG generator: more info at http://www.pcg-random.org/
-// #include <pcg_random.hpp>
+
+/*
+ * Engine policy, chosen at configure time with -DRANDOM_ENGINE=mt19937|pcg|xoshiro (see the top CMakeLists.txt).
+ * RandomEngine is the 32-bit engine used by RandomGenerator and by the per-thread engines of Grid,
+ * RandomEngine64 its 64-bit counterpart.
+ */
+#if defined(RANDOM_ENGINE_PCG)
+// PCG generator: more info at http://www.pcg-random.org/
+#include <pcg_random.hpp>
+typedef pcg32 RandomEngine;
+typedef pcg64 RandomEngine64;
+#elif defined(RANDOM_ENGINE_XOSHIRO)
+#include "Xoshiro.h"
+typedef Xoshiro128PlusPlus RandomEngine;
+typedef Xoshiro256PlusPlus RandomEngine64;
+#else
+typedef std::mt19937 RandomEngine;
+typedef std::mt19937_64 RandomEngine64;
+#endif
 
 // static pcg32 fooRNG; // This is just a hack to get icpc to not complain about pcg* types being incomplete...
 // static pcg64 fooRNG64;
@@ -22,24 +40,36 @@
 class RandomGenerator
 {
 private:
-    static std::mt19937 rng;
-//    static pcg32 rng;
-//    #pragma omp threadprivate(rng)
-    static std::mt19937_64 rng64;
-//    static pcg64 rng64;
-//    #pragma omp threadprivate(rng64)
+    static RandomEngine rng;
+    static RandomEngine64 rng64;
+
+    static uint64_t seed;
 
 public:
     static RandomGenerator& getInstance();
     
-    std::mt19937& getGenerator();
+    RandomEngine& getGenerator();
+    
+    RandomEngine64& getGenerator64();
+    
+    /**
+     * Reseed the shared engines. Generators created or copied afterwards, including the counter-based ones,
+     * are fully determined by this seed.
+     */
+    void setSeed(uint64_t newSeed);
+    
+    uint64_t getSeed() const;
     
-    std::mt19937_64& getGenerator64();
+    /**
+     * Create an engine for an independent stream, e.g. one per thread, seeded from (seed, streamId).
+     * Unlike copies of getGenerator(), engines for different streamIds do not produce the same sequence.
+     */
+    RandomEngine createGenerator(unsigned int streamId) const;
 
 private:
     RandomGenerator();
 
-    static void seedEngines();
+    static void seedEngines(uint64_t newSeed);
 public:
     RandomGenerator(RandomGenerator const&) = delete;
     void operator=(RandomGenerator const&) = delete;
@@ -0,0 +1,174 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_XOSHIRO_H
+#define ACTIVE_MICROEMULSION_XOSHIRO_H
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/*
+ * xoshiro128++ and xoshiro256++ engines (Blackman and Vigna, "Scrambled linear pseudorandom number generators",
+ * ACM TOMS 2021). They carry 16 and 32 bytes of state, against the 2.5 KB of the Mersenne Twister, and satisfy
+ * the RandomNumberEngine requirements used in this code base (seeding from a std::seed_seq, default seed).
+ */
+class Xoshiro128PlusPlus
+{
+private:
+    uint32_t s[4];
+    
+    static inline uint32_t rotl(uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+    
+public:
+    typedef uint32_t result_type;
+    static constexpr result_type default_seed = 5489u;
+    
+    Xoshiro128PlusPlus()
+    {
+        seed(default_seed);
+    }
+    
+    explicit Xoshiro128PlusPlus(result_type value)
+    {
+        seed(value);
+    }
+    
+    explicit Xoshiro128PlusPlus(std::seed_seq &seedSequence)
+    {
+        seed(seedSequence);
+    }
+    
+    void seed(result_type value)
+    {
+        std::seed_seq seedSequence{value};
+        seed(seedSequence);
+    }
+    
+    void seed(std::seed_seq &seedSequence)
+    {
+        seedSequence.generate(s, s + 4);
+        if ((s[0] | s[1] | s[2] | s[3]) == 0)
+        {
+            s[0] = 1; // The all-zero state is a fixed point
+        }
+    }
+    
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+    
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+    
+    inline result_type operator()()
+    {
+        const uint32_t result = rotl(s[0] + s[3], 7) + s[0];
+        const uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+    
+    void discard(unsigned long long steps)
+    {
+        for (; steps > 0; --steps)
+        {
+            (*this)();
+        }
+    }
+};
+
+class Xoshiro256PlusPlus
+{
+private:
+    uint64_t s[4];
+    
+    static inline uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+    
+public:
+    typedef uint64_t result_type;
+    static constexpr result_type default_seed = 5489u;
+    
+    Xoshiro256PlusPlus()
+    {
+        seed(default_seed);
+    }
+    
+    explicit Xoshiro256PlusPlus(result_type value)
+    {
+        seed(value);
+    }
+    
+    explicit Xoshiro256PlusPlus(std::seed_seq &seedSequence)
+    {
+        seed(seedSequence);
+    }
+    
+    void seed(result_type value)
+    {
+        std::seed_seq seedSequence{static_cast<uint32_t>(value), static_cast<uint32_t>(value >> 32)};
+        seed(seedSequence);
+    }
+    
+    void seed(std::seed_seq &seedSequence)
+    {
+        uint32_t words[8];
+        seedSequence.generate(words, words + 8);
+        for (int i = 0; i < 4; ++i)
+        {
+            s[i] = (static_cast<uint64_t>(words[2 * i + 1]) << 32) | words[2 * i];
+        }
+        if ((s[0] | s[1] | s[2] | s[3]) == 0)
+        {
+            s[0] = 1; // The all-zero state is a fixed point
+        }
+    }
+    
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+    
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+    
+    inline result_type operator()()
+    {
+        const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    
+    void discard(unsigned long long steps)
+    {
+        for (; steps > 0; --steps)
+        {
+            (*this)();
+        }
+    }
+};
+
+#endif //ACTIVE_MICROEMULSION_XOSHIRO_H
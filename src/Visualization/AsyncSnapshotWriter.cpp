@@ -0,0 +1,205 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "AsyncSnapshotWriter.h"
+
+AsyncSnapshotWriter::AsyncSnapshotWriter(Logger &logger, const Grid &grid,
+                                         PgmWriter &dnaWriter, PgmWriter &rnaWriter, PgmWriter &transcriptionWriter,
+                                         FrameContainerWriter *frameWriter, SnapshotAnalyzer *analyzer,
+                                         RunSummary *summary, unsigned int queueDepth)
+        : logger(logger), grid(grid),
+          dnaWriter(dnaWriter), rnaWriter(rnaWriter), transcriptionWriter(transcriptionWriter),
+          frameWriter(frameWriter), analyzer(analyzer), summary(summary), queueDepth(queueDepth),
+          buffers(std::max(queueDepth, 1u)),
+          isWriting(false), isStopping(false), numStalls(0),
+          pgmRenderer(grid.getColumns(), grid.getRows()), frameRenderer(grid.getColumns(), grid.getRows())
+{
+    size_t planeSize = static_cast<size_t>(grid.getExtendedColumns()) * grid.getExtendedRows();
+    for (auto &buffer : buffers)
+    {
+        buffer.statePlane.resize(planeSize);
+        buffer.rnaContentPlane.resize(planeSize);
+        freeBuffers.push_back(&buffer);
+    }
+    logger.logMsg(INFO, "Snapshot writer: %s=%u staging buffers of %s=%lu cells", DUMP(queueDepth),
+                  DUMP(planeSize));
+    if (queueDepth > 0)
+    {
+        writerThread = std::thread(&AsyncSnapshotWriter::run, this);
+    }
+}
+
+AsyncSnapshotWriter::~AsyncSnapshotWriter()
+{
+    if (writerThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        bufferQueued.notify_one();
+        writerThread.join();
+    }
+    if (numStalls > 0)
+    {
+        logger.logMsg(PRODUCTION, "Snapshot writer: %s=%lu submits waited for the writer thread", DUMP(numStalls));
+    }
+}
+
+void AsyncSnapshotWriter::submit(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                                 unsigned long chemChangesPerformed, bool isExtraSnapshot, bool isImageWritten,
+                                 bool isAnalyzed)
+{
+    if (isAnalyzed && analyzer == nullptr)
+    {
+        logger.logMsg(ERROR, "Snapshot writer: analysis requested without an analyzer");
+        throw std::runtime_error("Snapshot writer: analysis requested without an analyzer");
+    }
+    logger.logEvent(isImageWritten ? PRODUCTION : INFO, t,
+                    "Simulation summary: %s=%ld "
+                    "| %s=%ld "
+                    "| swapRatio=%f "
+                    "| %s=%ld ",
+                    DUMP(swapAttempts), DUMP(swapsPerformed),
+                    (double) swapsPerformed / swapAttempts,
+                    DUMP(chemChangesPerformed));
+    StagingBuffer *buffer;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (freeBuffers.empty())
+        {
+            ++numStalls;
+            logger.logEvent(INFO, t, "Snapshot writer: waiting for a staging buffer");
+            bufferWritten.wait(lock, [this] { return !freeBuffers.empty() || writeError; });
+        }
+        rethrowWriteError();
+        buffer = freeBuffers.front();
+        freeBuffers.pop_front();
+    }
+    // Only this thread takes buffers from the free list, so the copy needs no lock
+    std::copy(grid.getStatePlane(), grid.getStatePlane() + buffer->statePlane.size(), buffer->statePlane.begin());
+    std::copy(grid.getRnaContentPlane(), grid.getRnaContentPlane() + buffer->rnaContentPlane.size(),
+              buffer->rnaContentPlane.begin());
+    buffer->t = t;
+    buffer->swapAttempts = swapAttempts;
+    buffer->swapsPerformed = swapsPerformed;
+    buffer->chemChangesPerformed = chemChangesPerformed;
+    buffer->isExtraSnapshot = isExtraSnapshot;
+    buffer->isImageWritten = isImageWritten;
+    buffer->isAnalyzed = isAnalyzed;
+    if (queueDepth == 0)
+    {
+        writeSnapshot(*buffer);
+        freeBuffers.push_back(buffer);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingBuffers.push_back(buffer);
+    }
+    bufferQueued.notify_one();
+}
+
+void AsyncSnapshotWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    bufferWritten.wait(lock, [this] { return (pendingBuffers.empty() && !isWriting) || writeError; });
+    rethrowWriteError();
+}
+
+unsigned long AsyncSnapshotWriter::getNumStalls() const
+{
+    return numStalls;
+}
+
+void AsyncSnapshotWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        bufferQueued.wait(lock, [this] { return !pendingBuffers.empty() || isStopping; });
+        if (pendingBuffers.empty())
+        {
+            return; // Stopping, and everything has been written
+        }
+        StagingBuffer *buffer = pendingBuffers.front();
+        pendingBuffers.pop_front();
+        isWriting = true;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            writeSnapshot(*buffer);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        isWriting = false;
+        freeBuffers.push_back(buffer);
+        if (error && !writeError)
+        {
+            writeError = error;
+        }
+        bufferWritten.notify_all();
+    }
+}
+
+void AsyncSnapshotWriter::writeSnapshot(StagingBuffer &buffer)
+{
+    const CellState *statePlane = buffer.statePlane.data();
+    const RnaCounter *rnaContentPlane = buffer.rnaContentPlane.data();
+    int rowStride = grid.getExtendedColumns();
+    bool isFrame = buffer.isImageWritten && frameWriter != nullptr;
+    bool isPgm = buffer.isImageWritten && frameWriter == nullptr;
+    if (isFrame || buffer.isAnalyzed)
+    {
+        frameRenderer.render(statePlane, rnaContentPlane, rowStride);
+    }
+    if (buffer.isAnalyzed)
+    {
+        // On the 8 bit images, as the scripts: RNA saturates at 255 whatever the depth of the PGM files
+        analyzer->startSnapshot(buffer.t, buffer.swapAttempts, buffer.swapsPerformed, buffer.chemChangesPerformed);
+        analyzer->analyzeChannel(frameRenderer.getPlane<0>());
+        analyzer->analyzeChannel(frameRenderer.getPlane<1>());
+        analyzer->analyzeChannel(frameRenderer.getPlane<2>());
+        analyzer->commitSnapshot();
+        if (summary != nullptr)
+        {
+            summary->addSample(buffer.t, analyzer->getMeasures(0), analyzer->getMeasures(1), analyzer->getMeasures(2));
+        }
+    }
+    if (isFrame)
+    {
+        const unsigned char *channelPlanes[] = {frameRenderer.getPlane<0>(), frameRenderer.getPlane<1>(),
+                                                frameRenderer.getPlane<2>()};
+        frameWriter->write(buffer.t, buffer.swapAttempts, buffer.swapsPerformed, buffer.chemChangesPerformed,
+                           channelPlanes, buffer.isExtraSnapshot);
+    }
+    if (isPgm)
+    {
+        pgmRenderer.render(statePlane, rnaContentPlane, rowStride);
+        dnaWriter.write(buffer.t, pgmRenderer.getPlane<0>(), buffer.isExtraSnapshot);
+        rnaWriter.write(buffer.t, pgmRenderer.getPlane<1>(), buffer.isExtraSnapshot);
+        transcriptionWriter.write(buffer.t, pgmRenderer.getPlane<2>(), buffer.isExtraSnapshot);
+        if (!buffer.isExtraSnapshot)
+        {
+            dnaWriter.advanceSeries();
+            rnaWriter.advanceSeries();
+            transcriptionWriter.advanceSeries();
+        }
+    }
+}
+
+void AsyncSnapshotWriter::rethrowWriteError()
+{
+    if (writeError)
+    {
+        logger.logMsg(ERROR, "Snapshot writer: writing a snapshot failed");
+        std::rethrow_exception(writeError);
+    }
+}
@@ -0,0 +1,103 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_ASYNCSNAPSHOTWRITER_H
+#define ACTIVE_MICROEMULSION_ASYNCSNAPSHOTWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../Grid/Grid.h"
+#include "../Logger/Logger.h"
+#include "../Analysis/RunSummary.h"
+#include "../Analysis/SnapshotAnalyzer.h"
+#include "PgmWriter.h"
+#include "FrameContainerWriter.h"
+#include "MultiChannelRenderer.h"
+#include "SnapshotChannels.h"
+
+/*
+ * Takes snapshots off the simulation thread. A snapshot is a copy of the grid planes into one of queueDepth staging
+ * buffers, which a background thread then renders into the DNA, RNA and transcription channels in a single pass (see
+ * SnapshotChannels.h) and hands to the writers: either the frame container or the 3 PgmWriters. When all the
+ * buffers are waiting to be written, submit blocks until the oldest one is done, so that a slow filesystem slows the
+ * run down instead of piling up copies of the grid.
+ * Snapshots can also, or only, feed a SnapshotAnalyzer, with the same planes as the PGM files, and through it a
+ * RunSummary.
+ * With queueDepth 0 there is no thread and snapshots are written by submit itself.
+ *
+ * The writers must not be used directly while snapshots are pending: call flush first (e.g. before a checkpoint).
+ */
+class AsyncSnapshotWriter
+{
+private:
+    struct StagingBuffer
+    {
+        std::vector<CellState> statePlane;
+        std::vector<RnaCounter> rnaContentPlane;
+        double t;
+        unsigned long swapAttempts, swapsPerformed, chemChangesPerformed;
+        bool isExtraSnapshot, isImageWritten, isAnalyzed;
+    };
+    
+    Logger &logger;
+    const Grid &grid;
+    PgmWriter &dnaWriter, &rnaWriter, &transcriptionWriter;
+    FrameContainerWriter *frameWriter;
+    SnapshotAnalyzer *analyzer;
+    RunSummary *summary;
+    const unsigned int queueDepth;
+    std::vector<StagingBuffer> buffers;
+    std::deque<StagingBuffer *> freeBuffers, pendingBuffers;
+    bool isWriting, isStopping;
+    unsigned long numStalls;
+    std::exception_ptr writeError;
+    std::mutex mutex;
+    std::condition_variable bufferQueued, bufferWritten;
+    std::thread writerThread;
+    // The PGM files take the RNA count clamped to the depth of their writer, the frame container and the analysis one
+    // byte per channel
+    MultiChannelRenderer<DnaChannel, RnaCountChannel, TranscriptionChannel> pgmRenderer;
+    MultiChannelRenderer<DnaChannel, RnaChannel, TranscriptionChannel> frameRenderer;
+
+public:
+    /*
+     * Snapshots go to the frame container if one is given, to the PGM writers otherwise. Their channels must match
+     * the ones rendered here: the signal converters of the writers are not used. The analyzer is optional, its
+     * channels must be DNA, RNA and transcription, in this order. The summary, also optional, takes the measures
+     * of every snapshot analyzed.
+     */
+    AsyncSnapshotWriter(Logger &logger, const Grid &grid,
+                        PgmWriter &dnaWriter, PgmWriter &rnaWriter, PgmWriter &transcriptionWriter,
+                        FrameContainerWriter *frameWriter, SnapshotAnalyzer *analyzer, RunSummary *summary,
+                        unsigned int queueDepth);
+    
+    // Pending snapshots are written before returning.
+    ~AsyncSnapshotWriter();
+    
+    /*
+     * Copy the current grid into a staging buffer and queue it for writing, waiting for a free buffer if needed.
+     * The snapshot is written as images and/or analyzed, depending on the flags.
+     */
+    void submit(double t, unsigned long swapAttempts, unsigned long swapsPerformed, unsigned long chemChangesPerformed,
+                bool isExtraSnapshot = false, bool isImageWritten = true, bool isAnalyzed = false);
+    
+    // Wait until all the submitted snapshots are written. Errors of the writer thread are rethrown here.
+    void flush();
+    
+    // Number of submits which had to wait for the writer thread.
+    unsigned long getNumStalls() const;
+
+private:
+    void run();
+    
+    void writeSnapshot(StagingBuffer &buffer);
+    
+    void rethrowWriteError();
+};
+
+#endif //ACTIVE_MICROEMULSION_ASYNCSNAPSHOTWRITER_H
@@ -0,0 +1,213 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "FrameContainerWriter.h"
+#include <cstring>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+
+static const char frameContainerMagic[8] = {'A', 'M', 'E', 'F', 'R', 'A', 'M', 'E'};
+// Offset of numFrames in the header: magic, then six u32 fields
+static const long numFramesOffset = sizeof(frameContainerMagic) + 6 * sizeof(uint32_t);
+
+FrameContainerWriter::FrameContainerWriter(Logger &logger, int W, int H, std::string outputFile)
+        : logger(logger),
+          width(W), height(H),
+          outputFileName(outputFile),
+          statePlane(nullptr), rnaContentPlane(nullptr), rowStride(0),
+          file(nullptr), numFrames(0)
+{
+    logger.logMsg(INFO, "Initializing frame container writer (%s)", outputFileName.data());
+}
+
+FrameContainerWriter::~FrameContainerWriter()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+    }
+}
+
+void FrameContainerWriter::addChannel(std::string channelName,
+                                      unsigned char (*signalConverter)(const CellData &cellData))
+{
+    if (file != nullptr || channelNames.size() == maxChannels)
+    {
+        throw std::logic_error("Cannot add channel " + channelName + " to frame container " + outputFileName);
+    }
+    channelNames.push_back(channelName.substr(0, channelNameLength - 1));
+    signalConverters.push_back(signalConverter);
+}
+
+void FrameContainerWriter::setData(const CellState *newStatePlane, const RnaCounter *newRnaContentPlane,
+                                   int newRowStride)
+{
+    statePlane = newStatePlane;
+    rnaContentPlane = newRnaContentPlane;
+    rowStride = newRowStride;
+}
+
+uint64_t FrameContainerWriter::getHeaderSize() const
+{
+    return static_cast<uint64_t>(numFramesOffset) + 2 * sizeof(uint64_t) + maxChannels * channelNameLength;
+}
+
+uint64_t FrameContainerWriter::getFrameSize() const
+{
+    return frameMetadataSize + static_cast<uint64_t>(channelNames.size()) * width * height;
+}
+
+uint64_t FrameContainerWriter::getNumFrames() const
+{
+    return numFrames;
+}
+
+void FrameContainerWriter::write(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                                 unsigned long chemChangesPerformed, bool isExtraSnapshot)
+{
+    unsigned char *plane = startFrame(t, swapAttempts, swapsPerformed, chemChangesPerformed, isExtraSnapshot);
+    for (auto signalConverter : signalConverters)
+    {
+        for (int row = height; row > 0; row--)
+        {
+            for (int column = 1; column <= width; ++column)
+            {
+                int index = row * rowStride + column;
+                *plane++ = signalConverter(CellData(statePlane[index], rnaContentPlane[index]));
+            }
+        }
+    }
+    appendFrame();
+}
+
+void FrameContainerWriter::write(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                                 unsigned long chemChangesPerformed, const unsigned char *const *channelPlanes,
+                                 bool isExtraSnapshot)
+{
+    unsigned char *plane = startFrame(t, swapAttempts, swapsPerformed, chemChangesPerformed, isExtraSnapshot);
+    size_t planeSize = static_cast<size_t>(width) * height;
+    for (size_t channel = 0; channel < channelNames.size(); ++channel)
+    {
+        std::memcpy(plane, channelPlanes[channel], planeSize);
+        plane += planeSize;
+    }
+    appendFrame();
+}
+
+unsigned char *FrameContainerWriter::startFrame(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                                                unsigned long chemChangesPerformed, bool isExtraSnapshot)
+{
+    if (file == nullptr)
+    {
+        create();
+    }
+    logger.logEvent(PRODUCTION, t, "Writing frame #%lu of %d channels (%s)", static_cast<unsigned long>(numFrames),
+                    static_cast<int>(channelNames.size()), outputFileName.data());
+    // Metadata, then the planes of the channels, all in one buffer
+    frameBuffer.resize(static_cast<size_t>(getFrameSize()));
+    unsigned char *metadata = frameBuffer.data();
+    const uint64_t counters[] = {swapAttempts, swapsPerformed, chemChangesPerformed};
+    const uint32_t flags[] = {isExtraSnapshot, 0};
+    std::memcpy(metadata, &t, sizeof(t));
+    std::memcpy(metadata + sizeof(t), counters, sizeof(counters));
+    std::memcpy(metadata + sizeof(t) + sizeof(counters), flags, sizeof(flags));
+    return frameBuffer.data() + frameMetadataSize;
+}
+
+void FrameContainerWriter::appendFrame()
+{
+    std::fseek(file, static_cast<long>(getHeaderSize() + numFrames * getFrameSize()), SEEK_SET);
+    writeBytes(frameBuffer.data(), frameBuffer.size());
+    ++numFrames;
+    writeNumFrames();
+}
+
+void FrameContainerWriter::create()
+{
+    file = std::fopen(outputFileName.data(), "w+b");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Cannot open frame container " + outputFileName);
+    }
+    numFrames = 0;
+    const uint32_t header[] = {formatVersion, static_cast<uint32_t>(getHeaderSize()), static_cast<uint32_t>(width),
+                               static_cast<uint32_t>(height), static_cast<uint32_t>(channelNames.size()), 0};
+    const uint64_t sizes[] = {numFrames, getFrameSize()};
+    char names[maxChannels][channelNameLength] = {};
+    for (size_t channel = 0; channel < channelNames.size(); ++channel)
+    {
+        std::strncpy(names[channel], channelNames[channel].data(), channelNameLength - 1);
+    }
+    writeBytes(frameContainerMagic, sizeof(frameContainerMagic));
+    writeBytes(header, sizeof(header));
+    writeBytes(sizes, sizeof(sizes));
+    writeBytes(names, sizeof(names));
+    std::fflush(file);
+}
+
+bool FrameContainerWriter::reopen(uint64_t numFramesToKeep)
+{
+    file = std::fopen(outputFileName.data(), "r+b");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    char magic[sizeof(frameContainerMagic)];
+    uint32_t header[6];
+    uint64_t sizes[2];
+    bool isMatching = std::fread(magic, sizeof(magic), 1, file) == 1
+                      && std::fread(header, sizeof(header), 1, file) == 1
+                      && std::fread(sizes, sizeof(sizes), 1, file) == 1
+                      && std::memcmp(magic, frameContainerMagic, sizeof(magic)) == 0
+                      && header[0] == formatVersion && header[2] == static_cast<uint32_t>(width)
+                      && header[3] == static_cast<uint32_t>(height) && header[4] == channelNames.size()
+                      && sizes[0] >= numFramesToKeep && sizes[1] == getFrameSize();
+    if (!isMatching)
+    {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    // Drop the frames written after the checkpoint
+    std::fflush(file);
+    boost::filesystem::resize_file(outputFileName, getHeaderSize() + numFramesToKeep * getFrameSize());
+    numFrames = numFramesToKeep;
+    writeNumFrames();
+    return true;
+}
+
+void FrameContainerWriter::writeNumFrames()
+{
+    std::fseek(file, numFramesOffset, SEEK_SET);
+    writeBytes(&numFrames, sizeof(numFrames));
+    std::fflush(file);
+}
+
+void FrameContainerWriter::writeBytes(const void *data, size_t size)
+{
+    if (std::fwrite(data, 1, size, file) != size)
+    {
+        logger.logMsg(ERROR, "Cannot write frame container %s", outputFileName.data());
+        throw std::runtime_error("Cannot write frame container " + outputFileName);
+    }
+}
+
+void FrameContainerWriter::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("FRMC");
+    writer.write(file != nullptr);
+    writer.write(numFrames);
+}
+
+void FrameContainerWriter::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("FRMC");
+    bool isStarted = reader.read<bool>();
+    uint64_t numFramesToKeep = reader.read<uint64_t>();
+    if (isStarted && !reopen(numFramesToKeep))
+    {
+        logger.logMsg(WARNING, "No matching frame container %s to resume, the frames of the run being resumed "
+                               "are not in the new one", outputFileName.data());
+    }
+}
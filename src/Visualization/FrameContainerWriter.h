@@ -0,0 +1,99 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_FRAMECONTAINERWRITER_H
+#define ACTIVE_MICROEMULSION_FRAMECONTAINERWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../Cell/CellData.h"
+#include "../Logger/Logger.h"
+#include "../Checkpoint/Checkpoint.h"
+
+/*
+ * Writes all the snapshots of a run, for all the channels, into a single binary file, instead of one PGM file per
+ * channel and snapshot. The file is a header followed by fixed-size frames, so frame n starts at
+ * headerSize + n * frameSize and the file can be memory-mapped and read by frame number (see FrameContainer in
+ * utils/utilsLib.py). Values are in the native byte order, little-endian on the machines we run on:
+ *   header: magic "AMEFRAME", version (u32), headerSize (u32), width, height, numChannels, reserved (u32 each),
+ *           numFrames (u64), frameSize (u64), then maxChannels channel names of channelNameLength chars each;
+ *   frame:  time (f64), swapAttempts, swapsPerformed, chemChangesPerformed (u64 each), isExtraSnapshot (u32),
+ *           padding (u32), then one width x height byte plane per channel, with the same rows as the PGM files
+ *           (top row first).
+ * numFrames is rewritten after each frame is appended, so it only counts complete frames.
+ */
+class FrameContainerWriter
+{
+public:
+    static const uint32_t formatVersion = 1;
+    static const int maxChannels = 8;
+    static const int channelNameLength = 32;
+    static const int frameMetadataSize = 40;
+
+private:
+    Logger &logger;
+    const int width, height;
+    std::string outputFileName;
+    std::vector<std::string> channelNames;
+    std::vector<unsigned char (*)(const CellData &cellData)> signalConverters;
+    const CellState *statePlane;
+    const RnaCounter *rnaContentPlane;
+    int rowStride;
+    std::FILE *file;
+    uint64_t numFrames;
+    std::vector<unsigned char> frameBuffer;
+
+public:
+    FrameContainerWriter(Logger &logger, int W, int H, std::string outputFile);
+    
+    ~FrameContainerWriter();
+    
+    // Channels must all be added before the first frame is written.
+    void addChannel(std::string channelName, unsigned char (*signalConverter)(const CellData &cellData));
+    
+    // Data pointers should usually be set just once. Planes are expected to include the halo.
+    void setData(const CellState *newStatePlane, const RnaCounter *newRnaContentPlane, int newRowStride);
+    
+    // Append a frame with all the channels, creating the file at the first one.
+    void write(double t, unsigned long swapAttempts, unsigned long swapsPerformed, unsigned long chemChangesPerformed,
+               bool isExtraSnapshot = false);
+    
+    // Same as above, with the channels rendered elsewhere: one width x height plane per channel, top row first.
+    void write(double t, unsigned long swapAttempts, unsigned long swapsPerformed, unsigned long chemChangesPerformed,
+               const unsigned char *const *channelPlanes, bool isExtraSnapshot = false);
+    
+    uint64_t getNumFrames() const;
+    
+    /**
+     * Save and restore the number of frames written. On restore, a container already in the output folder is cut
+     * back to that number of frames and then appended to, so that it matches an uninterrupted run.
+     */
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
+
+private:
+    uint64_t getHeaderSize() const;
+    
+    uint64_t getFrameSize() const;
+    
+    void create();
+    
+    // Fill in the metadata of the frame in frameBuffer, return where the planes go
+    unsigned char *startFrame(double t, unsigned long swapAttempts, unsigned long swapsPerformed,
+                              unsigned long chemChangesPerformed, bool isExtraSnapshot);
+    
+    void appendFrame();
+    
+    // Reopen the existing container, cut back to the given number of frames. False if it does not match.
+    bool reopen(uint64_t numFramesToKeep);
+    
+    void writeNumFrames();
+    
+    void writeBytes(const void *data, size_t size);
+};
+
+#endif //ACTIVE_MICROEMULSION_FRAMECONTAINERWRITER_H
@@ -0,0 +1,90 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_MULTICHANNELRENDERER_H
+#define ACTIVE_MICROEMULSION_MULTICHANNELRENDERER_H
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "../Cell/CellData.h"
+
+/*
+ * Renders several channels of a snapshot in a single pass over the grid. Each channel is a functor type providing a
+ * Sample typedef and `Sample operator()(const CellData &cellData) const` (see SnapshotChannels.h). Since they are
+ * known at compile time the conversions are inlined into one loop over each row, which the compiler can vectorize,
+ * instead of one pass per channel with an indirect call per cell.
+ * Planes are width x height samples, top row first as in the PGM files.
+ */
+template<typename... Channels>
+class MultiChannelRenderer
+{
+public:
+    static const size_t numChannels = sizeof...(Channels);
+    
+    template<size_t channel>
+    using Sample = typename std::tuple_element<channel, std::tuple<typename Channels::Sample...>>::type;
+
+private:
+    const int width, height;
+    std::tuple<Channels...> channels;
+    std::tuple<std::vector<typename Channels::Sample>...> planes;
+
+public:
+    MultiChannelRenderer(int width, int height, Channels... channels)
+            : width(width), height(height), channels(channels...)
+    {}
+    
+    MultiChannelRenderer(int width, int height) : MultiChannelRenderer(width, height, Channels()...)
+    {}
+    
+    // Planes are expected to include the halo, as in the grid.
+    void render(const CellState *statePlane, const RnaCounter *rnaContentPlane, int rowStride)
+    {
+        renderChannels(statePlane, rnaContentPlane, rowStride, std::index_sequence_for<Channels...>());
+    }
+    
+    template<size_t channel>
+    const Sample<channel> *getPlane() const
+    {
+        return std::get<channel>(planes).data();
+    }
+
+private:
+    template<size_t... channel>
+    void renderChannels(const CellState *statePlane, const RnaCounter *rnaContentPlane, int rowStride,
+                        std::index_sequence<channel...>)
+    {
+        using expand = int[];
+        size_t planeSize = static_cast<size_t>(width) * height;
+        (void) expand{0, (std::get<channel>(planes).resize(planeSize), 0)...};
+        for (int row = height; row > 0; row--)
+        {
+            size_t rowOffset = static_cast<size_t>(height - row) * width;
+            renderRow<channel...>(statePlane + row * rowStride + 1, rnaContentPlane + row * rowStride + 1,
+                                  (std::get<channel>(planes).data() + rowOffset)...);
+        }
+    }
+    
+    // Output rows are arguments rather than members, so that stores to them are known not to move them
+    template<size_t... channel>
+    void renderRow(const CellState *__restrict__ states, const RnaCounter *__restrict__ rnaContents,
+                   Sample<channel> *__restrict__... outputRows) const
+    {
+        const int columns = width;
+        for (int column = 0; column < columns; ++column)
+        {
+            const CellData cellData(states[column], rnaContents[column]);
+            expandChannels((outputRows[column] = std::get<channel>(channels)(cellData))...);
+        }
+    }
+    
+    // Evaluates one expression per channel, without the temporary array of the usual expansion trick
+    template<typename... Samples>
+    static inline void expandChannels(Samples...)
+    {}
+};
+
+#endif //ACTIVE_MICROEMULSION_MULTICHANNELRENDERER_H
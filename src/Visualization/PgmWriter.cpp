@@ -4,6 +4,7 @@
 
 #include "PgmWriter.h"
 #include <cstring>
+#include <stdexcept>
 #include <string>
 #include <sstream>
 #include <iomanip>
@@ -11,23 +12,80 @@
 PgmWriter::PgmWriter(Logger &logger, int W, int H, std::string outputFile, std::string channelName,
                      unsigned char (*signalConverter)(const CellData &cellData))
         : logger(logger),
-          width(W), height(H), depth(255),
+          width(W), height(H), depth(255), format(ASCII_PGM),
           outputFileName(outputFile),
           channelName(channelName),
-          signalConverter(signalConverter),
-          pgm(nullptr), counter(0)
+          signalConverter(signalConverter), wideSignalConverter(nullptr),
+          statePlane(nullptr), rnaContentPlane(nullptr), rowStride(0),
+          pgm(nullptr), counter(0), isSeriesStarted(false)
 {
     logger.logMsg(INFO, "Initializing PGM writer for channel %s", channelName.data());
     advanceSeries();
     outputFileFullNameExtra = outputFileName + "_EXTRA.pgm";
 }
 
-void PgmWriter::setData(const CellData **newData)
+PgmWriter::PgmWriter(Logger &logger, int W, int H, std::string outputFile, std::string channelName,
+                     RnaCounter (*wideSignalConverter)(const CellData &cellData), unsigned int depth)
+        : logger(logger),
+          width(W), height(H), depth(depth), format(ASCII_PGM),
+          outputFileName(outputFile),
+          channelName(channelName),
+          signalConverter(nullptr), wideSignalConverter(wideSignalConverter),
+          statePlane(nullptr), rnaContentPlane(nullptr), rowStride(0),
+          pgm(nullptr), counter(0), isSeriesStarted(false)
 {
-    data = newData;
+    logger.logMsg(INFO, "Initializing PGM writer for channel %s, %s=%u", channelName.data(), DUMP(depth));
+    if (depth == 0 || depth > 65535)
+    {
+        logger.logMsg(ERROR, "PgmWriter: depth must be in [1, 65535], %s=%u", DUMP(depth));
+        throw std::runtime_error("PgmWriter: invalid depth");
+    }
+    advanceSeries();
+    outputFileFullNameExtra = outputFileName + "_EXTRA.pgm";
+}
+
+void PgmWriter::setFormat(PgmFormat newFormat)
+{
+    format = newFormat;
+}
+
+void PgmWriter::setData(const CellState *newStatePlane, const RnaCounter *newRnaContentPlane, int newRowStride)
+{
+    statePlane = newStatePlane;
+    rnaContentPlane = newRnaContentPlane;
+    rowStride = newRowStride;
 }
 
 void PgmWriter::write(double t, bool isExtraSnapshot)
+{
+    logWrite(t, isExtraSnapshot);
+    __write(t, isExtraSnapshot, [this](int row) {
+        rowSamples.resize(width);
+        for (int column = 1; column <= width; ++column)
+        {
+            rowSamples[column - 1] = static_cast<RnaCounter>(getSample(row * rowStride + column));
+        }
+        return rowSamples.data();
+    });
+}
+
+void PgmWriter::write(double t, const unsigned char *samples, bool isExtraSnapshot)
+{
+    logWrite(t, isExtraSnapshot);
+    __write(t, isExtraSnapshot, [this, samples](int row) {
+        return samples + static_cast<size_t>(height - row) * width;
+    });
+}
+
+void PgmWriter::write(double t, const RnaCounter *samples, bool isExtraSnapshot)
+{
+    logWrite(t, isExtraSnapshot);
+    __write(t, isExtraSnapshot, [this, samples](int row) {
+        return samples + static_cast<size_t>(height - row) * width;
+    });
+}
+
+void PgmWriter::logWrite(double t, bool isExtraSnapshot)
 {
     std::string pgmId = std::to_string(getCounter());
     const char *writtenFname = getOutputFileFullNameCstring(t);
@@ -40,12 +98,11 @@ void PgmWriter::write(double t, bool isExtraSnapshot)
                     pgmId.data(),
                     channelName.data(),
                     writtenFname);
-    __write(t, isExtraSnapshot);
 }
 
 void PgmWriter::advanceSeries()
 {
-    if (pgm != nullptr)
+    if (isSeriesStarted)
     {
         ++counter; // If we just initialized the class, there is no need to increment counter!
     }
@@ -75,43 +132,102 @@ const char *PgmWriter::getOutputFileFullNameCstring(double t)
     return outputFileFullName.data();
 }
 
-void PgmWriter::__write(double t, bool isExtraSnapshot)
+template<typename RowSamples>
+void PgmWriter::__write(double t, bool isExtraSnapshot, RowSamples getRowSamples)
 {
-    if (isExtraSnapshot)
+    const char *fileName = isExtraSnapshot ? outputFileFullNameExtra.data() : getOutputFileFullNameCstring(t);
+    pgm = std::fopen(fileName, "wb");
+    if (pgm == nullptr)
+    {
+        logger.logMsg(ERROR, "Cannot open PGM file %s", fileName);
+        throw std::runtime_error(std::string("Cannot open PGM file ") + fileName);
+    }
+    fprintf(pgm, format == BINARY_PGM ? "P5\n" : "P2\n");
+    fprintf(pgm, "# Channel: %s\n", channelName.data());
+    fprintf(pgm, "# 0 - NoSignal\n");
+    if (wideSignalConverter != nullptr)
     {
-        pgm = std::fopen(outputFileFullNameExtra.data(), "wb");
+        fprintf(pgm, "# 1-%u - Signal (count, saturated at %u)\n", depth, depth);
     }
     else
     {
-        pgm = std::fopen(getOutputFileFullNameCstring(t), "wb");
+        fprintf(pgm, "# 1 - Signal\n");
     }
-    fprintf(pgm, "P2\n");
-    fprintf(pgm, "# Channel: %s\n", channelName.data());
-    fprintf(pgm, "# 0 - NoSignal\n");
-    fprintf(pgm, "# 1 - Signal\n");
     fprintf(pgm, "%d %d\n", width, height);
     fprintf(pgm, "%d\n", depth);
     
-    // Create buffer for one row of *.pgm picture, including spaces and trailing newline.
-    char *buffer = new char[4 * width + 1]; // The 4 multiplier is because we need to accommodate up to 255 values
-    // Now write one row of data into the buffer, then write it to file
+    // Rows are encoded into the same buffer and written with one fwrite each, the top row first
     for (int row = height; row > 0; row--)
     {
-        buffer[0] = '\0'; // Reset the buffer for each row
-        for (int column = 1; column <= width; ++column)
+        auto samples = getRowSamples(row);
+        size_t length = (format == BINARY_PGM) ? encodeBinaryRow(samples) : encodeAsciiRow(samples);
+        std::fwrite(rowBuffer.data(), 1, length, pgm);
+    }
+    std::fclose(pgm);
+    isSeriesStarted = true;
+}
+
+unsigned int PgmWriter::getSample(int index) const
+{
+    const CellData cellData(statePlane[index], rnaContentPlane[index]);
+    return (wideSignalConverter != nullptr) ? wideSignalConverter(cellData) : signalConverter(cellData);
+}
+
+template<typename Sample>
+size_t PgmWriter::encodeAsciiRow(const Sample *samples)
+{
+    // Up to 5 digits plus the separating space per sample, plus the trailing newline
+    rowBuffer.resize(6 * static_cast<size_t>(width) + 1);
+    char *out = rowBuffer.data();
+    for (int column = 0; column < width; ++column)
+    {
+        unsigned int sample = (samples[column] > depth) ? depth : samples[column];
+        char digits[5];
+        int numDigits = 0;
+        do
+        {
+            digits[numDigits++] = static_cast<char>('0' + sample % 10);
+            sample /= 10;
+        } while (sample > 0);
+        while (numDigits > 0)
         {
-            const CellData cellData = data[row][column];
-            char intensity[8];
-            sprintf(intensity, "%d", signalConverter(cellData));
-            strcat(buffer, intensity);
-            strcat(buffer, " ");
+            *out++ = digits[--numDigits];
         }
-        // append newline (\0 termination is included in strcat)
-        strcat(buffer, "\n");
-        
-        fprintf(pgm, "%s", buffer);
+        *out++ = ' ';
     }
-    std::fclose(pgm);
-    delete[] buffer;
+    *out++ = '\n';
+    return static_cast<size_t>(out - rowBuffer.data());
+}
+
+template<typename Sample>
+size_t PgmWriter::encodeBinaryRow(const Sample *samples)
+{
+    size_t bytesPerSample = (depth > 255) ? 2 : 1;
+    rowBuffer.resize(bytesPerSample * width);
+    char *out = rowBuffer.data();
+    for (int column = 0; column < width; ++column)
+    {
+        unsigned int sample = (samples[column] > depth) ? depth : samples[column];
+        if (bytesPerSample == 2)
+        {
+            *out++ = static_cast<char>(sample >> 8); // The PGM spec mandates the most significant byte first
+        }
+        *out++ = static_cast<char>(sample & 0xFF);
+    }
+    return static_cast<size_t>(out - rowBuffer.data());
+}
+
+void PgmWriter::writeCheckpoint(CheckpointWriter &writer) const
+{
+    writer.writeTag("PGMW");
+    writer.write(counter);
+    writer.write(isSeriesStarted);
+}
+
+void PgmWriter::readCheckpoint(CheckpointReader &reader)
+{
+    reader.expectTag("PGMW");
+    counter = reader.read<unsigned int>();
+    isSeriesStarted = reader.read<bool>();
 }
 
@@ -9,6 +9,14 @@
 #include <cstdio>
 #include "../Cell/CellData.h"
 #include "../Logger/Logger.h"
+#include "../Checkpoint/Checkpoint.h"
+#include <vector>
+
+typedef enum
+{
+    ASCII_PGM = 0, // P2, one decimal value per sample
+    BINARY_PGM = 1 // P5, raw samples (2 bytes big-endian when depth exceeds 255)
+} PgmFormat;
 
 class PgmWriter
 {
@@ -16,14 +24,21 @@ private:
     Logger &logger;
     const int width, height;
     const unsigned int depth;
+    PgmFormat format;
     std::string outputFileName;
     std::string channelName;
     unsigned char (*signalConverter)(const CellData &cellData);
-    const CellData **data;
+    RnaCounter (*wideSignalConverter)(const CellData &cellData);
+    const CellState *statePlane;
+    const RnaCounter *rnaContentPlane;
+    int rowStride;
     std::FILE *pgm;
     unsigned int counter;
+    bool isSeriesStarted;
     std::string outputFileFullName;
     std::string outputFileFullNameExtra;
+    std::vector<char> rowBuffer; // Reused across rows and snapshots
+    std::vector<RnaCounter> rowSamples; // Samples of one row converted from the grid planes
     
 public:
     /*
@@ -35,21 +50,48 @@ public:
      */
     PgmWriter(Logger &logger, int W, int H, std::string outputFile, std::string channelName,
               unsigned char (*signalConverter)(const CellData &cellData));
+    /*
+     * Same as above, for a channel whose samples do not fit in a byte: values are clamped to the given depth
+     * (at most 65535, which is only representable in the BINARY_PGM format).
+     */
+    PgmWriter(Logger &logger, int W, int H, std::string outputFile, std::string channelName,
+              RnaCounter (*wideSignalConverter)(const CellData &cellData), unsigned int depth);
     ~PgmWriter();
-    // Data pointer should usually be done just once.
-    void setData(const CellData **newData);
+    void setFormat(PgmFormat newFormat);
+    // Data pointers should usually be set just once. Planes are expected to include the halo.
+    void setData(const CellState *newStatePlane, const RnaCounter *newRnaContentPlane, int newRowStride);
     // Write data to pgm file
     void write(double t, bool isExtraSnapshot=false);
+    // Write samples rendered elsewhere (width x height, top row first, see MultiChannelRenderer) instead of the data
+    void write(double t, const unsigned char *samples, bool isExtraSnapshot=false);
+    void write(double t, const RnaCounter *samples, bool isExtraSnapshot=false);
     // Series should be advanced after write, if necessary
     void advanceSeries();
     unsigned int getCounter();
     const char *getOutputFileFullNameCstring(double t);
     
     const std::string setOutputFileFullName(double t);
+    
+    // Save and restore the position in the series, so that a restarted run numbers its files where it left off.
+    void writeCheckpoint(CheckpointWriter &writer) const;
+    
+    void readCheckpoint(CheckpointReader &reader);
 
 private:
-    // Actual writing process, without logging
-    void __write(double t, bool isExtraSnapshot=false);
+    void logWrite(double t, bool isExtraSnapshot);
+    
+    // Actual writing process, without logging. getRowSamples(row) gives the samples of a row, top row is row=height
+    template<typename RowSamples>
+    void __write(double t, bool isExtraSnapshot, RowSamples getRowSamples);
+    
+    unsigned int getSample(int index) const;
+    
+    // Encode one row of samples into rowBuffer, clamped to depth, return the number of bytes to be written
+    template<typename Sample>
+    size_t encodeAsciiRow(const Sample *samples);
+    
+    template<typename Sample>
+    size_t encodeBinaryRow(const Sample *samples);
 };
 
 
@@ -0,0 +1,65 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_SNAPSHOTCHANNELS_H
+#define ACTIVE_MICROEMULSION_SNAPSHOTCHANNELS_H
+
+#include "../Cell/CellData.h"
+
+/*
+ * Signals of the channels in the snapshots, as functors for MultiChannelRenderer.
+ * Conversions work on the bits of the chemical properties directly, as the bool returned by the CellData predicates
+ * keeps the rendering loops from being vectorized. They must agree with CellData::isChromatin and isActiveChromatin.
+ */
+
+// Chromatin cells, 0 or 255
+struct DnaChannel
+{
+    typedef unsigned char Sample;
+    
+    inline Sample operator()(const CellData &cellData) const
+    {
+        unsigned int isChromatin = 1U - ((cellData.chemicalProperties >> SPECIES_BIT) & 1U); // CHROMATIN is 0
+        return static_cast<Sample>(255 * isChromatin);
+    }
+};
+
+// RNA content, saturated at 255
+struct RnaChannel
+{
+    typedef unsigned char Sample;
+    
+    inline Sample operator()(const CellData &cellData) const
+    {
+        //TODO: check if actually we need to avoid to show TXN sites even if they have RNA, it seems
+        //TODO[cont]: that the real data behave in an non-related way for TXN and RNA.
+        return static_cast<Sample>(cellData.rnaContent < 255 ? cellData.rnaContent : 255);
+    }
+};
+
+// RNA content, unsaturated: writers clamp it to their own depth
+struct RnaCountChannel
+{
+    typedef RnaCounter Sample;
+    
+    inline Sample operator()(const CellData &cellData) const
+    {
+        return cellData.rnaContent;
+    }
+};
+
+// Transcribing (active chromatin) cells, 0 or 255
+struct TranscriptionChannel
+{
+    typedef unsigned char Sample;
+    
+    inline Sample operator()(const CellData &cellData) const
+    {
+        unsigned int isChromatin = 1U - ((cellData.chemicalProperties >> SPECIES_BIT) & 1U); // CHROMATIN is 0
+        unsigned int isActive = (cellData.chemicalProperties >> ACTIVE_BIT) & 1U; // ACTIVE is 1
+        return static_cast<Sample>(255 * (isChromatin & isActive));
+    }
+};
+
+#endif //ACTIVE_MICROEMULSION_SNAPSHOTCHANNELS_H
@@ -1,42 +1,70 @@
 #include <iostream>
+#include <csignal>
+#include <memory>
+#include <algorithm>
 #include "Logger/Logger.h"
 #include "Grid/Grid.h"
 #include "Microemulsion/Microemulsion.h"
 #include "Visualization/PgmWriter.h"
+#include "Visualization/FrameContainerWriter.h"
+#include "Visualization/AsyncSnapshotWriter.h"
+#include "Visualization/SnapshotChannels.h"
+#include "Analysis/RunSummary.h"
+#include "Analysis/SnapshotAnalyzer.h"
 #include "Chain/ChainConfig.h"
 #include "EventSchedule/EventSchedule.h"
 #include "EventSchedule/EventSchedule.cpp" // Since template implementation is here
+#include "EventSchedule/SweepScheduler.h"
+#include "EventSchedule/CutoffEvents.h"
 #include "Grid/GridInitializer.h"
 #include "Cell/CellData.h"
+#include "Checkpoint/Checkpoint.h"
+#include "Timing/Timing.h"
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 
 namespace opt = boost::program_options;
 
-void applyCutoffEvents(Logger &logger, EventSchedule<CutoffEvent> &eventSchedule, Microemulsion &microemulsion,
-                       const std::set<ChainId> &allChains, const std::set<ChainId> &cutoffChains,
-                       const std::set<ChainId> &permissibleChains, double kOn, double kOff, double kChromPlus,
-                       double kChromMinus, double kRnaPlus, double kRnaMinus, double kRnaTransfer, double t);
+void writeCheckpoint(Logger &logger, const std::string &checkpointFile, Grid &grid, Microemulsion &microemulsion,
+                     const std::set<ChainId> &allChains, const std::set<ChainId> &cutoffChains,
+                     const std::set<ChainId> &permissibleChains, EventSchedule<CutoffEvent> &cutoffSchedule,
+                     EventSchedule<SnapshotEvent> &snapshotSchedule, SweepScheduler &sweepScheduler,
+                     PgmWriter &dnaWriter, PgmWriter &rnaWriter, PgmWriter &transcriptionWriter,
+                     FrameContainerWriter &frameWriter, SnapshotAnalyzer &analyzer, RunSummary &summary, double t,
+                     double lastChemTime, double nextChemTime, double dtChem, unsigned long swapAttempts,
+                     unsigned long swapsPerformed, unsigned long chemChangesPerformed, double timeMultiplier);
 
-void takeSnapshots(Logger &logger, PgmWriter &dnaWriter, PgmWriter &rnaWriter, PgmWriter &transcriptionWriter, double t,
-                   unsigned long swapAttempts, unsigned long swapsPerformed, unsigned long chemChangesPerformed,
-                   bool isExtraSnapshot = false);
+// Last checkpoint signal received (SIGTERM or SIGUSR1), 0 if none is pending. SIGTERM is not overridden by SIGUSR1.
+static volatile std::sig_atomic_t checkpointSignal = 0;
+
+extern "C" void requestCheckpoint(int signal)
+{
+    if (checkpointSignal != SIGTERM)
+    {
+        checkpointSignal = signal;
+    }
+}
 
 int main(int argc, const char **argv)
 {
-    std::string outputDir, inputImage, inputChainsFile;
+    std::string outputDir, inputImage, inputChainsFile, swapEngineName, swapDecompositionName,
+            chemistryEngineName, restartFile, outputFormat, pgmFormatName;
     double endTime;
     double cutoffTime = -1;
     double cutoffTimeFraction = 1;
     int rows = 50, columns = 50;
     int numThreads = 1;
-    unsigned int swapRounds = 0;
+    unsigned long long seed = 0;
     int swapsPerPixelPerUnitTime = 500;
     int numVisualizationOutputs = 100; //todo read this from config
     double snapshotInterval = -1;
     double extraSnapshotTimeOffset = -1;
     double extraSnapshotTimeAbs = -1;
     double omega = 0.33; //todo read this from config
+    double checkpointInterval = -1;
+    unsigned int snapshotQueueDepth = 2;
+    double analysisInterval = -1;
+    int blurKernelSize = 3;
     double kOn, kOff, kChromPlus, kChromMinus, kRnaPlus, kRnaMinus, kRnaTransfer, kMax;
     std::set<double> kSet;
     
@@ -73,6 +101,13 @@ int main(int argc, const char **argv)
              "Set a transcription spike at cutoff time. Cutoff time(s) can be specified as parameter")
             ("output-dir,o", opt::value<std::string>(&outputDir)->default_value("./Out"),
              "Specify the folder to use for output (log and data)")
+            ("output-format", opt::value<std::string>(&outputFormat)->default_value("pgm"),
+             "Format of the snapshots: 'pgm' (one ASCII file per channel and snapshot), 'container' (all the "
+             "channels of all the snapshots appended to <output-dir>/microemulsion.frames, with counters and a "
+             "frame index, see FrameContainer in utils/utilsLib.py) or 'none' (no images, e.g. with --analysis)")
+            ("pgm-format", opt::value<std::string>(&pgmFormatName)->default_value("ascii"),
+             "Encoding of the PGM snapshots: 'ascii' (P2) or 'binary' (P5, much smaller and faster to write, with "
+             "the RNA channel stored unsaturated with 16 bit depth)")
             ("input-image,i", opt::value<std::string>(&inputImage)->default_value(""),
              "Specify the image to be used as initial value for grid configuration")
             ("chains-config,P", opt::value<std::string>(&inputChainsFile)->default_value("testConfig.chains"),
@@ -95,6 +130,21 @@ int main(int argc, const char **argv)
             ("additional-snapshots",
              opt::value<std::vector<double>>(&additionalExplicitSnapshots)->multitoken()->zero_tokens()->composing(),
              "Explicitly add additional snapshot time(s). Snapshot time(s) can be specified as parameter (space-separated)")
+            ("analysis", "Blur each channel of the snapshots and append its mean intensity and CoV to "
+                         "<output-dir>/analysis.csv, as the contrast analysis scripts in utils/ do on the 8 bit images "
+                         "(RNA saturated at 255, also with --pgm-format binary). At "
+                         "the end of the run, the relations between TXN intensity, RNA intensity and DNA CoV are "
+                         "summarized in <output-dir>/summary.csv (see RunSummary.h), from the same analyzed snapshots: "
+                         "the summary needs --analysis")
+            ("analysis-interval", opt::value<double>(&analysisInterval)->default_value(-1),
+             "Time interval (in seconds) between analyses in addition to the snapshots, implies --analysis. A "
+             "negative time analyzes the snapshots only")
+            ("blur-radius,b", opt::value<int>(&blurKernelSize)->default_value(3),
+             "Size (odd) of the Gaussian blur kernel of the analysis, as the '-b' option of the scripts in utils/")
+            ("snapshot-queue-depth", opt::value<unsigned int>(&snapshotQueueDepth)->default_value(2),
+             "Number of snapshots which can be waiting to be written by the background writer thread, each holding a "
+             "copy of the grid. The simulation waits when all of them are in use. 0 writes snapshots in the "
+             "simulation thread")
             ("width,W", opt::value<int>(&columns)->default_value(50), "Width of the simulation grid")
             ("height,H", opt::value<int>(&rows)->default_value(50), "Height of the simulation grid")
             ("threads", opt::value<int>(&numThreads)->default_value(-1),
@@ -103,6 +153,33 @@ int main(int argc, const char **argv)
              "Energy cost for contiguity of non-affine species (omega model parameter)")
             ("sppps,s", opt::value<int>(&swapsPerPixelPerUnitTime)->default_value(4500),
              "Number of average swap attempts per pixel per second")
+            ("seed", opt::value<unsigned long long>(&seed),
+             "Seed of the random number generators. The same seed gives the same trajectory regardless of the "
+             "number of threads. If not given, a random seed is used (and logged)")
+            ("swap-engine", opt::value<std::string>(&swapEngineName)->default_value("classic"),
+             "Kernel used for swap attempts: 'classic' (energy in floating point), 'lookup-table' "
+             "(integer energy classes and precomputed acceptance thresholds) or 'rejection-free' "
+             "(n-fold way kinetic Monte Carlo, serial, only faster at low swap ratios)")
+            ("swap-decomposition", opt::value<std::string>(&swapDecompositionName)->default_value("coloured"),
+             "Parallel decomposition of the swap sweep: 'coloured' (all threads on one colour class per round, "
+             "two barriers per round) or 'tiled' (threads own tiles of rows and only tile boundaries are "
+             "synchronized, two barriers per colourStride^2 rounds)")
+            ("chemistry-engine", opt::value<std::string>(&chemistryEngineName)->default_value("tau-leaping"),
+             "Kernel used for chemistry: 'tau-leaping' (time steps from the rates in use, parallel) or 'event-driven' "
+             "(exact reaction events between swap sweeps, Gillespie direct method on a sum tree, serial). Both count "
+             "as chemChangesPerformed the activity and transcribability switches of chromatin plus the RNA units "
+             "produced, decayed or transferred; rejected transfer proposals of the event-driven engine do not count")
+            ("lazy-rna-decay", "Visit RBP sites only at the chemical steps in which some of their RNA decays, drawn "
+             "in advance, instead of drawing their decay at every step. Same statistics, different trajectories. "
+             "Cheaper when most RNA just decays, e.g. after Actinomycin D")
+            ("restart", opt::value<std::string>(&restartFile),
+             "Resume, bit-exactly, the run saved in the given checkpoint file. All the other options must be the "
+             "same as in the run that wrote it, apart from the output folder and the checkpoint options")
+            ("checkpoint-interval", opt::value<double>(&checkpointInterval)->default_value(-1),
+             "Wall-clock time (in seconds) between checkpoints, written to <output-dir>/checkpoint.bin. A negative "
+             "value disables periodic checkpoints. Checkpoints are also written on SIGUSR1, and on SIGTERM, after "
+             "which the run stops. All of them are written at the end of the current swap interval: with a scheduler "
+             "ask for the signal some time before the walltime limit (e.g. sbatch --signal=B:USR1@300)")
             ("kOn", opt::value<double>(&kOn)->default_value(2.5e-4),
              "Reaction rate - Chromatin from non-transcribable to transcribable state")
             ("kOff", opt::value<double>(&kOff)->default_value(3.3333e-3),
@@ -148,6 +225,68 @@ int main(int argc, const char **argv)
     bool activateSwitchPassed = varsMap.count("activate") > 0;
     bool txnSpikeSwitchPassed = varsMap.count("txn-spike") > 0;
     bool isTimeInMinutes = varsMap.count("minutes") > 0;
+    bool isRnaDecayLazy = varsMap.count("lazy-rna-decay") > 0;
+    bool isAnalysisEnabled = varsMap.count("analysis") > 0 || analysisInterval > 0;
+    // A restart takes the seed of the checkpoint, the grid and the microemulsion are restored after their setup
+    std::unique_ptr<CheckpointReader> restartReader;
+    if (!restartFile.empty())
+    {
+        restartReader.reset(new CheckpointReader(restartFile));
+        restartReader->expectTag("SEED");
+        RandomGenerator::getInstance().setSeed(restartReader->read<uint64_t>());
+    }
+    else if (varsMap.count("seed") > 0)
+    {
+        RandomGenerator::getInstance().setSeed(seed);
+    }
+    seed = RandomGenerator::getInstance().getSeed();
+    SwapEngine swapEngine = CLASSIC_SWAP_ENGINE;
+    if (swapEngineName == "lookup-table")
+    {
+        swapEngine = LOOKUP_TABLE_SWAP_ENGINE;
+    }
+    else if (swapEngineName == "rejection-free")
+    {
+        swapEngine = REJECTION_FREE_SWAP_ENGINE;
+    }
+    else if (swapEngineName != "classic")
+    {
+        std::cerr << "Unknown swap engine: " << swapEngineName << std::endl;
+        return 1;
+    }
+    SwapDecomposition swapDecomposition = COLOURED_SWAP_DECOMPOSITION;
+    if (swapDecompositionName == "tiled")
+    {
+        swapDecomposition = TILED_SWAP_DECOMPOSITION;
+    }
+    else if (swapDecompositionName != "coloured")
+    {
+        std::cerr << "Unknown swap decomposition: " << swapDecompositionName << std::endl;
+        return 1;
+    }
+    ChemistryEngine chemistryEngine = TAU_LEAPING_CHEMISTRY_ENGINE;
+    if (chemistryEngineName == "event-driven")
+    {
+        chemistryEngine = EVENT_DRIVEN_CHEMISTRY_ENGINE;
+    }
+    else if (chemistryEngineName != "tau-leaping")
+    {
+        std::cerr << "Unknown chemistry engine: " << chemistryEngineName << std::endl;
+        return 1;
+    }
+    bool isContainerOutput = outputFormat == "container";
+    bool isImageOutput = outputFormat != "none";
+    if (!isContainerOutput && isImageOutput && outputFormat != "pgm")
+    {
+        std::cerr << "Unknown output format: " << outputFormat << std::endl;
+        return 1;
+    }
+    bool isBinaryPgm = pgmFormatName == "binary";
+    if (!isBinaryPgm && pgmFormatName != "ascii")
+    {
+        std::cerr << "Unknown PGM format: " << pgmFormatName << std::endl;
+        return 1;
+    }
 //    bool allExtraSnapshots = varsMap.count("all-extra-snapshots") > 0;
     bool allExtraSnapshots = false;
     bool additionalSnapshotsPassed = varsMap.count("additional-snapshots") > 0;
@@ -159,6 +298,7 @@ int main(int argc, const char **argv)
     }
     endTime *= timeMultiplier;
     snapshotInterval *= timeMultiplier;
+    analysisInterval *= timeMultiplier;
     extraSnapshotTimeOffset *= timeMultiplier;
     extraSnapshotTimeAbs *= timeMultiplier;
     cutoffTime *= timeMultiplier;
@@ -172,8 +312,9 @@ int main(int argc, const char **argv)
     kSet.insert(kRnaMinus);
     kSet.insert(kRnaTransfer);
     kMax = *kSet.rbegin(); // Get the maximum on the set
-    //dtChem
-    double dtChem = 0.1 / kMax;
+    //dtChem: the largest rate gives the smallest time step of the run
+    const double maxReactionProbability = 0.1;
+    double dtChem = maxReactionProbability / kMax;
     //snapshotInterval
     if (snapshotInterval <= 0) // Auto-compute it only if it was not set
     {
@@ -184,20 +325,12 @@ int main(int argc, const char **argv)
     {
         numVisualizationOutputs = static_cast<int>(floor(endTime / snapshotInterval));
     }
-    //dt
     int numInnerCells = rows * columns;
-//    double dt = 1.0 / (double) (swapsPerPixelPerUnitTime * numInnerCells); // The dt used for timestepping.
     int cellsPerColour = numInnerCells / (Microemulsion::colourStride * Microemulsion::colourStride);
     
-    // Compute swaps round if required
+    // Swap rounds per unit time: each round attempts one swap on every cell of a colour
     double alpha = (double) (swapsPerPixelPerUnitTime * Microemulsion::colourStride * Microemulsion::colourStride);
-    if (swapRounds == 0)
-    {
-        int safetyFactor = 3;
-        double k = fmin(dtChem, snapshotInterval);
-        swapRounds = static_cast<unsigned int>(ceil(k * alpha / safetyFactor));
-    }
-    double dt = swapRounds * 1.0 / alpha; // The dt used for timestepping.
+    SweepScheduler sweepScheduler(alpha);
     //
     
     if (cutoffTime < 0)
@@ -261,6 +394,12 @@ int main(int argc, const char **argv)
         }
     }
     
+    // Analyses in between snapshots
+    if (analysisInterval > 0)
+    {
+        snapshotSchedule.addEvents(analysisInterval, endTime, analysisInterval, ANALYSIS_SNAPSHOT);
+    }
+    
     // If output folder doesn't exist, create it
     if (!boost::filesystem::exists(outputDir))
     {
@@ -270,6 +409,10 @@ int main(int argc, const char **argv)
     // Setup and start Logger
     Logger logger;
     logger.setOutputFolder(outputDir.data());
+    if (restartReader)
+    {
+        logger.setLogFileName("sim.restart.log"); // Keep the log of the run being resumed, if in the same folder
+    }
     if (debugMode)
     {
         logger.setDebugLevel(DEBUG);
@@ -291,6 +434,12 @@ int main(int argc, const char **argv)
     logger.logArgv(argc, argv); // Logging invocation command.
     // Logging parameters for this run
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: Debug level set to %s", logger.getDebugLevelStr());
+    if (logger.getDebugLevel() < LOG_MIN_LEVEL)
+    {
+        logger.logMsg(WARNING, "Messages of level %s are compiled out of this build, configure it with "
+                               "-DCMAKE_BUILD_TYPE=Debug or -DLOG_MIN_LEVEL=%s to get them",
+                      logger.getDebugLevelStr(), logger.getDebugLevelStr());
+    }
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(debugMode));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(coarseDebugMode));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(quietMode));
@@ -310,6 +459,11 @@ int main(int argc, const char **argv)
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(rows));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(columns));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(swapsPerPixelPerUnitTime));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%s", DUMP(swapEngineName.data()));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%s", DUMP(swapDecompositionName.data()));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%s", DUMP(chemistryEngineName.data()));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%s", DUMP(outputFormat.data()));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(isRnaDecayLazy));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%f", DUMP(omega));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%f", DUMP(kOn));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%f", DUMP(kOff));
@@ -322,10 +476,16 @@ int main(int argc, const char **argv)
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(numVisualizationOutputs));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(extraSnapshotTimeOffset));
     logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(numThreads));
-    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(swapRounds));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%f", DUMP(alpha));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%llu", DUMP(seed));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%s", DUMP(restartFile.data()));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%f", DUMP(checkpointInterval));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%u", DUMP(snapshotQueueDepth));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(isAnalysisEnabled));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%f", DUMP(analysisInterval));
+    logger.logMsg(logger.getDebugLevel(), "Parameters logging: %s=%d", DUMP(blurKernelSize));
     
     logger.logMsg(logger.getDebugLevel(), "Timers logging: %s=%f", DUMP(endTime));
-    logger.logMsg(logger.getDebugLevel(), "Timers logging: %s=%f", DUMP(dt));
     logger.logMsg(logger.getDebugLevel(), "Timers logging: %s=%f", DUMP(dtChem));
     logger.logMsg(logger.getDebugLevel(), "Timers logging: %s=%f", DUMP(snapshotInterval));
     
@@ -387,88 +547,253 @@ int main(int argc, const char **argv)
     Microemulsion microemulsion(grid, omega, logger,
                                 dtChem, kOn, kOff, kChromPlus, kChromMinus, kRnaPlus, kRnaMinus, kRnaTransfer,
                                 stickyBoundary);
+    microemulsion.setSwapEngine(swapEngine);
+    microemulsion.setSwapDecomposition(swapDecomposition);
+    microemulsion.setChemistryEngine(chemistryEngine);
+    microemulsion.setLazyRnaDecay(isRnaDecayLazy);
+    // From now on the chemistry time step follows the rates which can still fire. It is only recomputed at cutoff
+    // events, which change the rates: in between, the state cannot bring in channels which were left out, so the
+    // step may only be smaller than needed (e.g. once all RNA has decayed), never larger.
+    dtChem = microemulsion.computeChemistryTimeStep(maxReactionProbability);
+    microemulsion.setDtChem(dtChem);
     
+    // Signal of the 3 channels, as converter functions for the writers (snapshots are rendered from the same
+    // functors, see SnapshotChannels.h)
+    auto dnaSignal = [](const CellData &cellData) -> unsigned char {
+        return DnaChannel()(cellData);
+    };
+    auto rnaSignal = [](const CellData &cellData) -> unsigned char {
+        return RnaChannel()(cellData);
+    };
+    auto transcriptionSignal = [](const CellData &cellData) -> unsigned char {
+        return TranscriptionChannel()(cellData);
+    };
+    // Unsaturated RNA count, clamped by the writer to its own depth
+    auto rnaCountSignal = [](const CellData &cellData) -> RnaCounter {
+        return RnaCountChannel()(cellData);
+    };
     // Initialize PgmWriters for the 3 channels
-    PgmWriter dnaWriter(logger, columns, rows, outputDir + "/microemulsion_DNA", "DNA",
-                        [](const CellData &cellData) -> unsigned char {
-                            return (unsigned char) 255 * CellData::isChromatin(cellData.chemicalProperties);
-                        });
-    PgmWriter rnaWriter(logger, columns, rows, outputDir + "/microemulsion_RNA", "RNA",
-                        [](const CellData &cellData) -> unsigned char {
-                            RnaCounter rnaContent = cellData.rnaContent;
-                            if (rnaContent > 255) // Saturate in a proper way
-                            {
-//                                logger.logMsg(WARNING, "PgmWriter: SATURATION - RNA value of %d exceeds 255", rnaContent);
-                                rnaContent = 255;
-                            }
-                            //TODO: check if actually we need to avoid to show TXN sites even if they have RNA, it seems
-                            //TODO[cont]: that the real data behave in an non-related way for TXN and RNA.
-                            return (unsigned char) rnaContent;
-                        });
+    PgmFormat pgmFormat = isBinaryPgm ? BINARY_PGM : ASCII_PGM;
+    PgmWriter dnaWriter(logger, columns, rows, outputDir + "/microemulsion_DNA", "DNA", dnaSignal);
+    PgmWriter rnaWriter(logger, columns, rows, outputDir + "/microemulsion_RNA", "RNA", rnaCountSignal,
+                        isBinaryPgm ? 65535 : 255);
     PgmWriter transcriptionWriter(logger, columns, rows, outputDir + "/microemulsion_Transcription", "Pol II Ser2Phos",
-                                  [](const CellData &cellData) -> unsigned char {
-                                      return (unsigned char) 255 *
-                                             CellData::isActiveChromatin(cellData.chemicalProperties);
-                                  });
-    dnaWriter.setData(grid.getData());
-    rnaWriter.setData(grid.getData());
-    transcriptionWriter.setData(grid.getData());
+                                  transcriptionSignal);
+    dnaWriter.setFormat(pgmFormat);
+    rnaWriter.setFormat(pgmFormat);
+    transcriptionWriter.setFormat(pgmFormat);
+    // ... or a frame container for all of them
+    FrameContainerWriter frameWriter(logger, columns, rows, outputDir + "/microemulsion.frames");
+    frameWriter.addChannel("DNA", dnaSignal);
+    frameWriter.addChannel("RNA", rnaSignal);
+    frameWriter.addChannel("Pol II Ser2Phos", transcriptionSignal);
+    // In-situ contrast analysis of the same channels
+    SnapshotAnalyzer analyzer(logger, columns, rows, blurKernelSize, outputDir + "/analysis.csv");
+    analyzer.addChannel("DNA");
+    analyzer.addChannel("RNA");
+    analyzer.addChannel("Transcription");
+    RunSummary summary(logger, outputDir + "/summary.csv");
+    // All are fed from copies of the grid, written in the background
+    AsyncSnapshotWriter snapshotWriter(logger, grid, dnaWriter, rnaWriter, transcriptionWriter,
+                                       isContainerOutput ? &frameWriter : nullptr,
+                                       isAnalysisEnabled ? &analyzer : nullptr,
+                                       isAnalysisEnabled ? &summary : nullptr, snapshotQueueDepth);
     
     // --- actual iteration steps of the simulation are carried out from here on ...
     // Simulation loops
     double t = 0;
-    // Write initial data to file
-    dnaWriter.write(t);
-    rnaWriter.write(t);
-    transcriptionWriter.write(t);
-    dnaWriter.advanceSeries();
-    rnaWriter.advanceSeries();
-    transcriptionWriter.advanceSeries();
-    //
+    double lastChemTime = 0;
     double nextChemTime = dtChem;
     unsigned long swapAttempts = 0;
     unsigned long swapsPerformed = 0;
     unsigned long chemChangesPerformed = 0;
+    if (restartReader)
+    {
+        // Same order as in writeCheckpoint
+        grid.readCheckpoint(*restartReader);
+        restartReader->expectTag("CHNS");
+        restartReader->readSet(allChains);
+        restartReader->readSet(cutoffChains);
+        restartReader->readSet(permissibleChains);
+        microemulsion.readCheckpoint(*restartReader);
+        cutoffSchedule.readCheckpoint(*restartReader);
+        snapshotSchedule.readCheckpoint(*restartReader);
+        sweepScheduler.readCheckpoint(*restartReader);
+        dnaWriter.readCheckpoint(*restartReader);
+        rnaWriter.readCheckpoint(*restartReader);
+        transcriptionWriter.readCheckpoint(*restartReader);
+        frameWriter.readCheckpoint(*restartReader);
+        analyzer.readCheckpoint(*restartReader);
+        summary.readCheckpoint(*restartReader);
+        restartReader->expectTag("LOOP");
+        t = restartReader->read<double>();
+        lastChemTime = restartReader->read<double>();
+        nextChemTime = restartReader->read<double>();
+        dtChem = restartReader->read<double>();
+        swapAttempts = restartReader->read<unsigned long>();
+        swapsPerformed = restartReader->read<unsigned long>();
+        chemChangesPerformed = restartReader->read<unsigned long>();
+        restartReader.reset();
+        logger.logEvent(PRODUCTION, t/timeMultiplier, "Restarted from checkpoint %s", restartFile.data());
+    }
+    else
+    {
+        // Write initial data to file
+        if (isImageOutput || isAnalysisEnabled)
+        {
+            snapshotWriter.submit(t, swapAttempts, swapsPerformed, chemChangesPerformed, false, isImageOutput,
+                                  isAnalysisEnabled);
+        }
+    }
+    const std::string checkpointFile = outputDir + "/checkpoint.bin";
+    long lastCheckpointMillis = Timing::getCurrentTimeMillis();
+    std::signal(SIGTERM, requestCheckpoint);
+    std::signal(SIGUSR1, requestCheckpoint);
     logger.logEvent(INFO, t, "Entering main time-stepping loop");
-    while (t < endTime)
+    // One parallel region for the whole run: all threads share swaps and chemistry, while events and snapshots
+    // run on a single thread. Shared loop variables are only written in single sections, whose implicit barriers
+    // keep the threads on the same path through the loops.
+    bool isChemistryStep = false;
+    bool isStopRequested = false;
+    double intervalEndTime = 0;
+    unsigned int intervalRounds = 0;
+    // Checkpoints go between intervals, where events and snapshots up to t have been applied. Only called in single
+    // sections.
+    auto checkpointIfDue = [&]()
     {
-        if (cutoffSchedule.check(t))
+        int signal = checkpointSignal;
+        long currentMillis = Timing::getCurrentTimeMillis();
+        if (signal != 0 || (checkpointInterval >= 0 &&
+                            Timing::getTimeSpentSeconds(lastCheckpointMillis, currentMillis) >= checkpointInterval))
         {
-            applyCutoffEvents(logger, cutoffSchedule, microemulsion,
-                              allChains, cutoffChains, permissibleChains, kOn, kOff,
-                              kChromPlus, kChromMinus, kRnaPlus, kRnaMinus,
-                              kRnaTransfer,
-                              t/timeMultiplier);
+            checkpointSignal = 0;
+            snapshotWriter.flush(); // The writers' counters must include all the snapshots taken
+            writeCheckpoint(logger, checkpointFile, grid, microemulsion,
+                            allChains, cutoffChains, permissibleChains,
+                            cutoffSchedule, snapshotSchedule, sweepScheduler,
+                            dnaWriter, rnaWriter, transcriptionWriter, frameWriter, analyzer, summary,
+                            t, lastChemTime, nextChemTime, dtChem,
+                            swapAttempts, swapsPerformed, chemChangesPerformed, timeMultiplier);
+            lastCheckpointMillis = Timing::getCurrentTimeMillis();
+            isStopRequested = signal == SIGTERM;
         }
-        // Time-stepping loop
-        while (t < snapshotSchedule.getNextEventTime())
+    };
+    #pragma omp parallel
+    {
+        while (t < endTime && !isStopRequested)
         {
-            t += dt;
-//            swapsPerformed += microemulsion.performRandomSwap();
-//            ++swapAttempts;
-            swapsPerformed += microemulsion.performRandomSwaps(swapRounds);
-            swapAttempts += cellsPerColour * swapRounds;
-            
-            // Now check if to perform chemical reactions
-            if (t >= nextChemTime)
+            #pragma omp single
             {
-                chemChangesPerformed += microemulsion.performChemicalReactions();
-                nextChemTime += dtChem;
+                // Also here, so that a stop is honoured even if no interval is run before the next snapshot
+                checkpointIfDue();
+                if (!isStopRequested && cutoffSchedule.check(t))
+                {
+                    applyCutoffEvents(logger, cutoffSchedule, microemulsion,
+                                      allChains, cutoffChains, permissibleChains, kOn, kOff,
+                                      kChromPlus, kChromMinus, kRnaPlus, kRnaMinus,
+                                      kRnaTransfer,
+                                      t, timeMultiplier);
+                    // Rates changed: the next chemistry step is taken with the new time step from the last one, but not
+                    // before now, which would run the steps missed since then in a burst
+                    dtChem = microemulsion.computeChemistryTimeStep(maxReactionProbability);
+                    microemulsion.setDtChem(dtChem);
+                    nextChemTime = std::max(t, lastChemTime + dtChem);
+                    logger.logEvent(PRODUCTION, t/timeMultiplier, "Chemistry time step: %s=%f", DUMP(dtChem));
+                }
             }
-        }
-        
-        // Writing the required snapshot(s)
-        if (snapshotSchedule.check(t))
-        {
-            auto eventsToApply = snapshotSchedule.popEventsToApply(t);
-            for (auto event : eventsToApply)
+            // Time-stepping loop: each interval runs the swap rounds up to the next chemistry, event or snapshot
+            // time as one batch, so that none of them is overshot
+            while (t < endTime && t < snapshotSchedule.getNextEventTime() && !cutoffSchedule.check(t) &&
+                   !isStopRequested)
             {
-                takeSnapshots(logger, dnaWriter, rnaWriter, transcriptionWriter, t/timeMultiplier, swapAttempts,
-                              swapsPerformed, chemChangesPerformed, event == GENERIC_EXTRA_SNAPSHOT);
+                #pragma omp single
+                {
+                    checkpointIfDue();
+                    intervalEndTime = fmin(fmin(nextChemTime, endTime),
+                                           fmin(snapshotSchedule.getNextEventTime(),
+                                                cutoffSchedule.getNextEventTime()));
+                    if (chemistryEngine == EVENT_DRIVEN_CHEMISTRY_ENGINE)
+                    {
+                        // Each reaction event takes place after the swaps up to its own time
+                        intervalEndTime = fmin(intervalEndTime, microemulsion.getNextChemicalEventTime());
+                    }
+                    intervalRounds = sweepScheduler.getRoundsUntil(intervalEndTime);
+                }
+                if (isStopRequested)
+                {
+                    break;
+                }
+                microemulsion.performRandomSwapsInParallelRegion(intervalRounds, swapsPerformed);
+                
+                #pragma omp single
+                {
+                    t = sweepScheduler.advance(intervalRounds, intervalEndTime);
+                    swapAttempts += cellsPerColour * intervalRounds;
+                    // Now check if to perform chemical reactions
+                    isChemistryStep = t >= nextChemTime;
+                    if (isChemistryStep)
+                    {
+                        lastChemTime = nextChemTime;
+                        nextChemTime += dtChem;
+                    }
+                    if (chemistryEngine == EVENT_DRIVEN_CHEMISTRY_ENGINE)
+                    {
+                        // Reaction events up to the end of the interval, on the same clock as swaps
+                        chemChangesPerformed += microemulsion.performChemicalEvents(t);
+                        isChemistryStep = false;
+                    }
+                }
+                if (isChemistryStep)
+                {
+                    microemulsion.performChemicalReactionsInParallelRegion(chemChangesPerformed);
+                }
+            }
+            
+            // Writing the required snapshot(s), once all threads are out of the loop above
+            #pragma omp barrier
+            #pragma omp single
+            {
+                if (snapshotSchedule.check(t))
+                {
+                    auto eventsToApply = snapshotSchedule.popEventsToApply(t);
+                    // One analysis at this time, except for extra snapshots, together with the first image if any
+                    bool isAnalysisDue = false;
+                    for (auto event : eventsToApply)
+                    {
+                        isAnalysisDue = isAnalysisDue || (isAnalysisEnabled && event != GENERIC_EXTRA_SNAPSHOT);
+                    }
+                    for (auto event : eventsToApply)
+                    {
+                        if (!isImageOutput || event == ANALYSIS_SNAPSHOT)
+                        {
+                            continue;
+                        }
+                        bool isExtraSnapshot = event == GENERIC_EXTRA_SNAPSHOT;
+                        snapshotWriter.submit(t/timeMultiplier, swapAttempts, swapsPerformed,
+                                              chemChangesPerformed, isExtraSnapshot, true,
+                                              isAnalysisDue && !isExtraSnapshot);
+                        isAnalysisDue = isAnalysisDue && isExtraSnapshot;
+                    }
+                    if (isAnalysisDue)
+                    {
+                        snapshotWriter.submit(t/timeMultiplier, swapAttempts, swapsPerformed,
+                                              chemChangesPerformed, false, false, true);
+                    }
+                }
             }
         }
     }
-    logger.logEvent(DEBUG, t, "Exiting main time-stepping loop");
+    LOG_EVENT(logger, DEBUG, t, "Exiting main time-stepping loop");
+    snapshotWriter.flush();
+    if (isAnalysisEnabled)
+    {
+        summary.write(); // Of the samples so far if stopped, it is written again when the run is resumed
+    }
+    if (isStopRequested)
+    {
+        logger.logEvent(PRODUCTION, t/timeMultiplier, "Stopped on SIGTERM, resume with --restart %s",
+                        checkpointFile.data());
+    }
     // --- iteration steps of simulation are over here
     
     //
@@ -477,79 +802,46 @@ int main(int argc, const char **argv)
 
 
 
-void applyCutoffEvents(Logger &logger, EventSchedule<CutoffEvent> &eventSchedule, Microemulsion &microemulsion,
-                       const std::set<ChainId> &allChains, const std::set<ChainId> &cutoffChains,
-                       const std::set<ChainId> &permissibleChains, double kOn, double kOff, double kChromPlus,
-                       double kChromMinus, double kRnaPlus, double kRnaMinus, double kRnaTransfer, double t)
+void writeCheckpoint(Logger &logger, const std::string &checkpointFile, Grid &grid, Microemulsion &microemulsion,
+                     const std::set<ChainId> &allChains, const std::set<ChainId> &cutoffChains,
+                     const std::set<ChainId> &permissibleChains, EventSchedule<CutoffEvent> &cutoffSchedule,
+                     EventSchedule<SnapshotEvent> &snapshotSchedule, SweepScheduler &sweepScheduler,
+                     PgmWriter &dnaWriter, PgmWriter &rnaWriter, PgmWriter &transcriptionWriter,
+                     FrameContainerWriter &frameWriter, SnapshotAnalyzer &analyzer, RunSummary &summary, double t,
+                     double lastChemTime, double nextChemTime, double dtChem, unsigned long swapAttempts,
+                     unsigned long swapsPerformed, unsigned long chemChangesPerformed, double timeMultiplier)
 {
-    // TODO: we should be using the command pattern for all events...
-    auto eventsToApply = eventSchedule.popEventsToApply(t);
-    for (auto event : eventsToApply)
-    {
-        if (event == FLAVOPIRIDOL)
-        {
-            logger.logEvent(PRODUCTION, t, "EVENT: Applying Flavopiridol condition");
-            microemulsion.setKChromPlus(0);
-        }
-        else if (event == ACTINOMYCIN_D)
-        {
-            logger.logEvent(PRODUCTION, t, "EVENT: Applying Actinomycin D condition");
-            microemulsion.setKChromPlus(0); // Chromatin state no longer changes
-            microemulsion.setKChromMinus(0); // Chromatin state no longer changes
-            microemulsion.setKRnaPlus(0); // RNA production is halted
-            microemulsion.setKRnaMinusTxn(0); // RNA attached at transcription site is not degraded
-            microemulsion.setKRnaTransfer(0); // RNA should not be transferred from TXN sites to RBP
-        }
-        else if (event == ACTIVATE)
-        {
-            logger.logEvent(PRODUCTION, t, "EVENT: Activating transcription");
-            microemulsion.setKOn(kOn);
-            microemulsion.setKOff(kOff);
-            microemulsion.setKChromPlus(kChromPlus);
-            microemulsion.setKChromMinus(kChromMinus);
-            microemulsion.setKRnaPlus(kRnaPlus);
-            microemulsion.setKRnaMinusRbp(kRnaMinus);
-            microemulsion.setKRnaMinusTxn(0);
-            microemulsion.setKRnaTransfer(kRnaTransfer);
-        }
-        else if (event == TXN_SPIKE)
-        {
-            // NOTE: transcription spike DOES NOT include activation
-            logger.logEvent(PRODUCTION, t, "EVENT: Transcription spike");
-            microemulsion.enableTranscribabilityOnChains(permissibleChains);
-        }
-        else
-        {
-            // Testing playground here...
-            logger.logEvent(PRODUCTION, t, "EVENT: Applying custom cutoff conditions");
-//            microemulsion.setKRnaMinusRbp(0);
-            microemulsion.enablePermissivityOnChains(allChains);
-            microemulsion.disablePermissivityOnChains(cutoffChains);
-        }
-    }
-}
-
-void takeSnapshots(Logger &logger, PgmWriter &dnaWriter, PgmWriter &rnaWriter, PgmWriter &transcriptionWriter, double t,
-                   unsigned long swapAttempts, unsigned long swapsPerformed, unsigned long chemChangesPerformed,
-                   bool isExtraSnapshot)
-{
-    logger.logEvent(PRODUCTION, t,
-                    "Simulation summary: %s=%ld "
-                    "| %s=%ld "
-                    "| swapRatio=%f "
-                    "| %s=%ld ",
-                    DUMP(swapAttempts), DUMP(swapsPerformed),
-                    (double) swapsPerformed / swapAttempts,
-                    DUMP(chemChangesPerformed));
-    dnaWriter.write(t, isExtraSnapshot);
-    rnaWriter.write(t, isExtraSnapshot);
-    transcriptionWriter.write(t, isExtraSnapshot);
-    if (!isExtraSnapshot)
-    {
-        dnaWriter.advanceSeries();
-        rnaWriter.advanceSeries();
-        transcriptionWriter.advanceSeries();
-    }
+    long startMillis = Timing::getCurrentTimeMillis();
+    CheckpointWriter writer(checkpointFile);
+    writer.writeTag("SEED");
+    writer.write(RandomGenerator::getInstance().getSeed());
+    grid.writeCheckpoint(writer);
+    writer.writeTag("CHNS");
+    writer.writeSet(allChains);
+    writer.writeSet(cutoffChains);
+    writer.writeSet(permissibleChains);
+    microemulsion.writeCheckpoint(writer);
+    cutoffSchedule.writeCheckpoint(writer);
+    snapshotSchedule.writeCheckpoint(writer);
+    sweepScheduler.writeCheckpoint(writer);
+    dnaWriter.writeCheckpoint(writer);
+    rnaWriter.writeCheckpoint(writer);
+    transcriptionWriter.writeCheckpoint(writer);
+    frameWriter.writeCheckpoint(writer);
+    analyzer.writeCheckpoint(writer);
+    summary.writeCheckpoint(writer);
+    writer.writeTag("LOOP");
+    writer.write(t);
+    writer.write(lastChemTime);
+    writer.write(nextChemTime);
+    writer.write(dtChem);
+    writer.write(swapAttempts);
+    writer.write(swapsPerformed);
+    writer.write(chemChangesPerformed);
+    writer.commit();
+    double writeTime = Timing::getTimeSpentSeconds(startMillis, Timing::getCurrentTimeMillis());
+    logger.logEvent(PRODUCTION, t/timeMultiplier, "Checkpoint written to %s in %s=%f s", checkpointFile.data(),
+                    DUMP(writeTime));
 }
 
 //eof
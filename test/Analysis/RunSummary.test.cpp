@@ -0,0 +1,140 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../../src/Analysis/RunSummary.h"
+
+static const char *summaryFile = "test_summary.csv";
+
+// Header and row of the summary, as name -> value
+static std::vector<std::pair<std::string, std::string>> readSummary()
+{
+    std::ifstream file(summaryFile);
+    std::string header, row, name, value;
+    std::getline(file, header);
+    std::getline(file, row);
+    std::stringstream headerStream(header), rowStream(row);
+    std::vector<std::pair<std::string, std::string>> fields;
+    while (std::getline(headerStream, name, ',') && std::getline(rowStream, value, ','))
+    {
+        fields.emplace_back(name, value);
+    }
+    return fields;
+}
+
+static double getField(const std::string &name)
+{
+    for (auto &field : readSummary())
+    {
+        if (field.first == name)
+        {
+            return std::stod(field.second);
+        }
+    }
+    FAIL("Missing column " << name);
+    return 0;
+}
+
+// Snapshot with the given number of transcribing cells, RNA intensity and DNA CoV
+static void addSample(RunSummary &summary, double t, double txnSites, double rnaMean, double dnaCov)
+{
+    const double numCells = 100;
+    summary.addSample(t, {0, 100, dnaCov}, {rnaMean * numCells, rnaMean, 1},
+                      {255 * txnSites, 255 * txnSites / numCells, 1});
+}
+
+TEST_CASE("Run summary", "[Analysis]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    
+    SECTION("Statistics of the TXN intensity, RNA intensity and DNA CoV")
+    {
+        RunSummary summary(logger, summaryFile);
+        // RNA follows transcription, DNA CoV decreases with it
+        const double txnSites[] = {0, 10, 20, 30};
+        const double dnaCovs[] = {0.6, 0.5, 0.45, 0.3};
+        for (int sample = 0; sample < 4; ++sample)
+        {
+            addSample(summary, sample, txnSites[sample], 2 * txnSites[sample] + 1, dnaCovs[sample]);
+        }
+        summary.write();
+        REQUIRE(getField("samples") == 4);
+        REQUIRE(getField("time") == 3);
+        REQUIRE(getField("txnSites") == Approx(30));
+        REQUIRE(getField("txnIntensity") == Approx(76.5));
+        REQUIRE(getField("rnaTotal") == Approx(6100));
+        REQUIRE(getField("rnaIntensity") == Approx(61));
+        REQUIRE(getField("dnaCov") == Approx(0.3));
+        // txnIntensity is 2.55 txnSites: 0, 25.5, 51, 76.5
+        REQUIRE(getField("mean_txnIntensity") == Approx(38.25));
+        REQUIRE(getField("var_txnIntensity") == Approx(25.5 * 25.5 * 5 / 3));
+        REQUIRE(getField("mean_dnaCov") == Approx(0.4625));
+        REQUIRE(getField("var_dnaCov") == Approx(0.015625));
+        REQUIRE(getField("cov_txnIntensity_rnaIntensity") == Approx(2 / 2.55 * getField("var_txnIntensity")));
+        REQUIRE(getField("corr_txnIntensity_rnaIntensity") == Approx(1));
+        REQUIRE(getField("cov_txnIntensity_dnaCov") == Approx(-12.1125 / 3));
+        REQUIRE(getField("corr_rnaIntensity_dnaCov") == Approx(getField("corr_txnIntensity_dnaCov")));
+        REQUIRE(getField("corr_txnIntensity_dnaCov") < -0.9);
+        REQUIRE(readSummary().size() == 19);
+    }
+    SECTION("Undefined statistics are nan")
+    {
+        RunSummary summary(logger, summaryFile);
+        addSample(summary, 0, 5, 0, 0.5);
+        REQUIRE(std::isnan(summary.getCovariance(0, 1)));
+        addSample(summary, 1, 5, 0, 0.4);
+        REQUIRE(summary.getCovariance(0, 0) == 0);
+        REQUIRE(std::isnan(summary.getCorrelation(0, 2)));
+        summary.write();
+        REQUIRE(std::isnan(getField("corr_txnIntensity_dnaCov")));
+    }
+    SECTION("A summary without samples is all nan")
+    {
+        RunSummary summary(logger, summaryFile);
+        summary.write();
+        REQUIRE(getField("samples") == 0);
+        REQUIRE(std::isnan(getField("time")));
+        REQUIRE(std::isnan(getField("dnaCov")));
+        REQUIRE(std::isnan(getField("mean_rnaIntensity")));
+    }
+    SECTION("A resumed summary matches an uninterrupted one")
+    {
+        std::string uninterrupted;
+        {
+            RunSummary summary(logger, summaryFile);
+            for (int sample = 0; sample < 6; ++sample)
+            {
+                addSample(summary, sample, sample * sample, sample + 0.5, 1. / (sample + 1));
+                if (sample == 2)
+                {
+                    CheckpointWriter checkpointWriter("test.checkpoint");
+                    summary.writeCheckpoint(checkpointWriter);
+                    checkpointWriter.commit();
+                }
+            }
+            summary.write();
+            std::ifstream file(summaryFile);
+            uninterrupted.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        RunSummary summary(logger, summaryFile);
+        CheckpointReader checkpointReader("test.checkpoint");
+        summary.readCheckpoint(checkpointReader);
+        REQUIRE(summary.getNumSamples() == 3);
+        for (int sample = 3; sample < 6; ++sample)
+        {
+            addSample(summary, sample, sample * sample, sample + 0.5, 1. / (sample + 1));
+        }
+        summary.write();
+        std::ifstream file(summaryFile);
+        REQUIRE(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()) == uninterrupted);
+    }
+}
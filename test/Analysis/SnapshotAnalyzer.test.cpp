@@ -0,0 +1,140 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../../src/Analysis/SnapshotAnalyzer.h"
+
+static const char *seriesFile = "test_analysis.csv";
+
+static std::vector<std::string> readLines(const char *fileName)
+{
+    std::ifstream file(fileName);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Mean and CoV of the only channel in the last row of the series
+static void readLastMeasure(double &mean, double &cov)
+{
+    std::stringstream row(readLines(seriesFile).back());
+    std::string field;
+    std::vector<double> values;
+    while (std::getline(row, field, ','))
+    {
+        values.push_back(std::stod(field));
+    }
+    mean = values[4];
+    cov = values[5];
+}
+
+TEST_CASE("Blur kernels follow cv2.getGaussianKernel with automatic sigma", "[Analysis]")
+{
+    REQUIRE(SnapshotAnalyzer::getGaussianKernel(3) == std::vector<float>({0.25f, 0.5f, 0.25f}));
+    auto kernel = SnapshotAnalyzer::getGaussianKernel(9);
+    REQUIRE(kernel.size() == 9);
+    float sum = 0;
+    for (auto weight : kernel)
+    {
+        sum += weight;
+    }
+    REQUIRE(sum == Approx(1));
+    // sigma = 0.3 * ((9 - 1) / 2 - 1) + 0.8 = 1.7
+    REQUIRE(kernel[5] / kernel[4] == Approx(std::exp(-1 / (2 * 1.7 * 1.7))));
+    REQUIRE(kernel[0] == kernel[8]);
+}
+
+TEST_CASE("Snapshots are blurred and measured into a series", "[Analysis]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    const int size = 5;
+    std::vector<unsigned char> plane(size * size, 0);
+    double mean, cov;
+    
+    SECTION("A point inside the image spreads over the kernel")
+    {
+        SnapshotAnalyzer analyzer(logger, size, size, 3, seriesFile);
+        analyzer.addChannel("DNA");
+        plane[2 * size + 2] = 1;
+        analyzer.startSnapshot(0.5, 10, 5, 2);
+        analyzer.analyzeChannel(plane.data());
+        analyzer.commitSnapshot();
+        readLastMeasure(mean, cov);
+        // Blurred plane is the outer product of the kernel with itself: sum 1, sum of squares 0.375^2
+        double variance = 0.375 * 0.375 / 25 - 0.04 * 0.04;
+        REQUIRE(mean == Approx(0.04));
+        REQUIRE(cov == Approx(std::sqrt(variance) / 0.04));
+        REQUIRE(analyzer.getMeasures(0).total == 1);
+        REQUIRE(analyzer.getMeasures(0).mean == Approx(mean));
+        REQUIRE(readLines(seriesFile)[0] == "time,swapAttempts,swapsPerformed,chemChangesPerformed,DNA_mean,DNA_cov");
+        REQUIRE(readLines(seriesFile)[1].find("0.5,10,5,2,") == 0);
+    }
+    SECTION("Borders are reflected without repeating the edge, as OpenCV's default")
+    {
+        SnapshotAnalyzer analyzer(logger, size, size, 3, seriesFile);
+        analyzer.addChannel("RNA");
+        std::vector<RnaCounter> wide(size * size, 0);
+        wide[0] = 1000;
+        analyzer.startSnapshot(0, 0, 0, 0);
+        analyzer.analyzeChannel(wide.data());
+        analyzer.commitSnapshot();
+        readLastMeasure(mean, cov);
+        // A corner keeps the weights 0.5 and 0.25 of each direction: sum 0.75^2, sum of squares 0.3125^2
+        double blurredMean = 1000 * 0.75 * 0.75 / 25;
+        double variance = 1000. * 1000 * 0.3125 * 0.3125 / 25 - blurredMean * blurredMean;
+        REQUIRE(mean == Approx(blurredMean));
+        REQUIRE(cov == Approx(std::sqrt(variance) / blurredMean));
+        REQUIRE(analyzer.getMeasures(0).total == 1000);
+    }
+    SECTION("A restart cuts the series back to the checkpoint")
+    {
+        {
+            CheckpointWriter checkpointWriter("test.checkpoint");
+            SnapshotAnalyzer analyzer(logger, size, size, 3, seriesFile);
+            analyzer.addChannel("DNA");
+            std::fill(plane.begin(), plane.end(), 7);
+            for (int snapshot = 0; snapshot < 3; ++snapshot)
+            {
+                analyzer.startSnapshot(snapshot, 0, 0, 0);
+                analyzer.analyzeChannel(plane.data());
+                analyzer.commitSnapshot();
+                if (snapshot == 1)
+                {
+                    analyzer.writeCheckpoint(checkpointWriter);
+                }
+            }
+            checkpointWriter.commit();
+        }
+        REQUIRE(readLines(seriesFile).size() == 4);
+        readLastMeasure(mean, cov);
+        REQUIRE(mean == Approx(7));
+        REQUIRE(cov == Approx(0).margin(1e-6));
+        {
+            CheckpointReader checkpointReader("test.checkpoint");
+            SnapshotAnalyzer analyzer(logger, size, size, 3, seriesFile);
+            analyzer.addChannel("DNA");
+            analyzer.readCheckpoint(checkpointReader);
+            analyzer.startSnapshot(5, 0, 0, 0);
+            analyzer.analyzeChannel(plane.data());
+            analyzer.commitSnapshot();
+        }
+        auto lines = readLines(seriesFile);
+        REQUIRE(lines.size() == 4);
+        REQUIRE(lines[2].find("1,") == 0);
+        REQUIRE(lines[3].find("5,") == 0);
+    }
+}
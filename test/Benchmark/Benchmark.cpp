@@ -0,0 +1,43 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <cstdio>
+#include "Benchmark.h"
+
+std::vector<std::pair<std::string, Benchmark::BenchmarkFunction>> &Benchmark::getRegistry()
+{
+    static std::vector<std::pair<std::string, BenchmarkFunction>> registry;
+    return registry;
+}
+
+int Benchmark::registerBenchmark(const char *name, BenchmarkFunction benchmarkFunction)
+{
+    getRegistry().emplace_back(name, benchmarkFunction);
+    return static_cast<int>(getRegistry().size());
+}
+
+int Benchmark::runAll(const std::string &filter)
+{
+    int numRun = 0;
+    for (auto &benchmark : getRegistry())
+    {
+        if (benchmark.first.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        printf("=== %s\n", benchmark.first.data());
+        fflush(stdout);
+        benchmark.second();
+        ++numRun;
+    }
+    return numRun > 0 ? 0 : 1;
+}
+
+void Benchmark::report(const std::string &variantName, double seconds, unsigned long operations,
+                       const char *operationName)
+{
+    printf("%-24s %10.3f s  %12lu %ss  %10.2f ns/%s\n", variantName.data(), seconds, operations, operationName,
+           1e9 * seconds / operations, operationName);
+    fflush(stdout);
+}
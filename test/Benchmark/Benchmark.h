@@ -0,0 +1,51 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_BENCHMARK_H
+#define ACTIVE_MICROEMULSION_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+
+/*
+ * Minimal benchmark registry. Each benchmark case is a function registered at static initialization time
+ * through the BENCHMARK_CASE macro; the benchmarks executable runs all cases whose name contains the
+ * filter passed on the command line.
+ */
+class Benchmark
+{
+public:
+    typedef void (*BenchmarkFunction)();
+    
+    static int registerBenchmark(const char *name, BenchmarkFunction benchmarkFunction);
+    
+    static int runAll(const std::string &filter);
+    
+    /**
+     * Print the time per operation of a measured variant.
+     * @param variantName Name of the variant (e.g. engine) measured.
+     * @param seconds Total elapsed time.
+     * @param operations Number of operations performed in the elapsed time.
+     * @param operationName What an operation is (e.g. "attempt").
+     */
+    static void report(const std::string &variantName, double seconds, unsigned long operations,
+                       const char *operationName);
+    
+    static inline double getCurrentTimeSeconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static std::vector<std::pair<std::string, BenchmarkFunction>> &getRegistry();
+};
+
+#define BENCHMARK_CASE(name) \
+    static void name(); \
+    static int name##Registration = Benchmark::registerBenchmark(#name, name); \
+    static void name()
+
+#endif //ACTIVE_MICROEMULSION_BENCHMARK_H
@@ -0,0 +1,32 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "BenchmarkSetup.h"
+#include "../../src/Grid/GridInitializer.h"
+
+static Logger &initializeBenchmarkLogger(Logger &logger)
+{
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("benchmark.log");
+    logger.openLogFile();
+    return logger;
+}
+
+BenchmarkSetup::BenchmarkSetup(int size, double chromatinRatio, bool stickyBoundary)
+        : logger(),
+          grid(size, size, initializeBenchmarkLogger(logger)),
+          microemulsion(grid, 0.33, logger, 0.1 / 3e-1, 2.5e-4, 3.3333e-3, 1.5e-3, 1.6666e-3, 3e-1,
+                        8.3333e-4, 3.3e-3, stickyBoundary)
+{
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, chromatinRatio / 2, CellData::chemicalPropertiesOf(CHROMATIN,
+                                                                                                   NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, chromatinRatio / 2, CellData::chemicalPropertiesOf(CHROMATIN,
+                                                                                                   ACTIVE));
+}
+
+int BenchmarkSetup::getCellsPerColour() const
+{
+    return grid.getColumns() * grid.getRows() / (Microemulsion::colourStride * Microemulsion::colourStride);
+}
@@ -0,0 +1,28 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#ifndef ACTIVE_MICROEMULSION_BENCHMARKSETUP_H
+#define ACTIVE_MICROEMULSION_BENCHMARKSETUP_H
+
+#include "../../src/Logger/Logger.h"
+#include "../../src/Grid/Grid.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+/*
+ * A square grid filled with RBP and a random fraction of chromatin (half of it active), together with the
+ * Logger and Microemulsion instances required to run kernels on it. Parameters mimic the production defaults.
+ */
+class BenchmarkSetup
+{
+public:
+    Logger logger;
+    Grid grid;
+    Microemulsion microemulsion;
+    
+    BenchmarkSetup(int size, double chromatinRatio, bool stickyBoundary = true);
+    
+    int getCellsPerColour() const;
+};
+
+#endif //ACTIVE_MICROEMULSION_BENCHMARKSETUP_H
@@ -0,0 +1,139 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "Benchmark.h"
+#include "BenchmarkSetup.h"
+
+// Load every chromatin cell with the given RNA content and time the chemistry steps.
+static void measureChemistry(RnaCounter rnaContent)
+{
+    const int size = 200;
+    const int steps = 50;
+    BenchmarkSetup setup(size, 0.5);
+    for (int row = setup.grid.getFirstRow(); row <= setup.grid.getLastRow(); ++row)
+    {
+        for (int column = setup.grid.getFirstColumn(); column <= setup.grid.getLastColumn(); ++column)
+        {
+            int index = setup.grid.getIndex(column, row);
+            if (setup.grid.isChromatin(index))
+            {
+                setup.grid.incrementRnaContent(index, rnaContent);
+            }
+        }
+    }
+    
+    double start = Benchmark::getCurrentTimeSeconds();
+    for (int step = 0; step < steps; ++step)
+    {
+        setup.microemulsion.performChemicalReactions();
+    }
+    double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+    char variantName[32];
+    snprintf(variantName, sizeof(variantName), "rna=%d", rnaContent);
+    Benchmark::report(variantName, elapsed, static_cast<unsigned long>(size) * size * steps, "cell-step");
+}
+
+// Per-cell cost of a chemistry step as RNA accumulates on chromatin: it should not grow with the RNA content.
+BENCHMARK_CASE(ChemistryHighRna)
+{
+    for (RnaCounter rnaContent : {0, 10, 100, 1000})
+    {
+        measureChemistry(rnaContent);
+    }
+}
+
+// Per-step cost of chemistry as a function of the fraction of reactive (chromatin) cells on a 400x400 grid.
+BENCHMARK_CASE(ChemistryReactiveFraction)
+{
+    const int size = 400;
+    const int steps = 50;
+    for (double chromatinRatio : {0.02, 0.1, 0.5})
+    {
+        BenchmarkSetup setup(size, chromatinRatio);
+        setup.microemulsion.performChemicalReactions(); // Warm-up, builds the reactive site list
+        double start = Benchmark::getCurrentTimeSeconds();
+        for (int step = 0; step < steps; ++step)
+        {
+            setup.microemulsion.performChemicalReactions();
+        }
+        double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+        char variantName[32];
+        snprintf(variantName, sizeof(variantName), "chromatin=%.2f", chromatinRatio);
+        Benchmark::report(variantName, elapsed, steps, "step");
+    }
+}
+
+// Decay-dominated regime, as after Actinomycin D: RBP cells hold RNA, chromatin does not produce any more.
+// Chemistry steps only, with a swap round per colour in between to move the cells around.
+static void measureRnaDecay(bool isRnaDecayLazy, const char *variantName)
+{
+    const int size = 400;
+    const int steps = 20;
+    BenchmarkSetup setup(size, 0.1);
+    setup.microemulsion.setKRnaPlus(0);
+    setup.microemulsion.setLazyRnaDecay(isRnaDecayLazy);
+    for (int row = setup.grid.getFirstRow(); row <= setup.grid.getLastRow(); ++row)
+    {
+        for (int column = setup.grid.getFirstColumn(); column <= setup.grid.getLastColumn(); ++column)
+        {
+            int index = setup.grid.getIndex(column, row);
+            if (setup.grid.isRBP(index))
+            {
+                setup.grid.incrementRnaContent(index, 50);
+                setup.grid.setActivity(index, ACTIVE);
+            }
+        }
+    }
+    setup.microemulsion.performChemicalReactions(); // Warm-up, builds the reactive site list
+    
+    double elapsed = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+        setup.microemulsion.performRandomSwaps(Microemulsion::colourStride * Microemulsion::colourStride);
+        double start = Benchmark::getCurrentTimeSeconds();
+        setup.microemulsion.performChemicalReactions();
+        elapsed += Benchmark::getCurrentTimeSeconds() - start;
+    }
+    Benchmark::report(variantName, elapsed, steps, "step");
+}
+
+BENCHMARK_CASE(RnaDecayAfterCutoff)
+{
+    measureRnaDecay(false, "eager");
+    measureRnaDecay(true, "lazy");
+}
+
+// Chemistry alone over the same simulated time, with the tau-leaping steps of the production defaults or with
+// exact events, advanced by the swap time step of main (a third of dtChem).
+BENCHMARK_CASE(ChemistryEngineSimulatedTime)
+{
+    const int size = 200;
+    const double dtChem = 0.1 / 3e-1, simulatedTime = 20;
+    const int steps = static_cast<int>(simulatedTime / dtChem);
+    {
+        BenchmarkSetup setup(size, 0.5);
+        unsigned int changes = 0;
+        double start = Benchmark::getCurrentTimeSeconds();
+        for (int step = 0; step < steps; ++step)
+        {
+            changes += setup.microemulsion.performChemicalReactions();
+        }
+        double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+        Benchmark::report("tau-leaping", elapsed, steps, "step");
+        printf("    changes=%u\n", changes);
+    }
+    {
+        BenchmarkSetup setup(size, 0.5);
+        setup.microemulsion.setChemistryEngine(EVENT_DRIVEN_CHEMISTRY_ENGINE);
+        unsigned int events = 0;
+        double start = Benchmark::getCurrentTimeSeconds();
+        for (int step = 1; step <= 3 * steps; ++step)
+        {
+            events += setup.microemulsion.performChemicalEvents(step * dtChem / 3);
+        }
+        double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+        Benchmark::report("event-driven", elapsed, steps, "step");
+        printf("    events=%u\n", events);
+    }
+}
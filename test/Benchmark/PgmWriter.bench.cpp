@@ -0,0 +1,45 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "Benchmark.h"
+#include "BenchmarkSetup.h"
+#include "../../src/Visualization/PgmWriter.h"
+
+// Time to write the RNA channel of a 1000x1000 grid with RNA on every chromatin cell, in each PGM format.
+BENCHMARK_CASE(PgmWriteFormats)
+{
+    const int size = 1000;
+    const int snapshots = 5;
+    BenchmarkSetup setup(size, 0.5);
+    for (int row = setup.grid.getFirstRow(); row <= setup.grid.getLastRow(); ++row)
+    {
+        for (int column = setup.grid.getFirstColumn(); column <= setup.grid.getLastColumn(); ++column)
+        {
+            int index = setup.grid.getIndex(column, row);
+            if (setup.grid.isChromatin(index))
+            {
+                setup.grid.incrementRnaContent(index, static_cast<RnaCounter>((column * row) % 1000));
+            }
+        }
+    }
+    auto rnaCountSignal = [](const CellData &cellData) -> RnaCounter {
+        return cellData.rnaContent;
+    };
+    
+    PgmWriter asciiWriter(setup.logger, size, size, "bench_RNA_ascii", "RNA", rnaCountSignal, 255);
+    PgmWriter binaryWriter(setup.logger, size, size, "bench_RNA_binary", "RNA", rnaCountSignal, 65535);
+    binaryWriter.setFormat(BINARY_PGM);
+    for (PgmWriter *writer : {&asciiWriter, &binaryWriter})
+    {
+        writer->setData(setup.grid.getStatePlane(), setup.grid.getRnaContentPlane(), setup.grid.getExtendedColumns());
+        double start = Benchmark::getCurrentTimeSeconds();
+        for (int snapshot = 0; snapshot < snapshots; ++snapshot)
+        {
+            writer->write(snapshot);
+            writer->advanceSeries();
+        }
+        double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+        Benchmark::report(writer == &asciiWriter ? "ascii" : "binary-16bit", elapsed, snapshots, "snapshot");
+    }
+}
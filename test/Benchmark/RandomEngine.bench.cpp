@@ -0,0 +1,56 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <random>
+#include <pcg_random.hpp>
+#include "Benchmark.h"
+#include "BenchmarkSetup.h"
+#include "../../src/Utils/Xoshiro.h"
+
+/*
+ * Random swaps of a random inner element with a random neighbour, where all the random numbers (element,
+ * neighbour, acceptance) come from the given engine. The benchmark grid has no chains, so any swap is legal.
+ * This isolates the cost of the engine on the swap path independently of the RANDOM_ENGINE the library
+ * was configured with.
+ */
+template<typename Engine>
+static void measureEngine(const char *engineName)
+{
+    const int size = 200;
+    const unsigned long attempts = 20000000;
+    BenchmarkSetup setup(size, 0.5);
+    std::seed_seq seedSequence{1u, 2u, 3u};
+    Engine engine(seedSequence);
+    std::uniform_int_distribution<int> columnDistribution(1, size), rowDistribution(1, size), offsetDistribution(0, 8);
+    std::uniform_real_distribution<double> acceptanceDistribution(0.0, 1.0);
+    
+    unsigned long swaps = 0;
+    double start = Benchmark::getCurrentTimeSeconds();
+    for (unsigned long attempt = 0; attempt < attempts; ++attempt)
+    {
+        int column = columnDistribution(engine), row = rowDistribution(engine);
+        int offset = offsetDistribution(engine);
+        int nColumn = column + offset % 3 - 1, nRow = row + offset / 3 - 1;
+        if (nColumn < 1 || nColumn > size || nRow < 1 || nRow > size || acceptanceDistribution(engine) >= 0.5)
+        {
+            continue;
+        }
+        setup.grid.swapElements(column, row, nColumn, nRow);
+        ++swaps;
+    }
+    double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+    Benchmark::report(engineName, elapsed, attempts, "attempt");
+    printf("    state=%zuB, swaps=%lu\n", sizeof(Engine), swaps);
+}
+
+// Per-attempt swap cost with each supported random engine (see RANDOM_ENGINE in the top CMakeLists.txt).
+BENCHMARK_CASE(RandomEngineSwapThroughput)
+{
+    measureEngine<std::mt19937>("mt19937");
+    measureEngine<std::mt19937_64>("mt19937_64");
+    measureEngine<pcg32>("pcg32");
+    measureEngine<pcg64>("pcg64");
+    measureEngine<Xoshiro128PlusPlus>("xoshiro128++");
+    measureEngine<Xoshiro256PlusPlus>("xoshiro256++");
+}
@@ -0,0 +1,72 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <algorithm>
+#include <vector>
+#include "Benchmark.h"
+#include "BenchmarkSetup.h"
+#include "../../src/Visualization/MultiChannelRenderer.h"
+#include "../../src/Visualization/SnapshotChannels.h"
+
+static unsigned char dnaSignal(const CellData &cellData)
+{
+    return DnaChannel()(cellData);
+}
+
+static unsigned char rnaSignal(const CellData &cellData)
+{
+    return RnaChannel()(cellData);
+}
+
+static unsigned char transcriptionSignal(const CellData &cellData)
+{
+    return TranscriptionChannel()(cellData);
+}
+
+// Rendering the 3 channels of a 1000x1000 snapshot: one pass per channel through converter function pointers, as
+// the writers do from the grid, against a single pass with the channel functors inlined.
+BENCHMARK_CASE(SnapshotRendering)
+{
+    const int size = 1000;
+    const int snapshots = 20;
+    BenchmarkSetup setup(size, 0.5);
+    const CellState *statePlane = setup.grid.getStatePlane();
+    const RnaCounter *rnaContentPlane = setup.grid.getRnaContentPlane();
+    int rowStride = setup.grid.getExtendedColumns();
+    
+    std::vector<unsigned char> planes(3 * static_cast<size_t>(size) * size);
+    unsigned char (*volatile signalConverters[])(const CellData &) = {dnaSignal, rnaSignal, transcriptionSignal};
+    double start = Benchmark::getCurrentTimeSeconds();
+    for (int snapshot = 0; snapshot < snapshots; ++snapshot)
+    {
+        unsigned char *plane = planes.data();
+        for (auto signalConverter : signalConverters)
+        {
+            for (int row = size; row > 0; row--)
+            {
+                for (int column = 1; column <= size; ++column)
+                {
+                    int index = row * rowStride + column;
+                    *plane++ = signalConverter(CellData(statePlane[index], rnaContentPlane[index]));
+                }
+            }
+        }
+    }
+    double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+    Benchmark::report("per-channel", elapsed, snapshots, "snapshot");
+    
+    MultiChannelRenderer<DnaChannel, RnaChannel, TranscriptionChannel> renderer(size, size);
+    start = Benchmark::getCurrentTimeSeconds();
+    for (int snapshot = 0; snapshot < snapshots; ++snapshot)
+    {
+        renderer.render(statePlane, rnaContentPlane, rowStride);
+    }
+    elapsed = Benchmark::getCurrentTimeSeconds() - start;
+    Benchmark::report("fused", elapsed, snapshots, "snapshot");
+    
+    bool isMatching = std::equal(renderer.getPlane<0>(), renderer.getPlane<0>() + size * size, planes.data())
+                      && std::equal(renderer.getPlane<2>(), renderer.getPlane<2>() + size * size,
+                                    planes.data() + 2 * size * size);
+    printf("    planes %s\n", isMatching ? "match" : "DIFFER");
+}
@@ -0,0 +1,42 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <omp.h>
+#include "Benchmark.h"
+#include "BenchmarkSetup.h"
+
+static double measureSwapDecomposition(SwapDecomposition swapDecomposition, int numThreads)
+{
+    const int size = 400;
+    const unsigned int rounds = 500;
+    omp_set_num_threads(numThreads);
+    BenchmarkSetup setup(size, 0.5);
+    setup.microemulsion.setSwapDecomposition(swapDecomposition);
+    setup.microemulsion.performRandomSwaps(rounds / 10); // Warm-up
+    
+    double start = Benchmark::getCurrentTimeSeconds();
+    setup.microemulsion.performRandomSwaps(rounds);
+    return Benchmark::getCurrentTimeSeconds() - start;
+}
+
+// Strong scaling of the coloured and tiled decompositions of the swap sweep, on a fixed 400x400 grid, from one
+// thread up to the number of processors.
+BENCHMARK_CASE(SwapDecompositionStrongScaling)
+{
+    int maxThreads = omp_get_num_procs();
+    double colouredSerial = 0, tiledSerial = 0;
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        double coloured = measureSwapDecomposition(COLOURED_SWAP_DECOMPOSITION, numThreads);
+        double tiled = measureSwapDecomposition(TILED_SWAP_DECOMPOSITION, numThreads);
+        if (numThreads == 1)
+        {
+            colouredSerial = coloured;
+            tiledSerial = tiled;
+        }
+        printf("threads=%-3d coloured=%.3fs (speedup %.2f)    tiled=%.3fs (speedup %.2f)\n", numThreads,
+               coloured, colouredSerial / coloured, tiled, tiledSerial / tiled);
+    }
+    omp_set_num_threads(maxThreads);
+}
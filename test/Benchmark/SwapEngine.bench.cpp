@@ -0,0 +1,35 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "Benchmark.h"
+#include "BenchmarkSetup.h"
+
+static void measureSwapEngine(const char *engineName, SwapEngine swapEngine, double chromatinRatio)
+{
+    const int size = 200;
+    const unsigned int rounds = 2000;
+    BenchmarkSetup setup(size, chromatinRatio);
+    setup.microemulsion.setSwapEngine(swapEngine);
+    setup.microemulsion.performRandomSwaps(rounds / 10); // Warm-up
+    
+    double start = Benchmark::getCurrentTimeSeconds();
+    setup.microemulsion.performRandomSwaps(rounds);
+    double elapsed = Benchmark::getCurrentTimeSeconds() - start;
+    Benchmark::report(engineName, elapsed, static_cast<unsigned long>(setup.getCellsPerColour()) * rounds,
+                      "attempt");
+}
+
+// Per-attempt cost of the swap kernels. With a dense chromatin fraction most attempts reach the energy evaluation
+// instead of being discarded as meaningless. For the rejection-free kernel "attempts" are the equivalent number
+// of classic attempts over the same simulated time.
+BENCHMARK_CASE(SwapEngineAttemptCost)
+{
+    for (double chromatinRatio : {0.2, 0.5})
+    {
+        printf("chromatinRatio=%.1f\n", chromatinRatio);
+        measureSwapEngine("classic", CLASSIC_SWAP_ENGINE, chromatinRatio);
+        measureSwapEngine("lookup-table", LOOKUP_TABLE_SWAP_ENGINE, chromatinRatio);
+        measureSwapEngine("rejection-free", REJECTION_FREE_SWAP_ENGINE, chromatinRatio);
+    }
+}
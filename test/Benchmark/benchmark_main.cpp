@@ -0,0 +1,7 @@
+#include "Benchmark.h"
+
+// Run all the registered benchmarks, or only those whose name contains the first argument.
+int main(int argc, const char **argv)
+{
+    return Benchmark::runAll(argc > 1 ? argv[1] : "");
+}
@@ -0,0 +1,145 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include "../../src/Checkpoint/Checkpoint.h"
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+static const char *checkpointFile = "test.checkpoint";
+
+TEST_CASE("Checkpoints read back the values written, in the same order", "[Checkpoint]")
+{
+    {
+        CheckpointWriter writer(checkpointFile);
+        writer.writeTag("TEST");
+        writer.write(3.25);
+        writer.write(static_cast<uint64_t>(1) << 40);
+        writer.writeVector(std::vector<int>{4, -2, 7});
+        writer.writeSet(std::set<unsigned short>{9, 1, 5});
+        writer.commit();
+    }
+    {
+        CheckpointReader reader(checkpointFile);
+        reader.expectTag("TEST");
+        REQUIRE(reader.read<double>() == 3.25);
+        REQUIRE(reader.read<uint64_t>() == static_cast<uint64_t>(1) << 40);
+        std::vector<int> vector;
+        reader.readVector(vector);
+        REQUIRE(vector == std::vector<int>{4, -2, 7});
+        std::set<unsigned short> set;
+        reader.readSet(set);
+        REQUIRE(set == std::set<unsigned short>{1, 5, 9});
+        REQUIRE_THROWS_AS(reader.read<int>(), std::runtime_error); // Past the end
+    }
+    {
+        CheckpointReader reader(checkpointFile);
+        REQUIRE_THROWS_AS(reader.expectTag("GRID"), std::runtime_error);
+    }
+    {
+        // Without commit the previous checkpoint is left as it was
+        CheckpointWriter writer(checkpointFile);
+        writer.writeTag("LOST");
+    }
+    CheckpointReader reader(checkpointFile);
+    reader.expectTag("TEST");
+    std::remove(checkpointFile);
+}
+
+static std::vector<int> getGridContent(const Grid &grid)
+{
+    std::vector<int> result;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            int index = grid.getIndex(column, row);
+            result.push_back(grid.getState(index));
+            result.push_back(grid.getRnaContent(index));
+        }
+    }
+    return result;
+}
+
+static void runSteps(Microemulsion &microemulsion, ChemistryEngine chemistryEngine, int firstStep, int steps)
+{
+    for (int step = firstStep; step < firstStep + steps; ++step)
+    {
+        microemulsion.performRandomSwaps(50);
+        if (chemistryEngine == EVENT_DRIVEN_CHEMISTRY_ENGINE)
+        {
+            microemulsion.performChemicalEvents(0.5 * (step + 1));
+        }
+        else
+        {
+            microemulsion.performChemicalReactions();
+        }
+    }
+}
+
+// Checkpoint a run halfway, then check that the run restored from it ends on the same grid.
+static void checkRestart(Logger &logger, ChemistryEngine chemistryEngine, bool isRnaDecayLazy)
+{
+    RandomGenerator::getInstance().setSeed(97531);
+    
+    // Reference run, checkpointed halfway
+    Grid grid(40, 40, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.3, CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    Microemulsion microemulsion(grid, 0.33, logger, 0.5, 0.5, 0.1, 0.5, 0.1, 1.0, 0.05, 0.5, false);
+    microemulsion.setChemistryEngine(chemistryEngine);
+    microemulsion.setLazyRnaDecay(isRnaDecayLazy);
+    runSteps(microemulsion, chemistryEngine, 0, 10);
+    {
+        CheckpointWriter writer(checkpointFile);
+        grid.writeCheckpoint(writer);
+        microemulsion.writeCheckpoint(writer);
+        writer.commit();
+    }
+    runSteps(microemulsion, chemistryEngine, 10, 10);
+    
+    // Fresh objects, set up the same way and restored
+    Grid restoredGrid(40, 40, logger);
+    Microemulsion restoredMicroemulsion(restoredGrid, 0.33, logger, 0.5, 0.5, 0.1, 0.5, 0.1, 1.0, 0.05, 0.5, false);
+    restoredMicroemulsion.setChemistryEngine(chemistryEngine);
+    restoredMicroemulsion.setLazyRnaDecay(isRnaDecayLazy);
+    {
+        CheckpointReader reader(checkpointFile);
+        restoredGrid.readCheckpoint(reader);
+        restoredMicroemulsion.readCheckpoint(reader);
+    }
+    runSteps(restoredMicroemulsion, chemistryEngine, 10, 10);
+    REQUIRE(getGridContent(restoredGrid) == getGridContent(grid));
+    
+    std::remove(checkpointFile);
+}
+
+TEST_CASE("A microemulsion restored from a checkpoint continues bit-exactly", "[Checkpoint]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    for (ChemistryEngine chemistryEngine : {TAU_LEAPING_CHEMISTRY_ENGINE, EVENT_DRIVEN_CHEMISTRY_ENGINE})
+    {
+        checkRestart(logger, chemistryEngine, false);
+        checkRestart(logger, chemistryEngine, true);
+    }
+    
+    // A checkpoint is not restored into a grid of another size
+    {
+        Grid grid(40, 40, logger);
+        CheckpointWriter writer(checkpointFile);
+        grid.writeCheckpoint(writer);
+        writer.commit();
+    }
+    Grid otherGrid(30, 40, logger);
+    CheckpointReader reader(checkpointFile);
+    REQUIRE_THROWS_AS(otherGrid.readCheckpoint(reader), std::runtime_error);
+    std::remove(checkpointFile);
+}
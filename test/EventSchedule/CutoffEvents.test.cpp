@@ -0,0 +1,41 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/EventSchedule/CutoffEvents.h"
+#include "../../src/EventSchedule/EventSchedule.cpp" // Since template implementation is here
+
+TEST_CASE("Cutoff events scheduled in minutes apply at their simulation time", "[EventSchedule]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(20, 20, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.2, CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE));
+    // kOn, kOff, kChromPlus, kChromMinus, kRnaPlus, kRnaMinus, kRnaTransfer
+    Microemulsion microemulsion(grid, 0.33, logger, 0.1, 0.01, 0.02, 0.03, 0.04, 0.5, 0.05, 0.06, false);
+    std::set<ChainId> noChains;
+    
+    // Flavopiridol at minute 4, i.e. at simulation time 240 with times in minutes
+    const double timeMultiplier = 60;
+    EventSchedule<CutoffEvent> schedule(-1);
+    schedule.addEvents({4}, FLAVOPIRIDOL, timeMultiplier);
+    REQUIRE(schedule.getNextEventTime() == 240);
+    
+    // Not yet due
+    applyCutoffEvents(logger, schedule, microemulsion, noChains, noChains, noChains,
+                      0.01, 0.02, 0.03, 0.04, 0.5, 0.05, 0.06, 239, timeMultiplier);
+    REQUIRE(schedule.size() == 1);
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.5));
+    
+    // Due: the event is popped, so that the time-stepping loop can move on, and activation is switched off
+    applyCutoffEvents(logger, schedule, microemulsion, noChains, noChains, noChains,
+                      0.01, 0.02, 0.03, 0.04, 0.5, 0.05, 0.06, 240, timeMultiplier);
+    REQUIRE(schedule.size() == 0);
+    REQUIRE_FALSE(schedule.check(240));
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.04));
+}
@@ -0,0 +1,34 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include "../../src/EventSchedule/SweepScheduler.h"
+
+TEST_CASE("SweepScheduler runs exactly the rounds up to each target time", "[EventSchedule]")
+{
+    SweepScheduler scheduler(100); // 0.01 per round
+    
+    // A target on a round boundary is reached exactly, despite 0.3 * 100 not being an integer in floating point
+    REQUIRE(scheduler.getRoundsUntil(0.3) == 30);
+    REQUIRE(scheduler.advance(30, 0.3) == 0.3);
+    REQUIRE(scheduler.getRound() == 30);
+    
+    // A target between boundaries is reached at the next one, overshooting by less than a round
+    REQUIRE(scheduler.getRoundsUntil(0.3251) == 3);
+    double time = scheduler.advance(3, 0.3251);
+    REQUIRE(time == Approx(0.33));
+    REQUIRE(time >= 0.3251);
+    
+    // The clock always moves, even if the target was already reached
+    REQUIRE(scheduler.getRoundsUntil(0.1) == 1);
+    
+    // Many intervals do not make the time drift from rounds / roundsPerUnitTime
+    for (int interval = 0; interval < 1000; ++interval)
+    {
+        double target = scheduler.getTime() + 0.07;
+        scheduler.advance(scheduler.getRoundsUntil(target), target);
+    }
+    REQUIRE(scheduler.getRound() == 33 + 7000);
+    REQUIRE(scheduler.getTime() == Approx(70.33));
+}
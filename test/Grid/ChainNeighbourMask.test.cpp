@@ -0,0 +1,91 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <vector>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+// Recompute the mask of a chain entry from scratch, by looking up its neighbours' chain positions.
+static NeighbourMask computeChainNeighbourMask(Grid &grid, int column, int row, const ChainProperties &chain)
+{
+    NeighbourMask mask = 0;
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            if ((dx != 0 || dy != 0) && grid.isCellNeighbourInChain(column + dx, row + dy, chain))
+            {
+                mask |= Grid::getDirectionMask(dx, dy);
+            }
+        }
+    }
+    return mask;
+}
+
+static std::vector<int> getChainCellIndices(Grid &grid)
+{
+    std::vector<int> indices;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            if (grid.hasChain(column, row))
+            {
+                indices.push_back(grid.getIndex(column, row));
+            }
+        }
+    }
+    return indices;
+}
+
+static void checkChainNeighbourMasks(Grid &grid)
+{
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            const ChainProperties *chains = grid.getChainPropertiesOf(column, row);
+            for (unsigned char k = 0; chains != nullptr && k < MAX_CROSSING_CHAINS; ++k)
+            {
+                if (chains[k].chainLength == 0)
+                {
+                    continue;
+                }
+                INFO("column=" << column << " row=" << row << " chainId=" << chains[k].chainId);
+                REQUIRE(chains[k].neighbourMask == computeChainNeighbourMask(grid, column, row, chains[k]));
+                // Chains are contiguous: inner cells of a chain have both neighbours in their Moore neighbourhood
+                bool isEndOfChain = chains[k].position == 0 || chains[k].position == chains[k].chainLength - 1;
+                REQUIRE(__builtin_popcount(chains[k].neighbourMask) == (isEndOfChain ? 1 : 2));
+            }
+        }
+    }
+}
+
+TEST_CASE("Chain neighbour masks follow the chains through swaps", "[Grid]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    
+    Grid grid(40, 40, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridWithTwoOrthogonalChains(grid, 0, 0, CellData::chemicalPropertiesOf(CHROMATIN,
+                                                                                                      ACTIVE));
+    GridInitializer::initializeGridWithTwoParallelChains(grid, 6, CellData::chemicalPropertiesOf(CHROMATIN,
+                                                                                                 NOT_ACTIVE));
+    checkChainNeighbourMasks(grid);
+    std::vector<int> initialChainCells = getChainCellIndices(grid);
+    
+    // With omega=0 every legal swap is accepted, so chains move as much as possible
+    Microemulsion microemulsion(grid, 0, logger, 1, 0, 0, 0, 0, 0, 0, 0, false);
+    for (int i = 0; i < 20; ++i)
+    {
+        microemulsion.performRandomSwaps(200);
+        checkChainNeighbourMasks(grid);
+    }
+    REQUIRE(getChainCellIndices(grid) != initialChainCells);
+}
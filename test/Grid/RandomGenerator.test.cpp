@@ -48,18 +48,18 @@ public:
     FakeGrid();
 
 public:
-    static pcg32 rng;
+    static RandomEngine rng;
     #pragma omp threadprivate(rng)
 };
 
-pcg32 FakeGrid::rng = RandomGenerator::getInstance().getGenerator();
+RandomEngine FakeGrid::rng = RandomGenerator::getInstance().getGenerator();
 
 FakeGrid::FakeGrid()
 {
     #pragma omp parallel for schedule(static,1)
     for (int i=0; i<omp_get_num_threads(); ++i)
     {
-        rng = RandomGenerator::getInstance().getGenerator();
+        rng = RandomGenerator::getInstance().createGenerator(static_cast<unsigned int>(omp_get_thread_num()));
     }
 }
 
@@ -73,11 +73,11 @@ TEST_CASE( "RandomGenerator thread locality test", "[RandomGenerator]" )
     #pragma omp parallel for
     for (int i=0; i<NUM_THREADS; ++i)
     {
-        auto rng = RandomGenerator::getInstance().getGenerator();
+        auto rng = RandomGenerator::getInstance().createGenerator(static_cast<unsigned int>(omp_get_thread_num()));
         genRef[i] = &rng;
     
         int threadId = omp_get_thread_num();
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0,32003);
+        std::uniform_int_distribution<RandomEngine::result_type> dist(0,32003);
         for (int repeat = 0; repeat < REPEATS; ++repeat)
         {
             int value = static_cast<int>(dist(rng));
@@ -138,7 +138,7 @@ TEST_CASE( "RandomGenerator thread locality test with intermediate class", "[Ran
         genRef[i] = &rng;
         
         int threadId = omp_get_thread_num();
-        std::uniform_int_distribution<std::mt19937::result_type> dist(0,32003);
+        std::uniform_int_distribution<RandomEngine::result_type> dist(0,32003);
         for (int repeat = 0; repeat < REPEATS; ++repeat)
         {
             int value = static_cast<int>(dist(rng));
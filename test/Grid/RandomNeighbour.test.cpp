@@ -0,0 +1,51 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <set>
+#include <utility>
+#include "../../src/Grid/Grid.h"
+
+// Neighbours drawn out of evenly spaced random words, for a cell with numNeighbours neighbours inside the grid.
+static std::multiset<std::pair<int, int>> drawNeighbours(const Grid &grid, int column, int row, int numNeighbours)
+{
+    std::multiset<std::pair<int, int>> neighbours;
+    for (int k = 0; k < numNeighbours; ++k)
+    {
+        uint32_t randomWord = static_cast<uint32_t>(((2 * k + 1) * (1ULL << 32)) / (2 * numNeighbours));
+        int neighbourColumn, neighbourRow;
+        grid.pickRandomNeighbourOf(column, row, neighbourColumn, neighbourRow, randomWord);
+        neighbours.insert(std::make_pair(neighbourColumn, neighbourRow));
+    }
+    return neighbours;
+}
+
+TEST_CASE("Random neighbours are an exact draw among the neighbours inside the grid", "[Grid]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(6, 6, logger);
+    
+    // Each neighbour owns an equal share of the random words, so evenly spaced words hit each one exactly once
+    for (auto &cell : std::vector<std::pair<std::pair<int, int>, int>>{{{3, 3}, 8}, {{1, 1}, 3}, {{6, 6}, 3},
+                                                                      {{1, 4}, 5}, {{4, 6}, 5}})
+    {
+        int column = cell.first.first, row = cell.first.second, numNeighbours = cell.second;
+        auto neighbours = drawNeighbours(grid, column, row, numNeighbours);
+        std::set<std::pair<int, int>> distinctNeighbours(neighbours.begin(), neighbours.end());
+        REQUIRE(distinctNeighbours.size() == static_cast<size_t>(numNeighbours));
+        for (auto &neighbour : distinctNeighbours)
+        {
+            REQUIRE(std::abs(neighbour.first - column) <= 1);
+            REQUIRE(std::abs(neighbour.second - row) <= 1);
+            REQUIRE(neighbour != std::make_pair(column, row));
+            REQUIRE(neighbour.first >= 1);
+            REQUIRE(neighbour.first <= grid.getColumns());
+            REQUIRE(neighbour.second >= 1);
+            REQUIRE(neighbour.second <= grid.getRows());
+        }
+    }
+}
@@ -0,0 +1,32 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <limits>
+#include "../../src/Grid/Grid.h"
+
+TEST_CASE("RNA content saturates instead of wrapping around", "[Grid]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(3, 3, logger);
+    int index = grid.getIndex(2, 2);
+    const RnaCounter maxRnaContent = std::numeric_limits<RnaCounter>::max();
+    
+    grid.incrementRnaContent(index, maxRnaContent - 10);
+    grid.incrementRnaContent(index, 7);
+    REQUIRE(grid.getRnaContent(index) == maxRnaContent - 3);
+    // A whole multinomial share at once, as RNA transfer adds it
+    grid.incrementRnaContent(index, 1000);
+    REQUIRE(grid.getRnaContent(index) == maxRnaContent);
+    grid.incrementRnaContent(index);
+    REQUIRE(grid.getRnaContent(index) == maxRnaContent);
+    
+    grid.decrementRnaContent(index, maxRnaContent - 5);
+    REQUIRE(grid.getRnaContent(index) == 5);
+    grid.decrementRnaContent(index, 5);
+    REQUIRE(grid.getRnaContent(index) == 0);
+}
@@ -0,0 +1,31 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include "../../src/Logger/Logger.h"
+
+TEST_CASE("Logging macros skip the arguments of messages not logged", "[Logger]")
+{
+    Logger logger;
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    int evaluations = 0;
+    
+    SECTION("Below the runtime level")
+    {
+        logger.setDebugLevel(WARNING);
+        LOG_MSG(logger, INFO, "%s=%d", DUMP(++evaluations));
+        LOG_EVENT(logger, DEBUG, 0.5, "%s=%d", DUMP(++evaluations));
+        REQUIRE(evaluations == 0);
+        LOG_MSG(logger, WARNING, "%s=%d", DUMP(++evaluations));
+        LOG_EVENT(logger, ERROR, 0.5, "%s=%d", DUMP(++evaluations));
+        REQUIRE(evaluations == 2);
+    }
+    SECTION("Below the level compiled in")
+    {
+        logger.setDebugLevel(DEBUG);
+        LOG_MSG(logger, DEBUG, "%s=%d", DUMP(++evaluations));
+        REQUIRE(evaluations == (DEBUG >= LOG_MIN_LEVEL ? 1 : 0));
+    }
+}
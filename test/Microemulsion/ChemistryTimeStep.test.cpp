@@ -0,0 +1,61 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cmath>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+TEST_CASE("Chemistry time step follows the rates which can still fire", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(20, 20, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.2, CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE));
+    // kOn, kOff, kChromPlus, kChromMinus, kRnaPlus, kRnaMinus, kRnaTransfer
+    Microemulsion microemulsion(grid, 0.33, logger, 0.1, 0.01, 0.02, 0.03, 0.04, 0.5, 0.05, 0.06, false);
+    
+    // Chromatin can turn active and produce RNA: the production rate is the largest
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.5));
+    
+    // Without activation nor active chromatin, no RNA can be produced and RNA channels do not count
+    microemulsion.setKChromPlus(0);
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.04));
+    
+    // Unless there is RNA already
+    grid.incrementRnaContent(grid.getIndex(1, 1), 3);
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.06));
+    
+    // Nothing left to fire
+    microemulsion.setKOn(0);
+    microemulsion.setKOff(0);
+    microemulsion.setKChromMinus(0);
+    microemulsion.setKRnaMinusRbp(0);
+    microemulsion.setKRnaMinusTxn(0);
+    microemulsion.setKRnaTransfer(0);
+    REQUIRE(std::isinf(microemulsion.computeChemistryTimeStep(0.1)));
+}
+
+TEST_CASE("Chemistry time step reads the reactive sites once they are built", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(20, 20, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    grid.setActivity(grid.getIndex(5, 5), ACTIVE);
+    grid.incrementRnaContent(grid.getIndex(5, 5), 50);
+    Microemulsion microemulsion(grid, 0.33, logger, 0.1, 0.01, 0.02, 0.03, 0.04, 0.5, 0.05, 0.06, false);
+    
+    // Without chromatin only the RNA channels can fire, before and after the first step builds the list
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.06));
+    microemulsion.performChemicalReactions();
+    REQUIRE(grid.getRnaContent(grid.getIndex(5, 5)) > 0);
+    REQUIRE(microemulsion.computeChemistryTimeStep(0.1) == Approx(0.1 / 0.06));
+}
@@ -0,0 +1,34 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+TEST_CASE("Classic sweep draws a colour for every round", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    // On a 5x5 grid each colour has a single site, which initiates swaps in the rounds the colour is drawn. As the
+    // sweep stops before the last row and column, 16 of them do.
+    Grid grid(5, 5, logger);
+    // omega = 0: every meaningful attempt is accepted
+    Microemulsion microemulsion(grid, 0, logger, 0.1 / 3e-1, 2.5e-4, 3.3333e-3, 1.5e-3, 1.6666e-3, 3e-1,
+                                8.3333e-4, 3.3e-3, false);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    grid.setChemicalProperties(3, 3, CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE));
+    
+    // Only swaps involving the chromatin cell are meaningful. It moves to a neighbour n either when its own site
+    // initiates or when the one of n does and picks it, with rate (a/k + a_n/k_n) / 25, where a is 1 for initiating
+    // sites and k counts in-grid neighbours. Rates are symmetric, so its position is uniform and its mean swap rate
+    // is 2 * 16 / (25 * 25) per round. Sweeping the same colour in most rounds would instead freeze it, or bounce it
+    // off that site at every round.
+    const unsigned int rounds = 400000;
+    const double expectedSwaps = rounds * 32. / 625;
+    unsigned int swaps = microemulsion.performRandomSwaps(rounds);
+    REQUIRE(swaps > expectedSwaps * 0.85);
+    REQUIRE(swaps < expectedSwaps * 1.15);
+}
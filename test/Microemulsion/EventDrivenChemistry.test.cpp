@@ -0,0 +1,114 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cmath>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+static unsigned long countRna(const Grid &grid)
+{
+    unsigned long totalRna = 0;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            totalRna += grid.getRnaContent(grid.getIndex(column, row));
+        }
+    }
+    return totalRna;
+}
+
+TEST_CASE("Event-driven chemistry decays RNA with the exact exponential law", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    RandomGenerator::getInstance().setSeed(97531);
+    Grid grid(40, 40, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, ACTIVE));
+    const RnaCounter rnaContent = 20;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            grid.incrementRnaContent(grid.getIndex(column, row), rnaContent);
+        }
+    }
+    Microemulsion microemulsion(grid, 0.33, logger, 0.5, 0, 0, 0, 0, 0, 0.1, 0, false);
+    microemulsion.setChemistryEngine(EVENT_DRIVEN_CHEMISTRY_ENGINE);
+    // The clock is advanced in uneven intervals, the result must not depend on them
+    double time = 0;
+    unsigned long events = 0;
+    while (time < 15)
+    {
+        time = fmin(time + 0.7, 15);
+        events += microemulsion.performChemicalEvents(time);
+    }
+    
+    double initialRna = 40.0 * 40 * rnaContent;
+    double survivalProbability = std::exp(-0.1 * 15);
+    double standardDeviation = std::sqrt(initialRna * survivalProbability * (1 - survivalProbability));
+    unsigned long totalRna = countRna(grid);
+    REQUIRE(events == initialRna - totalRna);
+    REQUIRE(std::fabs(totalRna - initialRna * survivalProbability) < 5 * standardDeviation);
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            int index = grid.getIndex(column, row);
+            REQUIRE(grid.isActive(index) == (grid.getRnaContent(index) > 0));
+        }
+    }
+}
+
+TEST_CASE("Event-driven chemistry reaches the production-decay steady state", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    RandomGenerator::getInstance().setSeed(86420);
+    // Active chromatin only, which never switches off: RNA is produced at rate 1 and decays at rate 0.2 per unit,
+    // without RBP neighbours to transfer it to. The content of each cell is Poisson with mean 5 at steady state.
+    Grid grid(30, 30, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    Microemulsion microemulsion(grid, 0.33, logger, 0.1, 0, 0, 0, 0, 1.0, 0.2, 0.5, false);
+    microemulsion.setChemistryEngine(EVENT_DRIVEN_CHEMISTRY_ENGINE);
+    microemulsion.performChemicalEvents(60);
+    
+    double expectedRna = 30.0 * 30 * 5;
+    REQUIRE(std::fabs(countRna(grid) - expectedRna) < 5 * std::sqrt(expectedRna));
+}
+
+TEST_CASE("Event-driven chemistry fires each event at its drawn time", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    RandomGenerator::getInstance().setSeed(24680);
+    // RNA decay only, each event changes the grid
+    Grid grid(10, 10, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, ACTIVE));
+    grid.incrementRnaContent(grid.getIndex(5, 5), 10);
+    Microemulsion microemulsion(grid, 0.33, logger, 0.5, 0, 0, 0, 0, 0, 0.1, 0, false);
+    microemulsion.setChemistryEngine(EVENT_DRIVEN_CHEMISTRY_ENGINE);
+    
+    double previousEventTime = 0;
+    for (int event = 0; event < 10; ++event)
+    {
+        // Swap sweeps ending on the next event: nothing happens before it, then exactly that event
+        double eventTime = microemulsion.getNextChemicalEventTime();
+        REQUIRE(eventTime > previousEventTime);
+        REQUIRE(microemulsion.performChemicalEvents(previousEventTime + 0.5 * (eventTime - previousEventTime)) == 0);
+        REQUIRE(microemulsion.getNextChemicalEventTime() == eventTime);
+        REQUIRE(microemulsion.performChemicalEvents(eventTime) == 1);
+        previousEventTime = eventTime;
+    }
+    REQUIRE(grid.getRnaContent(grid.getIndex(5, 5)) == 0);
+    REQUIRE(std::isinf(microemulsion.getNextChemicalEventTime()));
+}
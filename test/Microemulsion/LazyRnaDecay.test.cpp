@@ -0,0 +1,108 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cmath>
+#include <omp.h>
+#include <vector>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+static Logger &openTestLogger(Logger &logger)
+{
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    return logger;
+}
+
+// Decay only: an RBP grid loaded with RNA and no chromatin, returns the total RNA left after the given steps.
+static unsigned long runDecay(Logger &logger, bool isRnaDecayLazy, int steps, RnaCounter rnaContent)
+{
+    Grid grid(40, 40, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, ACTIVE));
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            grid.incrementRnaContent(grid.getIndex(column, row), rnaContent);
+        }
+    }
+    Microemulsion microemulsion(grid, 0.33, logger, 0.5, 0, 0, 0, 0, 0, 0.1, 0, false);
+    microemulsion.setLazyRnaDecay(isRnaDecayLazy);
+    for (int step = 0; step < steps; ++step)
+    {
+        microemulsion.performChemicalReactions();
+    }
+    unsigned long totalRna = 0;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            int index = grid.getIndex(column, row);
+            totalRna += grid.getRnaContent(index);
+            REQUIRE(grid.isActive(index) == (grid.getRnaContent(index) > 0));
+        }
+    }
+    return totalRna;
+}
+
+TEST_CASE("Lazy and eager RNA decay leave the same expected amount of RNA", "[Microemulsion]")
+{
+    Logger logger;
+    openTestLogger(logger);
+    RandomGenerator::getInstance().setSeed(2468);
+    const int steps = 30;
+    const RnaCounter rnaContent = 20;
+    double initialRna = 40.0 * 40 * rnaContent;
+    double survivalProbability = std::pow(1 - 0.5 * 0.1, steps);
+    double expectedRna = initialRna * survivalProbability;
+    double standardDeviation = std::sqrt(initialRna * survivalProbability * (1 - survivalProbability));
+    
+    unsigned long eagerRna = runDecay(logger, false, steps, rnaContent);
+    unsigned long lazyRna = runDecay(logger, true, steps, rnaContent);
+    REQUIRE(std::fabs(eagerRna - expectedRna) < 5 * standardDeviation);
+    REQUIRE(std::fabs(lazyRna - expectedRna) < 5 * standardDeviation);
+}
+
+// Swaps and chemistry with lazy decay, returns states and RNA of the grid.
+static std::vector<int> runLazyDecay(Logger &logger, int numThreads)
+{
+    omp_set_num_threads(numThreads);
+    RandomGenerator::getInstance().setSeed(1357);
+    Grid grid(50, 50, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.3, CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    Microemulsion microemulsion(grid, 0.33, logger, 0.5, 0.5, 0.1, 0.5, 0.1, 1.0, 0.05, 0.5, false);
+    microemulsion.setLazyRnaDecay(true);
+    for (int step = 0; step < 20; ++step)
+    {
+        microemulsion.performRandomSwaps(100);
+        microemulsion.performChemicalReactions();
+    }
+    std::vector<int> result;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            int index = grid.getIndex(column, row);
+            result.push_back(grid.getState(index));
+            result.push_back(grid.getRnaContent(index));
+        }
+    }
+    return result;
+}
+
+TEST_CASE("Lazy RNA decay gives the same grid for any number of threads", "[Microemulsion]")
+{
+    Logger logger;
+    openTestLogger(logger);
+    int maxThreads = omp_get_max_threads();
+    
+    auto serialGrid = runLazyDecay(logger, 1);
+    auto parallelGrid = runLazyDecay(logger, 4);
+    REQUIRE(serialGrid == parallelGrid);
+    omp_set_num_threads(maxThreads);
+}
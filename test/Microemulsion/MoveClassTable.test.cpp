@@ -0,0 +1,35 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include "../../src/Microemulsion/MoveClassTable.h"
+
+TEST_CASE("MoveClassTable keeps classes and total rate consistent", "[Microemulsion]")
+{
+    MoveClassTable table;
+    table.reset(10, {1.0, 0.5});
+    REQUIRE(table.getTotalRate() == 0);
+    
+    table.setMoveClass(3, 0);
+    table.setMoveClass(7, 0);
+    table.setMoveClass(5, 1);
+    REQUIRE(table.getTotalRate() == Approx(2.5));
+    
+    // Class 0 spans [0, 2), class 1 spans [2, 2.5)
+    REQUIRE(table.pickMove(0.5) == 3);
+    REQUIRE(table.pickMove(1.5) == 7);
+    REQUIRE(table.pickMove(2.2) == 5);
+    
+    // Removing a move fills its hole with the last move of the class
+    table.setMoveClass(3, MoveClassTable::NO_CLASS);
+    REQUIRE(table.getMoveClass(3) == MoveClassTable::NO_CLASS);
+    REQUIRE(table.pickMove(0.5) == 7);
+    REQUIRE(table.getTotalRate() == Approx(1.5));
+    
+    // Moving across classes
+    table.setMoveClass(7, 1);
+    REQUIRE(table.getMoveClass(7) == 1);
+    REQUIRE(table.getTotalRate() == Approx(1.0));
+    REQUIRE(table.pickMove(0.99) == 7);
+}
@@ -0,0 +1,54 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <omp.h>
+#include <vector>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+// Run chemistry steps, with high rates to get plenty of production and transfer, and return states and RNA
+static std::vector<int> runChemistry(Logger &logger, int numThreads, unsigned int &chemicalChanges)
+{
+    omp_set_num_threads(numThreads);
+    RandomGenerator::getInstance().setSeed(4321);
+    Grid grid(50, 50, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.3, CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    Microemulsion microemulsion(grid, 0.33, logger, 0.5, 0.5, 0.1, 0.5, 0.1, 1.0, 0.05, 0.5, false);
+    chemicalChanges = 0;
+    for (int step = 0; step < 20; ++step)
+    {
+        chemicalChanges += microemulsion.performChemicalReactions();
+    }
+    std::vector<int> result;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            int index = grid.getIndex(column, row);
+            result.push_back(grid.getState(index));
+            result.push_back(grid.getRnaContent(index));
+        }
+    }
+    return result;
+}
+
+TEST_CASE("Parallel chemistry gives the same grid for any number of threads", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    int maxThreads = omp_get_max_threads();
+    
+    unsigned int serialChanges, parallelChanges;
+    auto serialGrid = runChemistry(logger, 1, serialChanges);
+    auto parallelGrid = runChemistry(logger, 4, parallelChanges);
+    REQUIRE(serialChanges > 0);
+    REQUIRE(serialChanges == parallelChanges);
+    REQUIRE(serialGrid == parallelGrid);
+    omp_set_num_threads(maxThreads);
+}
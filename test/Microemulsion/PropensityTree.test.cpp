@@ -0,0 +1,36 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include "../../src/Microemulsion/PropensityTree.h"
+
+TEST_CASE("PropensityTree keeps sums consistent and picks leaves by propensity", "[Microemulsion]")
+{
+    PropensityTree tree;
+    tree.reset(5); // Rounded up to 8 leaves
+    REQUIRE(tree.getTotalPropensity() == 0);
+    
+    tree.setPropensity(0, 1.0);
+    tree.setPropensity(2, 0.5);
+    tree.setPropensity(4, 2.0);
+    REQUIRE(tree.getTotalPropensity() == Approx(3.5));
+    REQUIRE(tree.getPropensity(2) == 0.5);
+    
+    // Leaf 0 spans [0, 1), leaf 2 spans [1, 1.5), leaf 4 spans [1.5, 3.5)
+    REQUIRE(tree.pickLeaf(0.5) == 0);
+    REQUIRE(tree.pickLeaf(1.2) == 2);
+    REQUIRE(tree.pickLeaf(1.5) == 4);
+    REQUIRE(tree.pickLeaf(3.49) == 4);
+    
+    // Updates replace the propensity, zero removes the leaf from the draw
+    tree.setPropensity(2, 0);
+    REQUIRE(tree.getTotalPropensity() == Approx(3.0));
+    REQUIRE(tree.pickLeaf(1.2) == 4);
+    tree.setPropensity(0, 0.25);
+    REQUIRE(tree.getTotalPropensity() == Approx(2.25));
+    REQUIRE(tree.pickLeaf(0.2) == 0);
+    
+    // A draw past the last non-empty leaf, as rounding could give, stays on it
+    REQUIRE(tree.pickLeaf(2.3) == 4);
+}
@@ -0,0 +1,186 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cstdlib>
+#include <map>
+#include <utility>
+#include <vector>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+static void initializeChromatinGrid(Grid &grid, double chromatinRatio)
+{
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, chromatinRatio, CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, chromatinRatio,
+                                            CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE));
+}
+
+// Three chains of 12 cells, straight, diagonal and zig-zagging, which end away from the boundary
+static void addChains(Grid &grid)
+{
+    const Displacement straight(1, 0), diagonal(1, 1), up(1, -1);
+    int column = 4, row = 5;
+    GridInitializer::initializeGridWithStepInstructions(grid, column, row, std::vector<Displacement>(11, straight),
+                                                        CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE));
+    column = 4, row = 10;
+    GridInitializer::initializeGridWithStepInstructions(grid, column, row, std::vector<Displacement>(11, diagonal),
+                                                        CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    std::vector<Displacement> zigZag;
+    for (int step = 0; step < 11; ++step)
+    {
+        zigZag.push_back(step % 2 ? up : diagonal);
+    }
+    column = 18, row = 8;
+    GridInitializer::initializeGridWithStepInstructions(grid, column, row, zigZag,
+                                                        CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE),
+                                                        CellData::flagsOf(TRANSCRIBABLE, TRANSCRIPTION_POSSIBLE));
+}
+
+// Every chain cell must have its predecessor and successor within its Moore neighbourhood
+static bool areChainsIntact(Grid &grid)
+{
+    std::map<std::pair<ChainId, unsigned short>, std::pair<int, int>> chainCells;
+    for (int row = 0; row < grid.getExtendedRows(); ++row)
+    {
+        for (int column = 0; column < grid.getExtendedColumns(); ++column)
+        {
+            const ChainProperties *chains = grid.getChainPropertiesOf(column, row);
+            for (unsigned char k = 0; chains != nullptr && k < MAX_CROSSING_CHAINS; ++k)
+            {
+                if (chains[k].chainLength > 0)
+                {
+                    chainCells[{chains[k].chainId, chains[k].position}] = {column, row};
+                }
+            }
+        }
+    }
+    for (auto &cell : chainCells)
+    {
+        auto successor = chainCells.find({cell.first.first, cell.first.second + 1});
+        if (successor != chainCells.end()
+            && (std::abs(successor->second.first - cell.second.first) > 1
+                || std::abs(successor->second.second - cell.second.second) > 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// States of the halo, which swaps must never reach
+static std::vector<CellState> getOuterStates(Grid &grid)
+{
+    std::vector<CellState> outerStates;
+    for (int row = 0; row < grid.getExtendedRows(); ++row)
+    {
+        for (int column = 0; column < grid.getExtendedColumns(); ++column)
+        {
+            if (!grid.isCellWithinInternalDomain(column, row))
+            {
+                outerStates.push_back(grid.getState(grid.getIndex(column, row)));
+            }
+        }
+    }
+    return outerStates;
+}
+
+// Pairs of neighbouring chromatin cells, each pair counted once
+static int countChromatinContacts(Grid &grid)
+{
+    const int forwardDirections[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+    int contacts = 0;
+    for (int row = grid.getFirstRow(); row <= grid.getLastRow(); ++row)
+    {
+        for (int column = grid.getFirstColumn(); column <= grid.getLastColumn(); ++column)
+        {
+            for (auto &direction : forwardDirections)
+            {
+                int nColumn = column + direction[0], nRow = row + direction[1];
+                contacts += grid.isChromatin(grid.getIndex(column, row))
+                            && grid.isCellWithinInternalDomain(nColumn, nRow)
+                            && grid.isChromatin(grid.getIndex(nColumn, nRow));
+            }
+        }
+    }
+    return contacts;
+}
+
+TEST_CASE("Rejection-free swaps keep the move classes of a rebuild and the chains intact", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    
+    for (ChemistryEngine chemistryEngine : {TAU_LEAPING_CHEMISTRY_ENGINE, EVENT_DRIVEN_CHEMISTRY_ENGINE})
+    {
+        RandomGenerator::getInstance().setSeed(42);
+        Grid grid(30, 30, logger);
+        initializeChromatinGrid(grid, 0.15);
+        addChains(grid);
+        // Sticky boundary, and chemistry slow enough for the table to be updated around the changed cells
+        Microemulsion microemulsion(grid, 0.5, logger, 0.1, 0.05, 0.05, 0.05, 0.05, 0.1, 0.05, 0.05, true);
+        microemulsion.setSwapEngine(REJECTION_FREE_SWAP_ENGINE);
+        microemulsion.setChemistryEngine(chemistryEngine);
+        REQUIRE(areChainsIntact(grid));
+        auto outerStates = getOuterStates(grid);
+        
+        unsigned int swaps = 0;
+        for (int round = 1; round <= 300; ++round)
+        {
+            swaps += microemulsion.performRandomSwaps(1);
+            REQUIRE(areChainsIntact(grid));
+            REQUIRE(getOuterStates(grid) == outerStates);
+            if (round % 10 == 0)
+            {
+                REQUIRE(microemulsion.isMoveClassTableConsistent());
+                if (chemistryEngine == TAU_LEAPING_CHEMISTRY_ENGINE)
+                {
+                    microemulsion.performChemicalReactions();
+                }
+                else
+                {
+                    microemulsion.performChemicalEvents(round * 0.01);
+                }
+                REQUIRE(microemulsion.isMoveClassTableConsistent());
+            }
+        }
+        REQUIRE(swaps > 0);
+    }
+}
+
+TEST_CASE("Rejection-free swaps relax like the lookup-table engine", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    
+    // Both engines attempt the same swaps at the same rates per round: after a fixed number of rounds, the
+    // chromatin contacts averaged over the same seeds agree, within much less than they moved from the start.
+    const int numSeeds = 16;
+    const unsigned int rounds = 2000;
+    double initialContacts = 0;
+    double meanContacts[2] = {0, 0};
+    const SwapEngine swapEngines[2] = {LOOKUP_TABLE_SWAP_ENGINE, REJECTION_FREE_SWAP_ENGINE};
+    for (int engine = 0; engine < 2; ++engine)
+    {
+        for (int seed = 1; seed <= numSeeds; ++seed)
+        {
+            RandomGenerator::getInstance().setSeed(static_cast<uint64_t>(seed));
+            Grid grid(40, 40, logger);
+            initializeChromatinGrid(grid, 0.2);
+            initialContacts += countChromatinContacts(grid) / (2. * numSeeds);
+            Microemulsion microemulsion(grid, 0.3, logger, 1, 0, 0, 0, 0, 0, 0, 0, false);
+            microemulsion.setSwapEngine(swapEngines[engine]);
+            microemulsion.performRandomSwaps(rounds);
+            meanContacts[engine] += countChromatinContacts(grid) / static_cast<double>(numSeeds);
+        }
+    }
+    REQUIRE(std::abs(meanContacts[0] - initialContacts) > initialContacts * 0.06);
+    REQUIRE(meanContacts[1] == Approx(meanContacts[0]).epsilon(0.03));
+}
@@ -0,0 +1,58 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <omp.h>
+#include <vector>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Microemulsion/Microemulsion.h"
+
+static void initializeChromatinGrid(Grid &grid)
+{
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.2, CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE));
+    GridInitializer::initializeGridRandomly(grid, 0.2, CellData::chemicalPropertiesOf(CHROMATIN, NOT_ACTIVE));
+}
+
+static std::vector<CellState> getStates(const Grid &grid)
+{
+    const CellState *states = grid.getStatePlane();
+    return std::vector<CellState>(states, states + grid.getExtendedColumns() * grid.getExtendedRows());
+}
+
+// Run the given number of rounds on a fresh grid and return the final states and the number of swaps performed
+static std::vector<CellState> runSwaps(Logger &logger, SwapDecomposition swapDecomposition, int numThreads,
+                                       unsigned int rounds, unsigned int &swaps)
+{
+    omp_set_num_threads(numThreads);
+    RandomGenerator::getInstance().setSeed(1234);
+    Grid grid(60, 60, logger);
+    initializeChromatinGrid(grid);
+    Microemulsion microemulsion(grid, 0.33, logger, 1, 0, 0, 0, 0, 0, 0, 0, false);
+    microemulsion.setSwapDecomposition(swapDecomposition);
+    swaps = microemulsion.performRandomSwaps(rounds);
+    return getStates(grid);
+}
+
+TEST_CASE("Tiled swaps do not depend on the number of threads", "[Microemulsion]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    int maxThreads = omp_get_max_threads();
+    
+    unsigned int serialSwaps, parallelSwaps;
+    auto serialStates = runSwaps(logger, TILED_SWAP_DECOMPOSITION, 1, 500, serialSwaps);
+    auto parallelStates = runSwaps(logger, TILED_SWAP_DECOMPOSITION, 3, 500, parallelSwaps);
+    REQUIRE(serialSwaps == parallelSwaps);
+    REQUIRE(serialStates == parallelStates);
+    
+    // Same cells and random numbers as the coloured sweep, in a different order: swap rates agree
+    unsigned int colouredSwaps;
+    runSwaps(logger, COLOURED_SWAP_DECOMPOSITION, 1, 500, colouredSwaps);
+    REQUIRE(serialSwaps == Approx(colouredSwaps).epsilon(0.05));
+    omp_set_num_threads(maxThreads);
+}
@@ -0,0 +1,122 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <cmath>
+#include "catch.hpp"
+#include "../../src/Utils/CounterBasedGenerator.h"
+
+TEST_CASE("Philox4x32-10 matches the Random123 known-answer vectors", "[CounterBasedGenerator]")
+{
+    uint32_t out[4];
+    
+    const uint32_t zeroCounter[4] = {0, 0, 0, 0}, zeroKey[2] = {0, 0};
+    CounterBasedGenerator::philox4x32(zeroCounter, zeroKey, out);
+    REQUIRE(out[0] == 0x6627e8d5);
+    REQUIRE(out[1] == 0xe169c58d);
+    REQUIRE(out[2] == 0xbc57ac4c);
+    REQUIRE(out[3] == 0x9b00dbd8);
+    
+    const uint32_t onesCounter[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+    const uint32_t onesKey[2] = {0xffffffff, 0xffffffff};
+    CounterBasedGenerator::philox4x32(onesCounter, onesKey, out);
+    REQUIRE(out[0] == 0x408f276d);
+    REQUIRE(out[1] == 0x41c83b0e);
+    REQUIRE(out[2] == 0xa20bc7c6);
+    REQUIRE(out[3] == 0x6d5451fd);
+    
+    const uint32_t piCounter[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+    const uint32_t piKey[2] = {0xa4093822, 0x299f31d0};
+    CounterBasedGenerator::philox4x32(piCounter, piKey, out);
+    REQUIRE(out[0] == 0xd16cfe09);
+    REQUIRE(out[1] == 0x94fdcceb);
+    REQUIRE(out[2] == 0x5001e420);
+    REQUIRE(out[3] == 0x24126ea1);
+}
+
+TEST_CASE("CounterBasedGenerator streams only depend on seed, site, step and purpose", "[CounterBasedGenerator]")
+{
+    CounterBasedGenerator generator(42), sameGenerator(42), otherGenerator(43);
+    auto stream = generator.getStream(7, 1234567890123ULL, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+    auto sameStream = sameGenerator.getStream(7, 1234567890123ULL, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+    auto otherSeed = otherGenerator.getStream(7, 1234567890123ULL, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+    auto otherSite = generator.getStream(8, 1234567890123ULL, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+    auto otherStep = generator.getStream(7, 1234567890124ULL, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+    auto otherPurpose = generator.getStream(7, 1234567890123ULL, CounterBasedGenerator::CHEMISTRY_DECAY_PURPOSE);
+    
+    int differences[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 100; ++i) // More than one block per stream
+    {
+        uint32_t word = stream();
+        REQUIRE(word == sameStream());
+        differences[0] += word != otherSeed();
+        differences[1] += word != otherSite();
+        differences[2] += word != otherStep();
+        differences[3] += word != otherPurpose();
+    }
+    for (int difference : differences)
+    {
+        REQUIRE(difference > 95);
+    }
+    
+    auto uniformStream = generator.getStream(0, 0, CounterBasedGenerator::CHEMISTRY_DECAY_PURPOSE);
+    double sum = 0;
+    for (int i = 0; i < 100000; ++i)
+    {
+        double value = uniformStream.uniformDouble();
+        REQUIRE(value >= 0);
+        REQUIRE(value < 1);
+        sum += value;
+        REQUIRE(uniformStream.uniformInt(9) < 9);
+    }
+    REQUIRE(sum / 100000 == Approx(0.5).epsilon(0.01));
+}
+
+TEST_CASE("CounterBasedGenerator batched blocks match the first block of each stream", "[CounterBasedGenerator]")
+{
+    CounterBasedGenerator generator(42);
+    const int count = 37;
+    const uint32_t firstSite = 1003, siteStride = 5;
+    const uint64_t step = (1ULL << 40) + 17;
+    uint32_t blocks[4 * count];
+    generator.fillBlocks(firstSite, siteStride, count, step, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE, blocks);
+    for (int k = 0; k < count; ++k)
+    {
+        auto stream = generator.getStream(firstSite + k * siteStride, step, CounterBasedGenerator::SWAP_ATTEMPT_PURPOSE);
+        for (int w = 0; w < 4; ++w)
+        {
+            REQUIRE(blocks[w * count + k] == stream());
+        }
+    }
+}
+
+TEST_CASE("CounterBasedGenerator binomial draws match the per-trial draws", "[CounterBasedGenerator]")
+{
+    CounterBasedGenerator generator(7);
+    const int samples = 20000;
+    for (unsigned int trials : {1u, 30u, 500u})
+    {
+        for (double probability : {0.002, 0.1, 0.7})
+        {
+            double sum = 0, squareSum = 0;
+            for (int sample = 0; sample < samples; ++sample)
+            {
+                auto stream = generator.getStream(static_cast<uint32_t>(sample), trials,
+                                                  CounterBasedGenerator::CHEMISTRY_DECAY_PURPOSE);
+                unsigned int successes = stream.binomial(trials, probability);
+                REQUIRE(successes <= trials);
+                sum += successes;
+                squareSum += static_cast<double>(successes) * successes;
+            }
+            double mean = sum / samples, variance = squareSum / samples - mean * mean;
+            double expectedMean = trials * probability, expectedVariance = expectedMean * (1 - probability);
+            // Within 5 standard errors of the mean, the variance is only as precise as the number of successes allows
+            REQUIRE(std::abs(mean - expectedMean) < 5 * std::sqrt(expectedVariance / samples));
+            REQUIRE(variance == Approx(expectedVariance).epsilon(0.05 + 5 / std::sqrt(expectedMean * samples)));
+        }
+    }
+    auto stream = generator.getStream(0, 0, CounterBasedGenerator::CHEMISTRY_DECAY_PURPOSE);
+    REQUIRE(stream.binomial(0, 0.5) == 0);
+    REQUIRE(stream.binomial(10, 0) == 0);
+    REQUIRE(stream.binomial(10, 1.5) == 10);
+}
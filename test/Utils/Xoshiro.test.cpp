@@ -0,0 +1,56 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include <vector>
+#include "catch.hpp"
+#include "../../src/Utils/Xoshiro.h"
+#include "../../src/Utils/RandomGenerator.h"
+
+template<typename Engine>
+static std::vector<typename Engine::result_type> drawFrom(Engine engine, int count)
+{
+    std::vector<typename Engine::result_type> values;
+    for (int i = 0; i < count; ++i)
+    {
+        values.push_back(engine());
+    }
+    return values;
+}
+
+template<typename Engine>
+static void checkSeeding()
+{
+    std::seed_seq seedSequence{1u, 2u, 3u}, sameSeedSequence{1u, 2u, 3u}, otherSeedSequence{1u, 2u, 4u};
+    Engine engine(seedSequence), sameEngine(sameSeedSequence), otherEngine(otherSeedSequence);
+    REQUIRE(drawFrom(engine, 16) == drawFrom(sameEngine, 16));
+    REQUIRE(drawFrom(engine, 16) != drawFrom(otherEngine, 16));
+    
+    // Discarding is the same as drawing
+    Engine skippingEngine = engine;
+    skippingEngine.discard(5);
+    REQUIRE(drawFrom(engine, 6).back() == drawFrom(skippingEngine, 1).front());
+    
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    double sum = 0;
+    const int draws = 100000;
+    for (int i = 0; i < draws; ++i)
+    {
+        sum += distribution(engine);
+    }
+    REQUIRE(std::abs(sum / draws - 0.5) < 1e-2);
+}
+
+TEST_CASE("Xoshiro engines are deterministic functions of their seed", "[Xoshiro]")
+{
+    checkSeeding<Xoshiro128PlusPlus>();
+    checkSeeding<Xoshiro256PlusPlus>();
+}
+
+TEST_CASE("Configured RandomEngine streams are deterministic functions of seed and stream", "[Xoshiro]")
+{
+    RandomGenerator::getInstance().setSeed(42);
+    auto values = drawFrom(RandomGenerator::getInstance().createGenerator(0), 16);
+    REQUIRE(values == drawFrom(RandomGenerator::getInstance().createGenerator(0), 16));
+    REQUIRE(values != drawFrom(RandomGenerator::getInstance().createGenerator(1), 16));
+}
@@ -0,0 +1,111 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Visualization/AsyncSnapshotWriter.h"
+
+static std::string readSamples(const std::string &fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return content.substr(content.size() - 4); // 2x2 binary samples
+}
+
+// Write 4 snapshots and an extra one of a grid whose top left RNA content is the number of snapshots taken so far
+static void writeAndCheckSnapshots(unsigned int queueDepth)
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(2, 2, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    auto chromatinSignal = [](const CellData &cellData) -> unsigned char {
+        return (unsigned char) CellData::isChromatin(cellData.chemicalProperties);
+    };
+    auto rnaCountSignal = [](const CellData &cellData) -> RnaCounter {
+        return cellData.rnaContent;
+    };
+    PgmWriter dnaWriter(logger, 2, 2, "test_async_DNA", "DNA", chromatinSignal);
+    PgmWriter rnaWriter(logger, 2, 2, "test_async_RNA", "RNA", rnaCountSignal, 255);
+    PgmWriter transcriptionWriter(logger, 2, 2, "test_async_Transcription", "Pol II Ser2Phos", chromatinSignal);
+    for (PgmWriter *writer : {&dnaWriter, &rnaWriter, &transcriptionWriter})
+    {
+        writer->setFormat(BINARY_PGM);
+    }
+    {
+        AsyncSnapshotWriter snapshotWriter(logger, grid, dnaWriter, rnaWriter, transcriptionWriter, nullptr, nullptr,
+                                           nullptr, queueDepth);
+        // The grid changes right after each submit, while the snapshot may still be waiting to be written
+        for (int snapshot = 0; snapshot < 4; ++snapshot)
+        {
+            snapshotWriter.submit(snapshot, 0, 0, 0);
+            grid.incrementRnaContent(grid.getIndex(1, 2)); // Top left
+        }
+        snapshotWriter.submit(4, 0, 0, 0, true);
+        snapshotWriter.flush();
+        REQUIRE(dnaWriter.getCounter() == 4);
+        REQUIRE(rnaWriter.getCounter() == 4);
+    }
+    for (int snapshot = 0; snapshot < 4; ++snapshot)
+    {
+        std::string snapshotId = std::to_string(snapshot);
+        std::string fileName = "test_async_RNA_" + snapshotId + "_" + snapshotId + ".00.pgm";
+        REQUIRE(readSamples(fileName) == std::string(1, static_cast<char>(snapshot)) + std::string(3, '\0'));
+    }
+    REQUIRE(readSamples("test_async_RNA_EXTRA.pgm") == std::string("\x04\0\0\0", 4));
+}
+
+TEST_CASE("Snapshots are written from a copy of the grid taken at submit time", "[Visualization]")
+{
+    SECTION("In the simulation thread")
+    {
+        writeAndCheckSnapshots(0);
+    }
+    SECTION("With a single staging buffer, each submit waits for the previous snapshot")
+    {
+        writeAndCheckSnapshots(1);
+    }
+    SECTION("With more staging buffers than snapshots")
+    {
+        writeAndCheckSnapshots(8);
+    }
+}
+
+TEST_CASE("Snapshots are analyzed with the RNA saturated at 255, as in the 8 bit images", "[Visualization]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(2, 2, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    grid.incrementRnaContent(grid.getIndex(1, 1), 1000);
+    grid.incrementRnaContent(grid.getIndex(2, 2), 7);
+    auto chromatinSignal = [](const CellData &cellData) -> unsigned char {
+        return (unsigned char) CellData::isChromatin(cellData.chemicalProperties);
+    };
+    auto rnaCountSignal = [](const CellData &cellData) -> RnaCounter {
+        return cellData.rnaContent;
+    };
+    // The 16 bit RNA files of the binary format do not change what is analyzed
+    PgmWriter dnaWriter(logger, 2, 2, "test_async_DNA", "DNA", chromatinSignal);
+    PgmWriter rnaWriter(logger, 2, 2, "test_async_RNA", "RNA", rnaCountSignal, 65535);
+    PgmWriter transcriptionWriter(logger, 2, 2, "test_async_Transcription", "Pol II Ser2Phos", chromatinSignal);
+    SnapshotAnalyzer analyzer(logger, 2, 2, 1, "test_async_analysis.csv");
+    analyzer.addChannel("DNA");
+    analyzer.addChannel("RNA");
+    analyzer.addChannel("TXN");
+    AsyncSnapshotWriter snapshotWriter(logger, grid, dnaWriter, rnaWriter, transcriptionWriter, nullptr, &analyzer,
+                                       nullptr, 0);
+    snapshotWriter.submit(0, 0, 0, 0, false, false, true);
+    snapshotWriter.flush();
+    REQUIRE(analyzer.getMeasures(1).total == 255 + 7);
+    REQUIRE(analyzer.getMeasures(1).mean == Approx((255 + 7) / 4.));
+}
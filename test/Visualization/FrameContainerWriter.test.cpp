@@ -0,0 +1,93 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Visualization/FrameContainerWriter.h"
+
+static const char *containerFile = "test.frames";
+
+static std::vector<unsigned char> readFile(const char *fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+template<typename T>
+static T readValue(const std::vector<unsigned char> &bytes, size_t offset)
+{
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+TEST_CASE("Frame containers hold fixed-size frames addressed by number", "[Visualization]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(6, 4, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    grid.setElement(2, 4, CellData(CellData::stateOf(CellData::chemicalPropertiesOf(CHROMATIN, ACTIVE), 0), 0)); // Top row
+    auto chromatinSignal = [](const CellData &cellData) -> unsigned char {
+        return (unsigned char) (255 * CellData::isChromatin(cellData.chemicalProperties));
+    };
+    auto activeSignal = [](const CellData &cellData) -> unsigned char {
+        return (unsigned char) CellData::isActive(cellData.chemicalProperties);
+    };
+    CheckpointWriter checkpointWriter("test.checkpoint");
+    {
+        FrameContainerWriter frameWriter(logger, 6, 4, containerFile);
+        frameWriter.addChannel("DNA", chromatinSignal);
+        frameWriter.addChannel("Active", activeSignal);
+        frameWriter.setData(grid.getStatePlane(), grid.getRnaContentPlane(), grid.getExtendedColumns());
+        frameWriter.write(0, 0, 0, 0);
+        frameWriter.writeCheckpoint(checkpointWriter);
+        frameWriter.write(1.5, 100, 7, 3, true);
+        REQUIRE(frameWriter.getNumFrames() == 2);
+    }
+    checkpointWriter.commit();
+    
+    auto bytes = readFile(containerFile);
+    uint32_t headerSize = readValue<uint32_t>(bytes, 12);
+    uint64_t numFrames = readValue<uint64_t>(bytes, 32);
+    uint64_t frameSize = readValue<uint64_t>(bytes, 40);
+    REQUIRE(std::memcmp(bytes.data(), "AMEFRAME", 8) == 0);
+    REQUIRE(readValue<uint32_t>(bytes, 24) == 2); // Channels
+    REQUIRE(std::string(reinterpret_cast<const char *>(bytes.data()) + 48 + 32) == "Active");
+    REQUIRE(numFrames == 2);
+    REQUIRE(frameSize == FrameContainerWriter::frameMetadataSize + 2 * 6 * 4);
+    REQUIRE(bytes.size() == headerSize + numFrames * frameSize);
+    size_t secondFrame = headerSize + frameSize;
+    REQUIRE(readValue<double>(bytes, secondFrame) == 1.5);
+    REQUIRE(readValue<uint64_t>(bytes, secondFrame + 8) == 100);
+    REQUIRE(readValue<uint32_t>(bytes, secondFrame + 32) == 1); // Extra snapshot
+    // Top row first, as in the PGM files: the chromatin cell is the second byte of each plane
+    size_t planes = secondFrame + FrameContainerWriter::frameMetadataSize;
+    REQUIRE(bytes[planes] == 0);
+    REQUIRE(bytes[planes + 1] == 255);
+    REQUIRE(bytes[planes + 6 * 4 + 1] == 1);
+    
+    // Restoring the checkpoint taken after the first frame cuts the container back to it
+    {
+        FrameContainerWriter frameWriter(logger, 6, 4, containerFile);
+        frameWriter.addChannel("DNA", chromatinSignal);
+        frameWriter.addChannel("Active", activeSignal);
+        CheckpointReader checkpointReader("test.checkpoint");
+        frameWriter.readCheckpoint(checkpointReader);
+        REQUIRE(frameWriter.getNumFrames() == 1);
+    }
+    bytes = readFile(containerFile);
+    REQUIRE(readValue<uint64_t>(bytes, 32) == 1);
+    REQUIRE(bytes.size() == headerSize + frameSize);
+    std::remove(containerFile);
+    std::remove("test.checkpoint");
+}
@@ -0,0 +1,48 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <algorithm>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Visualization/MultiChannelRenderer.h"
+#include "../../src/Visualization/SnapshotChannels.h"
+
+TEST_CASE("Channels rendered in one pass match the per-cell conversions", "[Visualization]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    const int columns = 13, rows = 7;
+    Grid grid(columns, rows, logger);
+    for (int row = 1; row <= rows; ++row)
+    {
+        for (int column = 1; column <= columns; ++column)
+        {
+            ChemicalProperties chemicalProperties = static_cast<ChemicalProperties>((column + 3 * row) % 4);
+            RnaCounter rnaContent = static_cast<RnaCounter>(column * 37 + row * 101);
+            grid.setElement(column, row, CellData(CellData::stateOf(chemicalProperties, 0), rnaContent));
+        }
+    }
+    typedef MultiChannelRenderer<DnaChannel, RnaChannel, RnaCountChannel, TranscriptionChannel> Renderer;
+    static_assert(Renderer::numChannels == 4, "One plane per channel");
+    Renderer renderer(columns, rows);
+    renderer.render(grid.getStatePlane(), grid.getRnaContentPlane(), grid.getExtendedColumns());
+    
+    // Top row first
+    size_t sample = 0;
+    for (int row = rows; row >= 1; --row)
+    {
+        for (int column = 1; column <= columns; ++column, ++sample)
+        {
+            int index = grid.getIndex(column, row);
+            const CellData cellData(grid.getStatePlane()[index], grid.getRnaContentPlane()[index]);
+            REQUIRE(renderer.getPlane<0>()[sample] == 255 * CellData::isChromatin(cellData.chemicalProperties));
+            REQUIRE(renderer.getPlane<1>()[sample] == std::min<int>(cellData.rnaContent, 255));
+            REQUIRE(renderer.getPlane<2>()[sample] == cellData.rnaContent);
+            REQUIRE(renderer.getPlane<3>()[sample] ==
+                    255 * CellData::isActiveChromatin(cellData.chemicalProperties));
+        }
+    }
+}
@@ -0,0 +1,70 @@
+//
+// Created by tommaso on 17/10/26.
+//
+
+#include "catch.hpp"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "../../src/Grid/Grid.h"
+#include "../../src/Grid/GridInitializer.h"
+#include "../../src/Visualization/PgmWriter.h"
+
+static std::string readFile(const std::string &fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static const std::string pgmHeader(const char *magic, const std::string &depth)
+{
+    return std::string(magic) + "\n# Channel: RNA\n# 0 - NoSignal\n# 1-" + depth + " - Signal (count, saturated at " +
+           depth + ")\n3 2\n" + depth + "\n";
+}
+
+TEST_CASE("PGM snapshots are written as ASCII or binary, top row first", "[Visualization]")
+{
+    Logger logger;
+    logger.setDebugLevel(WARNING);
+    logger.setLogFileName("test.log");
+    logger.openLogFile();
+    Grid grid(3, 2, logger);
+    GridInitializer::initializeInnerGridAs(grid, CellData::chemicalPropertiesOf(RBP, NOT_ACTIVE));
+    grid.incrementRnaContent(grid.getIndex(2, 2), 300); // Top row
+    grid.incrementRnaContent(grid.getIndex(3, 1), 7);
+    auto rnaCountSignal = [](const CellData &cellData) -> RnaCounter {
+        return cellData.rnaContent;
+    };
+    
+    SECTION("ASCII values saturate at 255")
+    {
+        PgmWriter writer(logger, 3, 2, "test_RNA", "RNA", rnaCountSignal, 255);
+        writer.setData(grid.getStatePlane(), grid.getRnaContentPlane(), grid.getExtendedColumns());
+        writer.write(0);
+        REQUIRE(readFile("test_RNA_0_0.00.pgm") == pgmHeader("P2", "255") + "0 255 0 \n0 0 7 \n");
+    }
+    SECTION("Binary values are 16 bit big-endian above depth 255")
+    {
+        PgmWriter writer(logger, 3, 2, "test_RNA", "RNA", rnaCountSignal, 65535);
+        writer.setFormat(BINARY_PGM);
+        writer.setData(grid.getStatePlane(), grid.getRnaContentPlane(), grid.getExtendedColumns());
+        writer.write(0);
+        std::string samples("\0\0\x01\x2c\0\0\0\0\0\0\0\x07", 12);
+        REQUIRE(readFile("test_RNA_0_0.00.pgm") == pgmHeader("P5", "65535") + samples);
+    }
+    SECTION("Binary values are single bytes up to depth 255")
+    {
+        PgmWriter writer(logger, 3, 2, "test_RNA", "RNA", rnaCountSignal, 255);
+        writer.setFormat(BINARY_PGM);
+        writer.setData(grid.getStatePlane(), grid.getRnaContentPlane(), grid.getExtendedColumns());
+        writer.write(0);
+        std::string samples("\0\xff\0\0\0\x07", 6);
+        REQUIRE(readFile("test_RNA_0_0.00.pgm") == pgmHeader("P5", "255") + samples);
+    }
+    SECTION("A file which cannot be opened is an error")
+    {
+        PgmWriter writer(logger, 3, 2, "missing_dir/test_RNA", "RNA", rnaCountSignal, 255);
+        writer.setData(grid.getStatePlane(), grid.getRnaContentPlane(), grid.getExtendedColumns());
+        REQUIRE_THROWS_AS(writer.write(0), std::runtime_error);
+    }
+}
@@ -6,7 +6,7 @@
 
 import cv2
 import argparse
-from utilsLib import FileSequence
+from utilsLib import FileSequence, readSnapshot
 
 parser = argparse.ArgumentParser(formatter_class=argparse.ArgumentDefaultsHelpFormatter)
 parser.add_argument("inputFiles", help="The input files to process", nargs='+')
@@ -17,7 +17,7 @@ fileSequence = FileSequence(args.inputFiles)
 
 for id, f in enumerate(fileSequence):
     print(">[%d] %s" %(id, f))
-    img = cv2.imread(f.getName())
+    img = readSnapshot(f.getName())
     blurredImg = cv2.GaussianBlur(img, (args.blurRadius, args.blurRadius), 0)
     cv2.imshow("Blur(%d) : %d" %(args.blurRadius, id), blurredImg)
     cv2.waitKey(0)
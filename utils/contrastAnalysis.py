@@ -10,7 +10,7 @@ import os
 import cv2
 import numpy as np
 
-from utilsLib import Plotter, computeCov, getEntryNearestToValue, FileSequence, CsvWriter
+from utilsLib import Plotter, computeCov, getEntryNearestToValue, FileSequence, CsvWriter, readSnapshot
 
 
 class Analysis:
@@ -28,7 +28,7 @@ class Analysis:
         self.numSamples = len(self.results)
 
     def __analyzeSnapshot(self, snapshotNum, snapshotFile):
-        img = cv2.imread(snapshotFile.getName())
+        img = readSnapshot(snapshotFile.getName())
         if type(img) == type(None):
             print("WARNING: Image %s cannot be read. Ignoring it." % (snapshotFile))
             return
@@ -74,6 +74,16 @@ def getEntryNearestToValue(givenList, value):
     return min(givenList, key=lambda x: abs(x - value))
 
 
+def readSnapshot(fileName):
+    """
+    Read a snapshot as a single channel image, keeping its bit depth (both ASCII P2 and binary P5 PGM files,
+    including the 16 bit RNA channel written with --pgm-format binary).
+    :param fileName: Path of the snapshot
+    :return: The numpy.ndarray of the image, None if it cannot be read
+    """
+    return cv2.imread(fileName, cv2.IMREAD_UNCHANGED)
+
+
 ### Classes
 class Plotter:
     def __init__(self, X, plotFileName="plot.svg", interactive=True, xlabel="", ylabel="", y2label="", xlim=None,
@@ -450,6 +460,59 @@ class FileSequence:
         return res
 
 
+class FrameContainer:
+    """
+    Snapshots written by active-microemulsion with '--output-format container', memory-mapped: frames are read by
+    number, without parsing text or globbing files. The layout is described in FrameContainerWriter.h.
+    """
+    headerDtype = np.dtype([("magic", "S8"), ("version", "<u4"), ("headerSize", "<u4"), ("width", "<u4"),
+                            ("height", "<u4"), ("numChannels", "<u4"), ("reserved", "<u4"), ("numFrames", "<u8"),
+                            ("frameSize", "<u8"), ("channelNames", "S32", (8,))])
+
+    def __init__(self, fileName):
+        self.name = fileName
+        header = np.fromfile(fileName, dtype=FrameContainer.headerDtype, count=1)[0]
+        if header["magic"] != b"AMEFRAME" or header["version"] != 1:
+            raise ValueError("%s is not a frame container" % (fileName))
+        self.width = int(header["width"])
+        self.height = int(header["height"])
+        numChannels = int(header["numChannels"])
+        self.channelNames = [x.decode() for x in header["channelNames"][:numChannels]]
+        self.frameDtype = np.dtype([("time", "<f8"), ("swapAttempts", "<u8"), ("swapsPerformed", "<u8"),
+                                    ("chemChangesPerformed", "<u8"), ("isExtraSnapshot", "<u4"), ("padding", "<u4"),
+                                    ("channels", "u1", (numChannels, self.height, self.width))])
+        assert self.frameDtype.itemsize == header["frameSize"]
+        numFrames = int(header["numFrames"])
+        if numFrames > 0:
+            self.frames = np.memmap(fileName, dtype=self.frameDtype, mode="r", offset=int(header["headerSize"]),
+                                    shape=(numFrames,))
+        else:
+            self.frames = np.zeros(0, dtype=self.frameDtype)
+
+    def __len__(self):
+        return len(self.frames)
+
+    def getChannelNames(self):
+        return self.channelNames
+
+    def getChannelIndex(self, channel):
+        # Channels can be given by name or by index
+        return self.channelNames.index(channel) if isinstance(channel, str) else channel
+
+    def getFrame(self, frameId, channel):
+        """The image of the given channel in the given frame, as a (height, width) array, top row first."""
+        return self.frames[frameId]["channels"][self.getChannelIndex(channel)]
+
+    def getChannel(self, channel, includeExtra=False):
+        """The images of the given channel in all the frames, as a (frames, height, width) array."""
+        frames = self.frames if includeExtra else self.frames[self.frames["isExtraSnapshot"] == 0]
+        return frames["channels"][:, self.getChannelIndex(channel)]
+
+    def getTimes(self, includeExtra=False):
+        frames = self.frames if includeExtra else self.frames[self.frames["isExtraSnapshot"] == 0]
+        return np.array(frames["time"])
+
+
 class CsvWriter:
     def __init__(self, keys, dataMatrix):
         self.keys = keys
@@ -483,8 +546,8 @@ class CurveAnalysis:
         self.numSamples = len(self.results)
 
     def __analyzeSnapshot(self, snapshotNum, xSnapshotFile, ySnapshotFile):
-        xImg = cv2.imread(xSnapshotFile.getName())
-        yImg = cv2.imread(ySnapshotFile.getName())
+        xImg = readSnapshot(xSnapshotFile.getName())
+        yImg = readSnapshot(ySnapshotFile.getName())
         if type(xImg) == type(None):
             print("WARNING: Image %s cannot be read. Ignoring it." % (xSnapshotFile))
             return
@@ -576,9 +639,9 @@ class CurveAnalysis3D:
         self.numSamples = len(self.results)
 
     def __analyzeSnapshot(self, snapshotNum, xSnapshotFile, ySnapshotFile, zSnapshotFile):
-        xImg = cv2.imread(xSnapshotFile.getName())
-        yImg = cv2.imread(ySnapshotFile.getName())
-        zImg = cv2.imread(zSnapshotFile.getName())
+        xImg = readSnapshot(xSnapshotFile.getName())
+        yImg = readSnapshot(ySnapshotFile.getName())
+        zImg = readSnapshot(zSnapshotFile.getName())
         if type(xImg) == type(None):
             print("WARNING: Image %s cannot be read. Ignoring it." % (xSnapshotFile))
             return
@@ -697,7 +760,7 @@ class TimeAnalysis:
         self.numSamples = len(self.results)
 
     def __analyzeSnapshot(self, ySnapshotFileItem):
-        yImg = cv2.imread(ySnapshotFileItem.getName())
+        yImg = readSnapshot(ySnapshotFileItem.getName())
         if type(yImg) == type(None):
             print("WARNING: Image %s cannot be read. Ignoring it." % (ySnapshotFileItem))
             return